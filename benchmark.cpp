@@ -0,0 +1,1364 @@
+// MIT License Copyright (C) 2023 heksbeks https://github.com/heksbeks/qjsonpath
+
+#include <QtTest>
+#include <QJsonArray>
+#include <QTemporaryFile>
+#include <QXmlStreamReader>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "qjsonpath.h"
+
+// counts heap allocations of the whole process, used to verify allocation free code paths
+static std::atomic<qint64> _benchmark_allocations(0);
+
+#if defined(__GLIBC__)
+// Qt 6 allocates the data of QString, QByteArray and its containers with malloc and realloc, not with operator new. The
+// functions of the executable take precedence over those of glibc for the Qt libraries too, so every allocation is counted.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* p, size_t size);
+
+void* malloc(size_t size)
+{
+    _benchmark_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+void* calloc(size_t count, size_t size)
+{
+    _benchmark_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+void* realloc(void* p, size_t size)
+{
+    _benchmark_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+}
+static const bool _benchmark_countsMalloc = true;
+#else
+// elsewhere only operator new is replaced, allocations of Qt through malloc are not counted
+static const bool _benchmark_countsMalloc = false;
+#endif
+
+void* operator new(std::size_t size)
+{
+    if (!_benchmark_countsMalloc) // counted by malloc otherwise
+        _benchmark_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+//!  QJsonPathBenchmark
+/*!
+ * Benchmarks for QJsonPath, run with the QTest benchmark options, e.g. "qjsonpath_benchmark -iterations 1000".
+ * Write the results with "-o results.xml,xml" (or csv) and compare two runs with "qjsonpath_benchmark --compare before.xml after.xml".
+ */
+class QJsonPathBenchmark : public QObject
+{
+    Q_OBJECT
+
+private:
+    // config like document: services/svc<n>/limits/cpu/values[<m>]/max
+    static QJsonDocument configDocument(int services)
+    {
+        QJsonObject svcs;
+        for (int n = 0; n < services; n++) {
+            QJsonArray values;
+            for (int m = 0; m < 8; m++)
+                values.append(QJsonObject{{"min", m}, {"max", m * 10}});
+            QJsonObject cpu{{"values", values}, {"unit", "mcpu"}};
+            QJsonObject limits{{"cpu", cpu}, {"mem", 512}};
+            svcs[QString("svc%1").arg(n)] = QJsonObject{{"limits", limits}, {"name", QString("service %1").arg(n)}};
+        }
+        return QJsonDocument(QJsonObject{{"services", svcs}});
+    }
+
+    // flat object with <keys> entries: config/k<n>/value
+    static QJsonDocument flatDocument(int keys)
+    {
+        QJsonObject config;
+        for (int n = 0; n < keys; n++)
+            config[QString("k%1").arg(n)] = QJsonObject{{"value", n}};
+        return QJsonDocument(QJsonObject{{"config", config}});
+    }
+
+    // orders[<n>] with id, status and total
+    static QJsonArray ordersArray(int size)
+    {
+        QJsonArray orders;
+        for (int i = 0; i < size; i++)
+            orders.append(QJsonObject{{"id", i}, {"status", i % 3 ? "open" : "closed"}, {"total", i % 500}});
+        return orders;
+    }
+
+    // log records of about 500 bytes, each a compact JSON text
+    static QVector<QByteArray> logRecords(int count)
+    {
+        QVector<QByteArray> records;
+        for (int i = 0; i < count; i++) {
+            const QJsonObject headers{{"accept", "application/json"}, {"user-agent", "client/1.0"}, {"x-trace", QString::number(i * 7919)}};
+            const QJsonObject record{
+                {"ts", QString("2023-05-01T12:%1:%2Z").arg(i / 60 % 60, 2, 10, QChar('0')).arg(i % 60, 2, 10, QChar('0'))},
+                {"level", i % 10 ? "info" : "error"},
+                {"msg", QString("request %1 finished, \"state\": {ok} [done]").arg(i)},
+                {"request", QJsonObject{{"id", QString("r-%1").arg(i)}, {"method", "GET"}, {"path", QString("/api/v1/items/%1").arg(i % 1000)}, {"headers", headers}}},
+                {"response", QJsonObject{{"status", i % 10 ? 200 : 500}, {"bytes", i % 5000}}},
+                {"user", QJsonObject{{"id", i % 100}, {"roles", QJsonArray{"reader", "writer"}}}},
+                {"latency_ms", (i % 1000) / 10.0},
+                {"tags", QJsonArray{"api", "v1", i % 2 ? "odd" : "even"}},
+            };
+            records.append(QJsonDocument(record).toJson(QJsonDocument::Compact));
+        }
+        return records;
+    }
+
+    static const char* deepPath() { return "services/svc150/limits/cpu/values[5]/max"; }
+
+    enum SweepRoot
+    {
+        SweepDocument,
+        SweepObject,
+        SweepArray,
+        SweepValue,
+    };
+
+    // <depth> levels with <width> members each, the middle member leads to the next level, the last level holds an array of <length> numbers
+    static QJsonValue sweepDocument(int width, int depth, int length, bool arrayRoot)
+    {
+        QJsonArray numbers;
+        for (int i = 0; i < length; i++)
+            numbers.append(i);
+        QJsonValue value = numbers;
+        for (int level = depth - 1; level >= 0; level--) {
+            if (level == 0 && arrayRoot) {
+                QJsonArray arr;
+                for (int i = 0; i < width; i++)
+                    arr.append(i == width / 2 ? value : QJsonValue(i));
+                value = arr;
+            }
+            else {
+                QJsonObject obj;
+                for (int i = 0; i < width; i++)
+                    obj.insert(QString("k%1").arg(i), i == width / 2 ? value : QJsonValue(i));
+                value = obj;
+            }
+        }
+        return value;
+    }
+
+    // path of the middle number of sweepDocument
+    static QVariantList sweepPath(int width, int depth, int length, bool arrayRoot)
+    {
+        QVariantList path;
+        for (int level = 0; level < depth; level++) {
+            if (level == 0 && arrayRoot)
+                path.append(width / 2);
+            else
+                path.append(QString("k%1").arg(width / 2));
+        }
+        path.append(length / 2);
+        return path;
+    }
+
+    static QString pathString(const QVariantList& path)
+    {
+        QString text;
+        for (const auto& token : path) {
+            if (token.userType() == QMetaType::Type::Int)
+                text += QString("[%1]").arg(token.toInt());
+            else
+                text += (text.isEmpty() ? QString() : QString(QJsonPath::separator())) + token.toString();
+        }
+        return text;
+    }
+
+    // with shared set, a copy of the root is taken before every call, so set and remove have to detach the containers on the path
+    template <class T> static void sweepRoot(T& root, const QString& operation, bool shared, const QVariantList& list, bool listPath)
+    {
+        const QString path = pathString(list);
+        const int expected = list.last().toInt();
+        T copy;
+        if (operation == "get") {
+            QJsonValue result;
+            QBENCHMARK {
+                if (shared)
+                    copy = root;
+                result = listPath ? QJsonPath::get(root, list) : QJsonPath::get(root, path);
+            }
+            QCOMPARE(result, QJsonValue(expected));
+        }
+        else if (operation == "set") {
+            int n = 0;
+            QBENCHMARK {
+                if (shared)
+                    copy = root;
+                if (listPath)
+                    QJsonPath::set(root, list, ++n);
+                else
+                    QJsonPath::set(root, path, ++n);
+            }
+            QCOMPARE(QJsonPath::get(root, list), QJsonValue(n));
+        }
+        else {
+            // measured together with the set that puts the element back
+            QBENCHMARK {
+                if (shared)
+                    copy = root;
+                if (listPath) {
+                    QJsonPath::remove(root, list);
+                    QJsonPath::set(root, list, expected);
+                }
+                else {
+                    QJsonPath::remove(root, path);
+                    QJsonPath::set(root, path, expected);
+                }
+            }
+            QCOMPARE(QJsonPath::get(root, list), QJsonValue(expected));
+        }
+    }
+
+private slots:
+    void getByPathType_data()
+    {
+        QTest::addColumn<int>("pathType");
+        QTest::newRow("string") << 0;
+        QTest::newRow("list") << 1;
+        QTest::newRow("compiled") << 2;
+        QTest::newRow("literal") << 3;
+    }
+
+    void getByPathType()
+    {
+        QFETCH(int, pathType);
+        const auto doc = configDocument(300);
+        const QString path = deepPath();
+        const auto list = QJsonPath::splitPath(path);
+        const QJsonPath::Compiled compiled(path);
+        QJsonValue result;
+
+        if (pathType == 0) {
+            QBENCHMARK {
+                result = QJsonPath::get(doc, path);
+            }
+        }
+        else if (pathType == 1) {
+            QBENCHMARK {
+                result = QJsonPath::get(doc, list);
+            }
+        }
+        else if (pathType == 2) {
+            QBENCHMARK {
+                result = QJsonPath::get(doc, compiled);
+            }
+        }
+        else {
+            QBENCHMARK {
+                result = QJsonPath::get(doc, QJSONPATH("services/svc150/limits/cpu/values[5]/max"));
+            }
+        }
+        QCOMPARE(result, QJsonValue(50));
+    }
+
+    void getSharedDocument()
+    {
+        // copies keep the reference count of all containers above one, a read must not detach them
+        const auto doc = configDocument(300);
+        const auto copies = QVector<QJsonDocument>(4, doc);
+        const QJsonPath::Compiled compiled(deepPath());
+        QJsonValue result;
+        QBENCHMARK {
+            result = QJsonPath::get(doc, compiled);
+        }
+        QCOMPARE(result, QJsonValue(50));
+    }
+
+    void getWithoutAllocation_data()
+    {
+        QTest::addColumn<QString>("path");
+        QTest::addColumn<QJsonValue>("expected");
+        QTest::newRow("number") << QString(deepPath()) << QJsonValue(50);
+        QTest::newRow("string") << QString("services/svc7/name") << QJsonValue("service 7");
+        QTest::newRow("object") << QString("services/svc7/limits/cpu/values[-1]") << QJsonValue(QJsonObject{{"min", 7}, {"max", 70}});
+    }
+
+    void getWithoutAllocation()
+    {
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+        QSKIP("Qt 5 copies values out of its binary JSON format");
+#endif
+        if (!_benchmark_countsMalloc)
+            QSKIP("allocations of Qt with malloc are only counted with glibc");
+        QFETCH(QString, path);
+        QFETCH(QJsonValue, expected);
+        const auto doc = configDocument(300);
+        const auto obj = doc.object();
+        const QJsonPath::Compiled compiled(path);
+        QJsonValue result = QJsonPath::get(doc, compiled);
+        QCOMPARE(result, expected);
+
+        const auto allocations = _benchmark_allocations.load();
+        for (int i = 0; i < 100; i++) {
+            result = QJsonPath::get(doc, compiled);
+            result = QJsonPath::get(obj, compiled);
+        }
+        QCOMPARE(_benchmark_allocations.load() - allocations, qint64(0));
+        QCOMPARE(result, expected);
+    }
+
+    void setByPathType_data()
+    {
+        getByPathType_data();
+    }
+
+    void setByPathType()
+    {
+        QFETCH(int, pathType);
+        auto doc = configDocument(300);
+        const QString path = deepPath();
+        const auto list = QJsonPath::splitPath(path);
+        const QJsonPath::Compiled compiled(path);
+        int n = 0;
+
+        if (pathType == 0) {
+            QBENCHMARK {
+                QJsonPath::set(doc, path, ++n);
+            }
+        }
+        else if (pathType == 1) {
+            QBENCHMARK {
+                QJsonPath::set(doc, list, ++n);
+            }
+        }
+        else if (pathType == 2) {
+            QBENCHMARK {
+                QJsonPath::set(doc, compiled, ++n);
+            }
+        }
+        else {
+            QBENCHMARK {
+                QJsonPath::set(doc, QJSONPATH("services/svc150/limits/cpu/values[5]/max"), ++n);
+            }
+        }
+        QCOMPARE(QJsonPath::get(doc, compiled), QJsonValue(n));
+    }
+
+    // set cost must not grow with the document, only the containers on the path are touched
+    void setByDocumentSize_data()
+    {
+        QTest::addColumn<int>("keys");
+        QTest::newRow("1k") << 1000;
+        QTest::newRow("10k") << 10000;
+        QTest::newRow("50k") << 50000;
+    }
+
+    void setByDocumentSize()
+    {
+        QFETCH(int, keys);
+        auto doc = flatDocument(keys);
+        const QJsonPath::Compiled compiled(QString("config/k%1/value").arg(keys / 2));
+        int n = 0;
+        QBENCHMARK {
+            QJsonPath::set(doc, compiled, ++n);
+        }
+        QCOMPARE(QJsonPath::get(doc, compiled), QJsonValue(n));
+    }
+
+    void setByDepth_data()
+    {
+        QTest::addColumn<int>("depth");
+        QTest::newRow("2") << 2;
+        QTest::newRow("4") << 4;
+        QTest::newRow("8") << 8;
+        QTest::newRow("16") << 16;
+    }
+
+    void setByDepth()
+    {
+        QFETCH(int, depth);
+        QVariantList path;
+        for (int i = 0; i < depth; i++)
+            path.append(QString("level%1").arg(i));
+        const QJsonPath::Compiled compiled(path);
+        auto doc = flatDocument(1000);
+        QJsonPath::set(doc, compiled, 0);
+        int n = 0;
+        QBENCHMARK {
+            QJsonPath::set(doc, compiled, ++n);
+        }
+        QCOMPARE(QJsonPath::get(doc, compiled), QJsonValue(n));
+    }
+
+    void setBatch_data()
+    {
+        QTest::addColumn<int>("count");
+        QTest::addColumn<bool>("batched");
+        QTest::newRow("sequential 20") << 20 << false;
+        QTest::newRow("batch 20") << 20 << true;
+        QTest::newRow("sequential 200") << 200 << false;
+        QTest::newRow("batch 200") << 200 << true;
+    }
+
+    // many sets below the same service, the batch walks the shared prefix once
+    void setBatch()
+    {
+        QFETCH(int, count);
+        QFETCH(bool, batched);
+        auto doc = configDocument(300);
+        QVector<QJsonPath::Compiled> paths;
+        for (int i = 0; i < count; i++)
+            paths.append(QJsonPath::Compiled(QString("services/svc150/limits/cpu/values[%1]/max").arg(i % 8)));
+        paths.append(QJsonPath::Compiled(QString("services/svc150/limits/mem")));
+
+        QJsonPath::Batch batch;
+        for (const auto& path : paths)
+            batch.set(path, 1);
+
+        if (batched) {
+            QBENCHMARK {
+                batch.apply(doc);
+            }
+        }
+        else {
+            QBENCHMARK {
+                for (const auto& path : paths)
+                    QJsonPath::set(doc, path, 1);
+            }
+        }
+        QCOMPARE(QJsonPath::get(doc, "services/svc150/limits/mem"), QJsonValue(1));
+    }
+
+    void buildResponse_data()
+    {
+        QTest::addColumn<int>("method");
+        QTest::newRow("set on a document") << 0;
+        QTest::newRow("builder to document") << 1;
+        QTest::newRow("set and toJson") << 2;
+        QTest::newRow("builder toJson") << 3;
+    }
+
+    // a response of 2000 records with 8 values each, built from empty by single sets, as a document and as compact JSON text;
+    // toDocument creates the same Qt containers as set, the end-to-end ratio of the document rows is far below that of the text rows
+    void buildResponse()
+    {
+        QFETCH(int, method);
+        QVector<QPair<QJsonPath::Compiled, QJsonValue>> steps;
+        for (int i = 0; i < 2000; i++) {
+            const auto id = QString("r%1").arg(i);
+            steps.append({ QJsonPath::Compiled(QVariantList{ "records", i, "id" }), id });
+            steps.append({ QJsonPath::Compiled(QVariantList{ "records", i, "name" }), QString("record %1").arg(i) });
+            steps.append({ QJsonPath::Compiled(QVariantList{ "records", i, "price" }), i * 0.25 });
+            steps.append({ QJsonPath::Compiled(QVariantList{ "records", i, "stock", "count" }), i % 17 });
+            steps.append({ QJsonPath::Compiled(QVariantList{ "records", i, "tags", 2 }), "last" });
+            steps.append({ QJsonPath::Compiled(QVariantList{ "records", i, "tags", 0 }), "first" });
+            steps.append({ QJsonPath::Compiled(QVariantList{ "index", id }), i });
+            steps.append({ QJsonPath::Compiled(QVariantList{ "total" }), i + 1 });
+        }
+        QJsonDocument doc;
+        QByteArray json;
+
+        if (method == 0 || method == 2) {
+            QBENCHMARK {
+                doc = QJsonDocument();
+                for (const auto& step : steps)
+                    QJsonPath::set(doc, step.first, step.second);
+                if (method == 2)
+                    json = doc.toJson(QJsonDocument::Compact);
+            }
+        }
+        else {
+            QBENCHMARK {
+                QJsonPath::Builder builder;
+                for (const auto& step : steps)
+                    builder.set(step.first, step.second);
+                if (method == 1)
+                    doc = builder.toDocument();
+                else
+                    json = builder.toJson();
+            }
+        }
+        if (method >= 2) {
+            const auto parsed = QJsonDocument::fromJson(json);
+            if (method == 3) {
+                QJsonPath::Builder reference;
+                for (const auto& step : steps)
+                    reference.set(step.first, step.second);
+                QCOMPARE(parsed, reference.toDocument());
+            }
+            doc = parsed;
+        }
+        QCOMPARE(QJsonPath::get(doc, "total"), QJsonValue(2000));
+        QCOMPARE(QJsonPath::get(doc, "records[-1]/tags[2]"), QJsonValue("last"));
+        QCOMPARE(QJsonPath::get(doc, "index/r1999"), QJsonValue(1999));
+    }
+
+    void projection_data()
+    {
+        QTest::addColumn<bool>("projection");
+        QTest::newRow("get, set and toJson") << false;
+        QTest::newRow("projection") << true;
+    }
+
+    // 3 of the 12 fields of 2000 records selected as JSON text, with the heap allocations per response
+    void projection()
+    {
+        QFETCH(bool, projection);
+        QJsonArray records;
+        for (int i = 0; i < 2000; i++) {
+            QJsonObject record;
+            for (int f = 0; f < 10; f++)
+                record.insert(QString("field%1").arg(f), QString("value %1 of record %2").arg(f).arg(i));
+            record.insert("id", i);
+            record.insert("stock", QJsonObject{ { "count", i % 17 }, { "store", "main" } });
+            records.append(record);
+        }
+        const QJsonDocument doc(QJsonObject{ { "records", records }, { "total", 2000 } });
+        QVector<QJsonPath::Compiled> paths{ QJsonPath::Compiled("total") };
+        for (int i = 0; i < 2000; i++) {
+            paths.append(QJsonPath::Compiled(QVariantList{ "records", i, "id" }));
+            paths.append(QJsonPath::Compiled(QVariantList{ "records", i, "field3" }));
+            paths.append(QJsonPath::Compiled(QVariantList{ "records", i, "stock", "count" }));
+        }
+        const QJsonPath::Projection fields(paths);
+
+        const auto select = [&]() {
+            QJsonDocument response;
+            for (const auto& path : paths) {
+                const auto value = QJsonPath::get(doc, path);
+                if (!value.isUndefined())
+                    QJsonPath::set(response, path, value);
+            }
+            return response.toJson(QJsonDocument::Compact);
+        };
+        QByteArray json;
+        qint64 allocations = 0;
+        QBENCHMARK {
+            const qint64 before = _benchmark_allocations.load();
+            json = projection ? fields.toJson(doc) : select();
+            allocations = _benchmark_allocations.load() - before;
+        }
+        if (projection) {
+            // no containers are created for the response, so it allocates less than get, set and toJson
+            const qint64 before = _benchmark_allocations.load();
+            const auto selected = select();
+            const qint64 selectAllocations = _benchmark_allocations.load() - before;
+            QCOMPARE(selected, json);
+            QVERIFY2(allocations < selectAllocations, qPrintable(QString("%1 allocations, %2 with get, set and toJson").arg(allocations).arg(selectAllocations)));
+        }
+        const auto result = QJsonDocument::fromJson(json);
+        QCOMPARE(QJsonPath::get(result, "records[1999]/stock/count"), QJsonValue(1999 % 17));
+        QCOMPARE(QJsonPath::get(result, "records[5]/field3"), QJsonValue("value 3 of record 5"));
+        QCOMPARE(QJsonPath::get(result, "records[5]/field4"), QJsonValue(QJsonValue::Undefined));
+    }
+
+    void moveSubtree_data()
+    {
+        QTest::addColumn<bool>("move");
+        QTest::newRow("get, remove and set") << false;
+        QTest::newRow("move") << true;
+    }
+
+    // a service of 300 is moved to an archive and back, then changed
+    void moveSubtree()
+    {
+        QFETCH(bool, move);
+        auto doc = configDocument(300);
+        const QJsonPath::Compiled service("services/svc150"), archived("archive/svc150"), mem("services/svc150/limits/mem");
+        int i = 0;
+        QBENCHMARK {
+            if (move) {
+                QJsonPath::move(doc, service, archived);
+                QJsonPath::move(doc, archived, service);
+            }
+            else {
+                QJsonValue value = QJsonPath::get(doc, service);
+                QJsonPath::remove(doc, service);
+                QJsonPath::set(doc, archived, value);
+                value = QJsonPath::get(doc, archived);
+                QJsonPath::remove(doc, archived);
+                QJsonPath::set(doc, service, value);
+            }
+            QJsonPath::set(doc, mem, i++);
+        }
+        QCOMPARE(QJsonPath::get(doc, "services/svc150/limits/cpu/values[5]/max"), QJsonValue(50));
+        QCOMPARE(QJsonPath::get(doc, "archive").toObject().size(), 0);
+    }
+
+    // A relocated subtree keeps a reference count of 1: a change inside of it allocates no more than the same change in a
+    // document built with the subtree in place, while a second reference makes the change copy the containers on its path.
+    void moveWithoutCopy()
+    {
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+        QSKIP("Qt 5 stores nested containers in the binary data of their parent");
+#endif
+        const auto subtree = []() {
+            QJsonObject sub;
+            for (int i = 0; i < 1000; i++)
+                sub.insert(QString("k%1").arg(i), QJsonObject{ { "v", i } });
+            return sub;
+        };
+        const QJsonPath::Compiled changed("to/sub/k500/v");
+        const auto allocations = [&changed](QJsonObject& root) {
+            const auto before = _benchmark_allocations.load();
+            QJsonPath::set(root, changed, -1);
+            return _benchmark_allocations.load() - before;
+        };
+
+        QJsonObject inPlace{ { "to", QJsonObject{ { "sub", subtree() } } } };
+        const qint64 unique = allocations(inPlace);
+
+        QJsonObject moved{ { "from", QJsonObject{ { "sub", subtree() } } }, { "to", QJsonObject() } };
+        QVERIFY(QJsonPath::move(moved, "from/sub", "to/sub"));
+        QCOMPARE(allocations(moved), unique);
+
+        QJsonObject taken{ { "from", QJsonObject{ { "sub", subtree() } } } };
+        QJsonPath::set(taken, "to/sub", QJsonPath::take(taken, "from/sub"));
+        QCOMPARE(allocations(taken), unique);
+
+        QJsonObject assigned;
+        QJsonValue value = subtree();
+        QJsonPath::set(assigned, QJsonPath::Compiled("to/sub"), std::move(value));
+        QCOMPARE(allocations(assigned), unique);
+
+        // the test detects a second reference
+        QJsonObject shared{ { "to", QJsonObject{ { "sub", subtree() } } } };
+        const auto copy = QJsonPath::get(shared, "to/sub");
+        QVERIFY(allocations(shared) > unique);
+        QCOMPARE(QJsonPath::get(copy, "k500/v"), QJsonValue(500));
+        QCOMPARE(QJsonPath::get(moved, changed), QJsonValue(-1));
+    }
+
+    void fillArray_data()
+    {
+        QTest::addColumn<int>("mode");
+        QTest::newRow("set [i] per element") << 0;
+        QTest::newRow("set [+] per element") << 1;
+        QTest::newRow("appendRange") << 2;
+        QTest::newRow("resize") << 3;
+        QTest::newRow("set of the last index") << 4;
+    }
+
+    // an array of 100000 elements is filled below a config document through a path
+    void fillArray()
+    {
+        QFETCH(int, mode);
+        const int n = 100000;
+        auto doc = configDocument(100);
+        const QJsonPath::Compiled arrayPath("data/values");
+        auto appendPath = arrayPath, lastPath = arrayPath;
+        appendPath.appendElement();
+        lastPath.append(n - 1);
+        QJsonArray values;
+        for (int i = 0; i < n; i++)
+            values.append(0);
+        QBENCHMARK {
+            QJsonPath::remove(doc, arrayPath);
+            if (mode == 0) {
+                auto path = arrayPath;
+                for (int i = 0; i < n; i++) {
+                    path.truncate(arrayPath.size());
+                    path.append(i);
+                    QJsonPath::set(doc, path, 0);
+                }
+            }
+            else if (mode == 1) {
+                for (int i = 0; i < n; i++)
+                    QJsonPath::set(doc, appendPath, 0);
+            }
+            else if (mode == 2)
+                QJsonPath::appendRange(doc, arrayPath, values);
+            else if (mode == 3)
+                QJsonPath::resize(doc, arrayPath, n, 0);
+            else
+                QJsonPath::set(doc, lastPath, 0);
+        }
+        QCOMPARE(int(QJsonPath::get(doc, arrayPath).toArray().size()), n);
+    }
+
+    void insertMiddle_data()
+    {
+        QTest::addColumn<bool>("splice");
+        QTest::newRow("insert per element") << false;
+        QTest::newRow("splice") << true;
+    }
+
+    // 1000 values are inserted in the middle of an array of 100000 elements and removed again
+    void insertMiddle()
+    {
+        QFETCH(bool, splice);
+        QJsonDocument doc;
+        const QJsonPath::Compiled arrayPath("data/values"), middle("data/values[50000]");
+        QJsonPath::resize(doc, arrayPath, 100000, 0);
+        QJsonArray values;
+        for (int i = 0; i < 1000; i++)
+            values.append(i);
+        QBENCHMARK {
+            if (splice)
+                QJsonPath::splice(doc, arrayPath, 50000, 0, values);
+            else {
+                for (int i = values.size() - 1; i >= 0; i--)
+                    QJsonPath::insert(doc, middle, values.at(i));
+            }
+            QJsonPath::splice(doc, arrayPath, 50000, 1000);
+        }
+        QCOMPARE(int(QJsonPath::get(doc, arrayPath).toArray().size()), 100000);
+        QJsonPath::splice(doc, arrayPath, 50000, 0, values);
+        QCOMPARE(QJsonPath::get(doc, "data/values[50999]"), QJsonValue(999));
+    }
+
+    void queryLimit_data()
+    {
+        QTest::addColumn<int>("limit");
+        QTest::newRow("first 10") << 10;
+        QTest::newRow("all") << -1;
+    }
+
+    // matches are produced lazily, stopping early must not walk the rest of the document
+    void queryLimit()
+    {
+        QFETCH(int, limit);
+        const auto doc = configDocument(300);
+        const QJsonPath::Query query("services/*/limits/cpu/values[*]/max");
+        int n = 0;
+        QBENCHMARK {
+            n = query.match(doc).toVector(limit).size();
+        }
+        QCOMPARE(n, limit < 0 ? 300 * 8 : limit);
+    }
+
+    void queryDescent()
+    {
+        const auto doc = configDocument(300);
+        const QJsonPath::Query query("..max");
+        int n = 0;
+        QBENCHMARK {
+            n = 0;
+            for (const auto& m : query.match(doc)) {
+                Q_UNUSED(m)
+                n++;
+            }
+        }
+        QCOMPARE(n, 300 * 8);
+    }
+
+    void filterLargeArray_data()
+    {
+        QTest::addColumn<int>("method");
+        QTest::newRow("query") << 0;
+        QTest::newRow("filter") << 1;
+        QTest::newRow("get per element") << 2;
+    }
+
+    // 1M elements, compiled filter against the hand written loop it replaces
+    void filterLargeArray()
+    {
+        QFETCH(int, method);
+        const auto orders = ordersArray(1000000);
+        const QJsonPath::Query query("[?(@.status == 'open' && @.total > 100)]");
+        const QJsonPath::Filter filter("@.status == 'open' && @.total > 100");
+        int n = 0;
+
+        if (method == 0) {
+            QBENCHMARK_ONCE {
+                n = 0;
+                for (const auto& match : query.match(orders)) {
+                    Q_UNUSED(match)
+                    n++;
+                }
+            }
+        }
+        else if (method == 1) {
+            QBENCHMARK_ONCE {
+                n = 0;
+                for (const auto& order : orders)
+                    n += filter.test(order);
+            }
+        }
+        else {
+            QBENCHMARK_ONCE {
+                n = 0;
+                for (const auto& order : orders)
+                    n += QJsonPath::get(order, "status") == "open" && QJsonPath::get(order, "total").toDouble() > 100;
+            }
+        }
+        QCOMPARE(n, 1000000 / 3 * 2 * 399 / 500 + 1);
+    }
+
+    void filterWithoutAllocation_data()
+    {
+        QTest::addColumn<QString>("expression");
+        QTest::addColumn<int>("matches");
+        QTest::newRow("numbers") << "@.total > 100 && (@.id >= 0 || !@.missing)" << 0;
+        QTest::newRow("string equality") << "@.status == 'open' && @.status != 'closed'" << 66;
+    }
+
+    void filterWithoutAllocation()
+    {
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+        QSKIP("Qt 5 copies values out of its binary JSON format");
+#endif
+        if (!_benchmark_countsMalloc)
+            QSKIP("allocations of Qt with malloc are only counted with glibc");
+        QFETCH(QString, expression);
+        QFETCH(int, matches);
+        const auto orders = ordersArray(100);
+        const QJsonPath::Filter filter(expression);
+        QVERIFY(filter.isValid());
+        int n = 0;
+        const auto allocations = _benchmark_allocations.load();
+        for (const auto& order : orders)
+            n += filter.test(order);
+        QCOMPARE(_benchmark_allocations.load() - allocations, qint64(0));
+        QCOMPARE(n, matches);
+    }
+
+    void streamText_data()
+    {
+        QTest::addColumn<int>("method");
+        QTest::newRow("parse document and get") << 0;
+        QTest::newRow("stream in 4k chunks") << 1;
+    }
+
+    // text of about 3 MB, the stream does not build a document and copies only the matched values
+    void streamText()
+    {
+        QFETCH(int, method);
+        const auto text = configDocument(3000).toJson(QJsonDocument::Compact);
+        const QVector<QJsonPath::Compiled> paths{ QJsonPath::Compiled(deepPath()), QJsonPath::Compiled("services/svc2999/name") };
+        QVector<QJsonValue> results(paths.size());
+
+        if (method == 0) {
+            QBENCHMARK {
+                const auto doc = QJsonDocument::fromJson(text);
+                for (int p = 0; p < paths.size(); p++)
+                    results[p] = QJsonPath::get(doc, paths[p]);
+            }
+        }
+        else {
+            QJsonPath::Stream stream(paths, [&](int path, const QJsonValue& value) { results[path] = value; });
+            QBENCHMARK {
+                stream.reset();
+                for (int pos = 0; pos < text.size(); pos += 4096)
+                    stream.feed(text.constData() + pos, int(qMin<qsizetype>(4096, text.size() - pos)));
+            }
+            QVERIFY(stream.isFinished());
+        }
+        QCOMPARE(results[0], QJsonValue(50));
+        QCOMPARE(results[1], QJsonValue("service 2999"));
+    }
+
+    void extractRecords_data()
+    {
+        QTest::addColumn<int>("method");
+        QTest::newRow("parse document and get") << 0;
+        QTest::newRow("extractor") << 1;
+    }
+
+    // throughput of extracting 10 fields from each record, reported in bytes per second
+    void extractRecords()
+    {
+        QFETCH(int, method);
+        const auto records = logRecords(20000);
+        const QVector<QJsonPath::Compiled> paths{
+            QJsonPath::Compiled("ts"), QJsonPath::Compiled("level"), QJsonPath::Compiled("msg"), QJsonPath::Compiled("request/id"),
+            QJsonPath::Compiled("request/path"), QJsonPath::Compiled("request/headers/x-trace"), QJsonPath::Compiled("response/status"),
+            QJsonPath::Compiled("user/id"), QJsonPath::Compiled("latency_ms"), QJsonPath::Compiled("tags[-1]"),
+        };
+        qint64 bytes = 0;
+        for (const auto& record : records)
+            bytes += record.size();
+
+        QJsonPath::Extractor extractor(paths);
+        QVector<QJsonValue> values(paths.size());
+        int errors = 0;
+        int rounds = 0;
+        QElapsedTimer timer;
+        timer.start();
+        do {
+            for (const auto& record : records) {
+                if (method == 0) {
+                    const auto doc = QJsonDocument::fromJson(record);
+                    for (int p = 0; p < paths.size(); p++)
+                        values[p] = QJsonPath::get(doc, paths[p]);
+                }
+                else
+                    errors += !extractor.extract(record, values);
+            }
+            rounds++;
+        } while (timer.elapsed() < 1000);
+
+        const double bytesPerSecond = double(bytes) * rounds / (double(timer.nsecsElapsed()) / 1e9);
+        QTest::setBenchmarkResult(bytesPerSecond, QTest::BytesPerSecond);
+        QCOMPARE(errors, 0);
+        QCOMPARE(values[1], QJsonValue("info"));
+        QCOMPARE(values[9], QJsonValue("odd"));
+    }
+
+    void lazyDocument_data()
+    {
+        QTest::addColumn<int>("method");
+        QTest::newRow("read file, parse document and get") << 0;
+        QTest::newRow("lazy document over the mapped file") << 1;
+    }
+
+    // a file of about 12 MB with a few paths read, the lazy document scans only the containers on them
+    void lazyDocument()
+    {
+        QFETCH(int, method);
+        QTemporaryFile file;
+        QVERIFY(file.open());
+        file.write(configDocument(20000).toJson(QJsonDocument::Compact));
+        file.close();
+        const QVector<QJsonPath::Compiled> paths{ QJsonPath::Compiled(deepPath()), QJsonPath::Compiled("services/svc19999/name"), QJsonPath::Compiled("services/svc7/limits/mem") };
+        QVector<QJsonValue> results(paths.size());
+
+        if (method == 0) {
+            QBENCHMARK_ONCE {
+                QFile input(file.fileName());
+                QVERIFY(input.open(QIODevice::ReadOnly));
+                const auto doc = QJsonDocument::fromJson(input.readAll());
+                for (int p = 0; p < paths.size(); p++)
+                    results[p] = QJsonPath::get(doc, paths[p]);
+            }
+        }
+        else {
+            QBENCHMARK_ONCE {
+                QJsonPath::LazyDocument doc;
+                QVERIFY(doc.open(file.fileName()));
+                for (int p = 0; p < paths.size(); p++)
+                    results[p] = QJsonPath::get(doc, paths[p]);
+            }
+        }
+        QCOMPARE(results[0], QJsonValue(50));
+        QCOMPARE(results[1], QJsonValue("service 19999"));
+        QCOMPARE(results[2], QJsonValue(512));
+    }
+
+    void cbor_data()
+    {
+        QTest::addColumn<int>("method");
+        QTest::newRow("decode, convert to JSON and get") << 0;
+        QTest::newRow("decode and get on CBOR") << 1;
+        QTest::newRow("CborReader on the stream") << 2;
+    }
+
+    // the same paths as lazyDocument on the configuration encoded as CBOR
+    void cbor()
+    {
+        QFETCH(int, method);
+        const auto bytes = QCborValue::fromJsonValue(configDocument(20000).object()).toCbor();
+        const QVector<QJsonPath::Compiled> paths{ QJsonPath::Compiled(deepPath()), QJsonPath::Compiled("services/svc19999/name"), QJsonPath::Compiled("services/svc7/limits/mem") };
+        QVector<QCborValue> results(paths.size());
+
+        if (method == 0) {
+            QBENCHMARK {
+                const auto json = QCborValue::fromCbor(bytes).toJsonValue();
+                for (int p = 0; p < paths.size(); p++)
+                    results[p] = QCborValue::fromJsonValue(QJsonPath::get(json, paths[p]));
+            }
+        }
+        else if (method == 1) {
+            QBENCHMARK {
+                const auto cbor = QCborValue::fromCbor(bytes);
+                for (int p = 0; p < paths.size(); p++)
+                    results[p] = QJsonPath::get(cbor, paths[p]);
+            }
+        }
+        else {
+            QJsonPath::CborReader reader(paths);
+            QBENCHMARK {
+                QVERIFY(reader.read(bytes, results));
+            }
+        }
+        QCOMPARE(results[0], QCborValue(50));
+        QCOMPARE(results[1], QCborValue("service 19999"));
+        QCOMPARE(results[2], QCborValue(512));
+    }
+
+    void indexLookup_data()
+    {
+        QTest::addColumn<bool>("index");
+        QTest::newRow("get loop") << false;
+        QTest::newRow("index") << true;
+    }
+
+    // finds the element of a 10000 element array by its id
+    void indexLookup()
+    {
+        QFETCH(bool, index);
+        QJsonArray users;
+        for (int i = 0; i < 10000; i++)
+            users.append(QJsonObject{ { "id", i * 7 }, { "name", QString("user%1").arg(i) } });
+        const QJsonObject doc{ { "users", users } };
+        const QJsonPath::Compiled usersPath("users"), idPath("id");
+        QJsonPath::Index byId(doc, usersPath, idPath);
+        int found = -1;
+        int key = 0;
+
+        QBENCHMARK {
+            key = (key + 7 * 4999) % 70000;
+            if (index)
+                found = byId.find(key);
+            else {
+                const auto arr = QJsonPath::get(doc, usersPath).toArray();
+                found = -1;
+                for (int i = 0; i < arr.size() && found < 0; i++) {
+                    if (QJsonPath::get(arr.at(i), idPath) == key)
+                        found = i;
+                }
+            }
+        }
+        QCOMPARE(found, key / 7);
+    }
+
+    void replicaSync_data()
+    {
+        QTest::addColumn<bool>("patch");
+        QTest::addColumn<bool>("size");
+        QTest::newRow("whole document") << false << false;
+        QTest::newRow("journal patch") << true << false;
+        QTest::newRow("whole document/bytes") << false << true;
+        QTest::newRow("journal patch/bytes") << true << true;
+    }
+
+    // sends 10 changed leaves of a config document to a replica as text, the whole document against a patch;
+    // the size rows report the bytes sent as an event count, which is better if lower like a time
+    void replicaSync()
+    {
+        QFETCH(bool, patch);
+        QFETCH(bool, size);
+        auto doc = configDocument(300);
+        QJsonPath::Journal journal;
+        for (int n = 0; n < 10; n++)
+            journal.set(doc, QString("services/svc%1/limits/cpu/values[-1]/max").arg(n * 30), n);
+        const auto original = configDocument(300);
+        QJsonDocument replica;
+        qint64 bytes = 0;
+        const auto sync = [&]() {
+            replica = original;
+            if (patch) {
+                const auto text = QJsonDocument(journal.patch()).toJson(QJsonDocument::Compact);
+                QJsonPath::Journal::apply(replica, QJsonDocument::fromJson(text).array());
+                bytes = text.size();
+            }
+            else {
+                const auto text = doc.toJson(QJsonDocument::Compact);
+                replica = QJsonDocument::fromJson(text);
+                bytes = text.size();
+            }
+        };
+
+        if (size) {
+            sync();
+            QTest::setBenchmarkResult(qreal(bytes), QTest::Events);
+        }
+        else {
+            QBENCHMARK {
+                sync();
+            }
+        }
+        QCOMPARE(replica, doc);
+    }
+
+    void sharedReaders_data()
+    {
+        QTest::addColumn<bool>("mutex");
+        QTest::addColumn<int>("threads");
+        for (int threads = 1; threads <= qMax(1, QThread::idealThreadCount()); threads *= 2) {
+            QTest::addRow("snapshot/%d", threads) << false << threads;
+            QTest::addRow("mutex/%d", threads) << true << threads;
+        }
+    }
+
+    // time per read of threads reading one config document while an updater changes it every millisecond, with snapshots
+    // of a SharedDocument and with a document guarded by a mutex, reported as time so a lower result is better as for the others
+    void sharedReaders()
+    {
+        QFETCH(bool, mutex);
+        QFETCH(int, threads);
+        QJsonObject config;
+        for (int i = 0; i < 100; i++)
+            QJsonPath::set(config, QVariantList{ "services", QString("svc%1").arg(i), "port" }, 8000 + i);
+        const QJsonPath::Compiled path("services/svc42/port");
+        QJsonPath::SharedDocument shared(config);
+        QMutex guard;
+
+        std::atomic<bool> done(false);
+        std::atomic<qint64> reads(0), sum(0);
+        QThreadPool pool;
+        pool.setMaxThreadCount(threads + 1);
+        for (int t = 0; t < threads; t++) {
+            pool.start([&]() {
+                qint64 n = 0, ports = 0;
+                while (!done.load(std::memory_order_relaxed)) {
+                    for (int i = 0; i < 100; i++) {
+                        if (mutex) {
+                            QMutexLocker locker(&guard);
+                            ports += QJsonPath::get(config, path).toInt();
+                        }
+                        else
+                            ports += shared.snapshot().get(path).toInt();
+                    }
+                    n += 100;
+                }
+                reads += n;
+                sum += ports;
+            });
+        }
+        pool.start([&]() {
+            for (int i = 0; !done.load(); i++) {
+                if (mutex) {
+                    QMutexLocker locker(&guard);
+                    QJsonPath::set(config, "services/svc0/port", i);
+                }
+                else
+                    shared.set("services/svc0/port", i);
+                QThread::msleep(1);
+            }
+        });
+        QElapsedTimer timer;
+        timer.start();
+        QThread::msleep(1000);
+        done = true;
+        pool.waitForDone();
+
+        const double readsPerSecond = double(reads) / (double(timer.nsecsElapsed()) / 1e9);
+        QTest::setBenchmarkResult(1e9 / qMax(readsPerSecond, 1.0), QTest::WalltimeNanoseconds);
+        QCOMPARE(sum.load(), reads.load() * 8042);
+    }
+
+    void parallel_data()
+    {
+        QTest::addColumn<bool>("reduce");
+        QTest::addColumn<int>("threads");
+        QTest::addRow("collect/loop") << false << 0;
+        QTest::addRow("reduce/loop") << true << 0;
+        for (int threads = 1; threads <= qMax(1, QThread::idealThreadCount()); threads *= 2) {
+            QTest::addRow("collect/%d", threads) << false << threads;
+            QTest::addRow("reduce/%d", threads) << true << threads;
+        }
+    }
+
+    // "samples[*]/value" on 1M samples, a get loop and a ParallelQuery with 1 to n threads
+    void parallel()
+    {
+        QFETCH(bool, reduce);
+        QFETCH(int, threads);
+        QJsonArray samples;
+        for (int i = 0; i < 1000000; i++)
+            samples.append(QJsonObject{ { "t", i }, { "value", i % 1000 } });
+        const QJsonObject doc{ { "samples", samples } };
+        const QJsonPath::Compiled value("value");
+        QJsonPath::ParallelQuery query("samples[*]/value");
+        query.setThreadCount(threads);
+
+        double sum = 0;
+        QBENCHMARK {
+            if (threads == 0) {
+                const auto arr = QJsonPath::get(doc, QJsonPath::Compiled("samples")).toArray();
+                QVector<QJsonValue> values;
+                values.reserve(arr.size());
+                double loopSum = 0;
+                for (const auto& sample : arr) {
+                    if (reduce)
+                        loopSum += QJsonPath::get(sample, value).toDouble();
+                    else
+                        values.append(QJsonPath::get(sample, value));
+                }
+                sum = reduce ? loopSum : values.size();
+            }
+            else
+                sum = reduce ? query.reduce(doc).sum : query.collect(doc).size();
+        }
+        QCOMPARE(sum, reduce ? 499500000.0 : 1000000.0);
+    }
+
+    void sweep_data()
+    {
+        QTest::addColumn<QString>("operation");
+        QTest::addColumn<int>("root");
+        QTest::addColumn<int>("width");
+        QTest::addColumn<int>("depth");
+        QTest::addColumn<int>("length");
+        QTest::addColumn<bool>("shared");
+        QTest::addColumn<bool>("listPath");
+
+        // every dimension is varied on its own, the others keep the base value
+        struct Shape
+        {
+            int width, depth, length;
+        };
+        const Shape base{ 16, 4, 16 };
+        QVector<Shape> shapes{ base };
+        for (int width : { 1, 1024, 16384 })
+            shapes.append({ width, base.depth, base.length });
+        for (int depth : { 1, 16, 64 })
+            shapes.append({ base.width, depth, base.length });
+        for (int length : { 1, 1024, 65536 })
+            shapes.append({ base.width, base.depth, length });
+
+        const char* const roots[] = { "document", "object", "array", "value" };
+        for (const auto& shape : shapes) {
+            const auto size = QString("w%1/d%2/l%3").arg(shape.width).arg(shape.depth).arg(shape.length);
+            for (const char* operation : { "get", "set", "remove" }) {
+                for (int root = SweepDocument; root <= SweepValue; root++) {
+                    for (bool shared : { false, true }) {
+                        for (bool listPath : { false, true }) {
+                            const auto tag = QStringList{ operation, roots[root], size, shared ? "shared" : "unshared", listPath ? "list" : "string" }.join('/');
+                            QTest::newRow(tag.toUtf8().constData()) << QString(operation) << root << shape.width << shape.depth << shape.length << shared << listPath;
+                        }
+                    }
+                }
+            }
+            const auto tag = QString("splitPath/%1").arg(size);
+            QTest::newRow(tag.toUtf8().constData()) << QString("splitPath") << int(SweepDocument) << shape.width << shape.depth << shape.length << false << false;
+        }
+    }
+
+    // get, set and remove over the document shape, the root type, a shared root and the path type, the data tags name the row in the results
+    void sweep()
+    {
+        QFETCH(QString, operation);
+        QFETCH(int, root);
+        QFETCH(int, width);
+        QFETCH(int, depth);
+        QFETCH(int, length);
+        QFETCH(bool, shared);
+        QFETCH(bool, listPath);
+        const auto list = sweepPath(width, depth, length, root == SweepArray);
+
+        if (operation == "splitPath") {
+            const QString path = pathString(list);
+            QVariantList result;
+            QBENCHMARK {
+                result = QJsonPath::splitPath(path);
+            }
+            QCOMPARE(result, list);
+            return;
+        }
+
+        const auto value = sweepDocument(width, depth, length, root == SweepArray);
+        if (root == SweepDocument) {
+            auto doc = QJsonDocument(value.toObject());
+            sweepRoot(doc, operation, shared, list, listPath);
+        }
+        else if (root == SweepObject) {
+            auto obj = value.toObject();
+            sweepRoot(obj, operation, shared, list, listPath);
+        }
+        else if (root == SweepArray) {
+            auto arr = value.toArray();
+            sweepRoot(arr, operation, shared, list, listPath);
+        }
+        else {
+            auto val = value;
+            sweepRoot(val, operation, shared, list, listPath);
+        }
+    }
+
+    void splitPath()
+    {
+        const QString path = deepPath();
+        QBENCHMARK {
+            QJsonPath::splitPath(path);
+        }
+    }
+
+    void compile()
+    {
+        const QString path = deepPath();
+        QBENCHMARK {
+            QJsonPath::Compiled compiled(path);
+        }
+    }
+};
+
+// benchmark results of a QTest XML log by function, data tag and metric, the values are per iteration
+static QMap<QString, double> _benchmark_readResults(const QString& fileName, QString& error)
+{
+    QMap<QString, double> results;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = QString("%1: %2").arg(fileName, file.errorString());
+        return results;
+    }
+    QXmlStreamReader xml(&file);
+    QString function;
+    while (!xml.atEnd()) {
+        if (xml.readNext() != QXmlStreamReader::StartElement)
+            continue;
+        const auto attributes = xml.attributes();
+        if (xml.name() == QLatin1String("TestFunction"))
+            function = attributes.value(QLatin1String("name")).toString();
+        else if (xml.name() == QLatin1String("BenchmarkResult")) {
+            const auto key = QString("%1/%2 %3").arg(function, attributes.value(QLatin1String("tag")).toString(), attributes.value(QLatin1String("metric")).toString());
+            results.insert(key, attributes.value(QLatin1String("value")).toDouble());
+        }
+    }
+    if (xml.hasError())
+        error = QString("%1: %2 at line %3").arg(fileName, xml.errorString()).arg(xml.lineNumber());
+    return results;
+}
+
+// prints before, after and their ratio for every benchmark, returns 1 if one of them got slower by more than the tolerance;
+// the ratio is after to before for times and counts, and before to after for throughputs (per second), where more is better
+static int _benchmark_compare(const QString& before, const QString& after, double tolerance)
+{
+    QString error;
+    const auto oldResults = _benchmark_readResults(before, error);
+    const auto newResults = _benchmark_readResults(after, error);
+    if (!error.isEmpty()) {
+        std::fprintf(stderr, "%s\n", qPrintable(error));
+        return 2;
+    }
+    int slower = 0;
+    for (auto it = newResults.constBegin(); it != newResults.constEnd(); ++it) {
+        const auto old = oldResults.constFind(it.key());
+        if (old == oldResults.constEnd()) {
+            std::printf("%s\t-\t%g\tnew\n", qPrintable(it.key()), it.value());
+            continue;
+        }
+        const bool throughput = it.key().endsWith(QLatin1String("PerSecond"));
+        const double ratio = throughput ? (it.value() > 0 ? old.value() / it.value() : 1) : (old.value() > 0 ? it.value() / old.value() : 1);
+        const bool regression = ratio > tolerance;
+        slower += regression;
+        std::printf("%s\t%g\t%g\t%.3f%s\n", qPrintable(it.key()), old.value(), it.value(), ratio, regression ? "\tSLOWER" : "");
+    }
+    std::printf("%d of %d benchmarks slower than %.2f times before\n", slower, int(newResults.size()), tolerance);
+    return slower ? 1 : 0;
+}
+
+// "qjsonpath_benchmark --compare before.xml after.xml [tolerance]" compares two runs written with "-o <file>,xml",
+// any other arguments are the usual QTest options
+int main(int argc, char** argv)
+{
+    if (argc >= 4 && qstrcmp(argv[1], "--compare") == 0)
+        return _benchmark_compare(QString::fromLocal8Bit(argv[2]), QString::fromLocal8Bit(argv[3]), argc > 4 ? std::atof(argv[4]) : 1.2);
+    QCoreApplication app(argc, argv);
+    QJsonPathBenchmark benchmark;
+    return QTest::qExec(&benchmark, argc, argv);
+}
+
+#include "benchmark.moc"
@@ -1,10 +1,314 @@
+// MIT License Copyright (C) 2023 heksbeks https://github.com/heksbeks/qjsonpath
+
+#include <QCommandLineParser>
 #include <QCoreApplication>
+#include <QFile>
+#include <QLocale>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include "qjsonpath.h"
 
+// Command line tool: prints the values of compiled paths for every line of JSON Lines (NDJSON) files or for whole JSON documents.
+// A file is memory mapped and split at line boundaries into chunks, the chunks are evaluated by worker threads which take
+// the next free chunk when they are done, and the outputs are written in input order.
+
+static const int _cli_chunkSize = 1 << 20;
+
+// compact JSON text of a value, a missing value is empty
+static void _cli_appendValue(QByteArray& out, const QJsonValue& value)
+{
+    switch (value.type()) {
+    case QJsonValue::Undefined:
+        return;
+    case QJsonValue::Null:
+        out += "null";
+        return;
+    case QJsonValue::Bool:
+        out += value.toBool() ? "true" : "false";
+        return;
+    case QJsonValue::Object:
+        out += QJsonDocument(value.toObject()).toJson(QJsonDocument::Compact);
+        return;
+    case QJsonValue::Array:
+        out += QJsonDocument(value.toArray()).toJson(QJsonDocument::Compact);
+        return;
+    case QJsonValue::Double: {
+        // the number format of QJsonDocument: integers as integers, others as the shortest text that reads back exactly
+        const double d = value.toDouble();
+        if (!qIsFinite(d))
+            break;
+        if (qAbs(d) < 1e15 && d == double(qint64(d))) // the range first, the conversion of a larger value is undefined
+            out += QByteArray::number(qint64(d));
+        else if (d == std::floor(d))
+            break; // a large integer, e.g. a qint64 of the extractor, is written exactly by QJsonDocument and not in exponent form
+        else
+            out += QByteArray::number(d, 'g', QLocale::FloatingPointShortest);
+        return;
+    }
+    case QJsonValue::String: {
+        const auto text = value.toString().toUtf8();
+        bool plain = true;
+        for (const char c : text)
+            plain = plain && c != '"' && c != '\\' && uchar(c) >= 0x20;
+        if (plain) {
+            out += '"';
+            out += text;
+            out += '"';
+            return;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    // escaped strings are written by QJsonDocument as the element of an array
+    const auto text = QJsonDocument(QJsonArray{ value }).toJson(QJsonDocument::Compact);
+    out.append(text.constData() + 1, int(text.size()) - 2);
+}
+
+// one tab separated line of values
+static void _cli_appendValues(QByteArray& out, const QVector<QJsonValue>& values)
+{
+    for (int p = 0; p < values.size(); p++) {
+        if (p)
+            out += '\t';
+        _cli_appendValue(out, values[p]);
+    }
+    out += '\n';
+}
+
+struct _CliError
+{
+    int line; // line in the chunk
+    QString message;
+};
+
+struct _CliChunk
+{
+    const char* begin;
+    const char* end;
+    QByteArray output;
+    QVector<_CliError> errors;
+    int lines = 0;
+    bool done = false;
+};
+
+// chunks of one file, shared by the worker threads and the writer
+struct _CliJob
+{
+    _CliJob(const QVector<QJsonPath::Compiled>& paths, int window) : paths(paths), window(window) {}
+
+    const QVector<QJsonPath::Compiled>& paths;
+    QVector<_CliChunk> chunks;
+    int window;      // chunks evaluated ahead of the writer, bounds the memory of the outputs
+    int next = 0;    // next chunk to evaluate
+    int written = 0; // chunks written
+    QMutex mutex;
+    QWaitCondition chunkDone;
+    QWaitCondition chunkWritten;
+
+    void evaluate(_CliChunk& chunk, QJsonPath::Extractor& extractor, QVector<QJsonValue>& values)
+    {
+        const QVector<QJsonValue> missing(paths.size(), QJsonValue(QJsonValue::Undefined));
+        const char* line = chunk.begin;
+        while (line < chunk.end) {
+            const char* newline = static_cast<const char*>(std::memchr(line, '\n', size_t(chunk.end - line)));
+            const char* lineEnd = newline ? newline : chunk.end;
+            chunk.lines++;
+            const char* text = line;
+            while (text < lineEnd && (*text == ' ' || *text == '\t' || *text == '\r'))
+                text++;
+            // an empty or invalid line prints a row of missing values, so the rows of stdout match the input lines
+            if (text == lineEnd)
+                _cli_appendValues(chunk.output, missing);
+            else if (lineEnd - text > INT_MAX) {
+                chunk.errors.append({ chunk.lines, QStringLiteral("line too large") });
+                _cli_appendValues(chunk.output, missing);
+            }
+            else if (extractor.extract(text, int(lineEnd - text), values))
+                _cli_appendValues(chunk.output, values);
+            else {
+                chunk.errors.append({ chunk.lines, extractor.errorString() });
+                _cli_appendValues(chunk.output, missing);
+            }
+            line = lineEnd + 1;
+        }
+    }
+
+    // worker thread: evaluates free chunks until all are taken
+    void work()
+    {
+        QJsonPath::Extractor extractor(paths);
+        QVector<QJsonValue> values;
+        for (;;) {
+            int i;
+            {
+                QMutexLocker locker(&mutex);
+                while (next < chunks.size() && next >= written + window)
+                    chunkWritten.wait(&mutex);
+                if (next >= chunks.size())
+                    return;
+                i = next++;
+            }
+            evaluate(chunks[i], extractor, values);
+            QMutexLocker locker(&mutex);
+            chunks[i].done = true;
+            chunkDone.wakeAll();
+        }
+    }
+};
+
+class _CliWorker : public QRunnable
+{
+public:
+    explicit _CliWorker(_CliJob& job) : m_job(job) {}
+    void run() override { m_job.work(); }
+
+private:
+    _CliJob& m_job;
+};
+
+// evaluates the paths on every line of data, returns false if a line is not valid JSON
+static bool _cli_lines(const char* data, qint64 size, const QString& name, const QVector<QJsonPath::Compiled>& paths, int threads)
+{
+    _CliJob job(paths, 4 * threads);
+    for (qint64 pos = 0; pos < size;) {
+        qint64 end = qMin(pos + _cli_chunkSize, size);
+        if (end < size) {
+            const char* newline = static_cast<const char*>(std::memchr(data + end, '\n', size_t(size - end)));
+            end = newline ? newline - data + 1 : size;
+        }
+        _CliChunk chunk;
+        chunk.begin = data + pos;
+        chunk.end = data + end;
+        job.chunks.append(chunk);
+        pos = end;
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    for (int t = 0; t < qMin(threads, int(job.chunks.size())); t++)
+        pool.start(new _CliWorker(job));
+
+    bool ok = true;
+    qint64 lines = 0;
+    for (int i = 0; i < job.chunks.size(); i++) {
+        auto& chunk = job.chunks[i];
+        {
+            QMutexLocker locker(&job.mutex);
+            while (!chunk.done)
+                job.chunkDone.wait(&job.mutex);
+        }
+        std::fwrite(chunk.output.constData(), 1, size_t(chunk.output.size()), stdout);
+        for (const auto& error : chunk.errors) {
+            std::fprintf(stderr, "%s:%lld: %s\n", qPrintable(name), lines + error.line, qPrintable(error.message));
+            ok = false;
+        }
+        lines += chunk.lines;
+        chunk.output = QByteArray();
+        QMutexLocker locker(&job.mutex);
+        job.written = i + 1;
+        job.chunkWritten.wakeAll();
+    }
+    pool.waitForDone();
+    return ok;
+}
+
+static bool _cli_document(const char* data, qint64 size, const QString& name, const QVector<QJsonPath::Compiled>& paths)
+{
+    QJsonPath::Extractor extractor(paths);
+    QVector<QJsonValue> values;
+    if (size > INT_MAX || !extractor.extract(data, int(size), values)) {
+        std::fprintf(stderr, "%s: %s\n", qPrintable(name), size > INT_MAX ? "document too large" : qPrintable(extractor.errorString()));
+        return false;
+    }
+    QByteArray out;
+    _cli_appendValues(out, values);
+    std::fwrite(out.constData(), 1, size_t(out.size()), stdout);
+    return true;
+}
+
 int main(int argc, char *argv[])
 {
     QCoreApplication a(argc, argv);
-    QJsonPath::unittest();
+    QCoreApplication::setApplicationName("qjsonpath");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Prints the values of JSON paths, tab separated, for every line of JSON Lines files or for whole JSON documents.");
+    parser.addHelpOption();
+    const QCommandLineOption pathOption({ "p", "path" }, "Path to print, can be given more than once.", "path");
+    const QCommandLineOption documentOption({ "d", "document" }, "Each file is a single JSON document instead of JSON Lines.");
+    const QCommandLineOption threadsOption({ "j", "threads" }, "Number of worker threads (default: number of cores).", "count");
+    const QCommandLineOption separatorOption({ "s", "separator" }, "Path separator (default: '/').", "char");
+    const QCommandLineOption unittestOption("unittest", "Runs the unit test of QJsonPath.");
+    parser.addOptions({ pathOption, documentOption, threadsOption, separatorOption, unittestOption });
+    parser.addPositionalArgument("files", "Input files, standard input if none or '-'.", "[files...]");
+    parser.process(a);
+
+    if (parser.isSet(unittestOption)) {
+        QJsonPath::unittest();
+        return 0;
+    }
+    if (!parser.isSet(pathOption)) {
+        std::fprintf(stderr, "qjsonpath: no path given, see --help\n");
+        return 2;
+    }
+    if (parser.isSet(separatorOption)) {
+        const auto separator = parser.value(separatorOption);
+        if (separator.size() != 1) {
+            std::fprintf(stderr, "qjsonpath: the separator must be a single character\n");
+            return 2;
+        }
+        QJsonPath::setSeparator(separator[0]);
+    }
+    QVector<QJsonPath::Compiled> paths;
+    for (const auto& path : parser.values(pathOption))
+        paths.append(QJsonPath::Compiled(path));
+    const int threads = parser.isSet(threadsOption) ? qMax(1, parser.value(threadsOption).toInt()) : qMax(1, QThread::idealThreadCount());
 
-    return a.exec();
+    auto files = parser.positionalArguments();
+    if (files.isEmpty())
+        files.append("-");
+    bool ok = true;
+    for (const auto& name : files) {
+        QFile file;
+        QByteArray buffer;
+        const char* data = nullptr;
+        qint64 size = 0;
+        if (name == "-") {
+            file.open(stdin, QIODevice::ReadOnly);
+            buffer = file.readAll();
+            data = buffer.constData();
+            size = buffer.size();
+        }
+        else {
+            file.setFileName(name);
+            if (!file.open(QIODevice::ReadOnly)) {
+                std::fprintf(stderr, "qjsonpath: cannot open %s: %s\n", qPrintable(name), qPrintable(file.errorString()));
+                ok = false;
+                continue;
+            }
+            size = file.size();
+            data = size ? reinterpret_cast<const char*>(file.map(0, size)) : nullptr;
+            if (!data) { // not mappable, e.g. a pipe
+                buffer = file.readAll();
+                data = buffer.constData();
+                size = buffer.size();
+            }
+        }
+        if (parser.isSet(documentOption))
+            ok = _cli_document(data, size, name, paths) && ok;
+        else
+            ok = _cli_lines(data, size, name, paths, threads) && ok;
+    }
+    std::fflush(stdout);
+    return ok ? 0 : 1;
 }
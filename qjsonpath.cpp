@@ -1,169 +1,367 @@
 // MIT License Copyright (C) 2023 heksbeks https://github.com/heksbeks/qjsonpath
 
 #include "qjsonpath.h"
+#include "qjsonpath_p.h"
 #include <QJsonArray>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSet>
+#include <QSharedPointer>
+#include <QVarLengthArray>
+#include <atomic>
+#include <limits>
 
 
-//#define DEBUG_HANDLE_JSON_ATTRIBUTE
+// separator of path strings compiled without an explicit one, atomic so setSeparator does not race with readers on other threads
+static std::atomic<ushort> _handleJsonAttribute_separator('/');
 
-enum class HANDLE_JSON_OP
-{
-    SET,
-    GET,
-    REMOVE,
-};
-
-QChar _handleJsonAttribute_separator('/');
+// Instrumentation: the engine counts into a record only while a callback is registered and the operation is sampled,
+// otherwise an operation costs one relaxed atomic load and null checks of the record. Operations are counted for the
+// sampling per thread, a shared counter would be a cache line written by every thread on every operation.
+static std::atomic<bool> _handleJsonAttribute_statsEnabled(false);
+static thread_local quint64 _handleJsonAttribute_statsOperations = 0;
+static std::atomic<int> _handleJsonAttribute_statsSampling(1);
+static QMutex _handleJsonAttribute_statsMutex;
+static QSharedPointer<QJsonPath::StatsCallback> _handleJsonAttribute_statsCallback;
 
-static void __handleJsonAttribute(QJsonValue& value, const QVariantList& path, const QJsonValue& newValue, HANDLE_JSON_OP op)
+// record of one operation, passed to the callback when it goes out of scope
+class _OperationRecorder
 {
-    if (path[0].userType() == QMetaType::Type::QString) {
-        if (!value.isObject()) {
-            if (op == HANDLE_JSON_OP::SET)
-                value = QJsonObject();
-            else if (op == HANDLE_JSON_OP::GET) {
-                value = QJsonValue(QJsonValue::Undefined);
-                return;
-            }
-            else if (op == HANDLE_JSON_OP::REMOVE)
-                return;
+public:
+    _OperationRecorder(QJsonPath::OperationStats::Operation operation, const QJsonPath::Compiled& path)
+    {
+        if (Q_LIKELY(!_handleJsonAttribute_statsEnabled.load(std::memory_order_relaxed)))
+            return;
+        const auto sampling = quint64(_handleJsonAttribute_statsSampling.load(std::memory_order_relaxed));
+        if (_handleJsonAttribute_statsOperations++ % sampling)
+            return;
+        {
+            QMutexLocker locker(&_handleJsonAttribute_statsMutex);
+            m_callback = _handleJsonAttribute_statsCallback;
         }
+        if (!m_callback)
+            return;
+        m_stats.operation = operation;
+        m_stats.depth = path.size();
+        m_timer.start();
     }
-    else if (path[0].userType() == QMetaType::Type::Int) {
-        if (!value.isArray()) {
-            if (op == HANDLE_JSON_OP::SET)
-                value = QJsonArray();
-            else if (op == HANDLE_JSON_OP::GET) {
-                value = QJsonValue(QJsonValue::Undefined);
-                return;
-            }
-            else if (op == HANDLE_JSON_OP::REMOVE)
-                return;
-        }
+    ~_OperationRecorder()
+    {
+        if (!m_callback)
+            return;
+        m_stats.nanoseconds = m_timer.nsecsElapsed();
+        (*m_callback)(m_stats);
     }
+    QJsonPath::OperationStats* stats() { return m_callback ? &m_stats : nullptr; }
+
+private:
+    QSharedPointer<QJsonPath::StatsCallback> m_callback;
+    QJsonPath::OperationStats m_stats;
+    QElapsedTimer m_timer;
+};
+
+// Mutation engine: every container is taken out of its holder before it is modified, so it is the only reference
+// and changes are made inplace. Copying and writing back a container on every level would duplicate all ancestors.
+// newValue is moved into the tree by SET and receives the value taken out by TAKE and BORROW, stats is null if the operation is not recorded.
+// REMOVE and TAKE pass the positions of the path found by _handleJsonAttribute_locate, they are followed without looking a key up again.
+static void __handleJsonAttribute(QJsonValue& value, const QJsonPath::Compiled& path, int pos, QJsonValue& newValue, HANDLE_JSON_OP op, QJsonPath::OperationStats* stats, const int* positions);
+
+// missing containers on the path are created
+static inline bool _handleJsonAttribute_creates(HANDLE_JSON_OP op)
+{
+    return op == HANDLE_JSON_OP::SET || op == HANDLE_JSON_OP::BORROW;
+}
+
+// token at pos must be a key
+static void __handleJsonAttribute(QJsonObject& obj, const QJsonPath::Compiled& path, int pos, QJsonValue& newValue, HANDLE_JSON_OP op, QJsonPath::OperationStats* stats, const int* positions)
+{
+    QJsonObject::iterator it;
+    if (positions)
+        it = obj.begin() + positions[pos]; // the lookup counted the node
     else {
-        Q_ASSERT_X(path[0].userType() == QMetaType::Type::QString || path[0].userType() == QMetaType::Type::Int, __FUNCTION__, QString("invalid path type '%1'").arg(path[0].userType()).toUtf8());
-        return;
+        if (stats)
+            stats->nodes++;
+        const auto& keyName = path.key(pos);
+        it = obj.find(keyName);
+        if (it == obj.end())
+            it = obj.insert(keyName, QJsonValue());
     }
+    if (stats)
+        stats->modified++;
 
-    if (value.isObject()) {
-        auto obj = value.toObject();
-        auto keyName = path[0].toString();
-        if (op == HANDLE_JSON_OP::GET) {
-            if (!obj.contains(keyName)) {
-                value = QJsonValue(QJsonValue::Undefined);
-                return;
-            }
+    if (pos + 1 >= path.size()) {
+        if (op == HANDLE_JSON_OP::SET) {
+            *it = newValue;
+            newValue = QJsonValue(); // the tree holds the only reference now
         }
-        else if (op == HANDLE_JSON_OP::REMOVE) {
-            if (!obj.contains(keyName))
-                return;
+        else if (op == HANDLE_JSON_OP::BORROW) {
+            newValue = it.value();
+            *it = QJsonValue(); // newValue holds the only reference now
         }
-        QJsonValue subValue = obj[keyName];
-        if (path.size() > 1)
-            __handleJsonAttribute(subValue, path.mid(1), newValue, op);
-        else if (op == HANDLE_JSON_OP::SET)
-            subValue = newValue;
-        else if (op == HANDLE_JSON_OP::REMOVE) {
-            if (obj.contains(keyName)) {
-                obj.remove(keyName);
-                value = obj;
-            }
-            return;
-        }
-        if (op == HANDLE_JSON_OP::SET || op == HANDLE_JSON_OP::REMOVE) {
-            obj[keyName] = subValue;
-            value = obj;
+        else {
+            if (op == HANDLE_JSON_OP::TAKE)
+                newValue = it.value();
+            obj.erase(it);
         }
-        else if (op == HANDLE_JSON_OP::GET)
-            value = subValue;
         return;
     }
-    else if (value.isArray()) {
-        auto arr = value.toArray();
-        int idx = path[0].toInt();
+
+    QJsonValue subValue = *it;
+    *it = QJsonValue(); // take the child out, subValue holds the only reference now
+    __handleJsonAttribute(subValue, path, pos + 1, newValue, op, stats, positions);
+    *it = subValue;
+}
+
+// token at pos must be an index or "[+]"
+static void __handleJsonAttribute(QJsonArray& arr, const QJsonPath::Compiled& path, int pos, QJsonValue& newValue, HANDLE_JSON_OP op, QJsonPath::OperationStats* stats, const int* positions)
+{
+    int idx;
+    if (positions)
+        idx = positions[pos]; // the lookup counted the node
+    else {
+        if (stats)
+            stats->nodes++;
+        idx = path.type(pos) == QJsonPath::Compiled::Append ? int(arr.size()) : path.index(pos);
         if (idx < 0)
             idx = arr.size() ? arr.size() + idx : 0; // -1 is last element
+        if (idx < 0) // counts down beyond the first element
+            return;
+        if (stats && idx >= arr.size())
+            stats->padding += idx - int(arr.size());
+        while (idx >= arr.size())
+            arr.append(QJsonValue());
+    }
+    if (stats)
+        stats->modified++;
+
+    if (pos + 1 >= path.size()) {
         if (op == HANDLE_JSON_OP::SET) {
-            while (idx >= arr.size())
-                arr.append(QJsonValue());
+            arr.replace(idx, newValue);
+            newValue = QJsonValue();
         }
-        else if (op == HANDLE_JSON_OP::GET) {
-            if (idx < 0 || idx >= arr.size()) {
-                value = QJsonValue(QJsonValue::Undefined);
-                return;
-            }
+        else if (op == HANDLE_JSON_OP::BORROW) {
+            newValue = arr.at(idx);
+            arr.replace(idx, QJsonValue());
         }
-        else if (op == HANDLE_JSON_OP::REMOVE) {
-            if (idx < 0 || idx >= arr.size())
-                return;
-        }
-        QJsonValue subValue = arr[idx];
-        if (path.size() > 1)
-            __handleJsonAttribute(subValue, path.mid(1), newValue, op);
-        else if (op == HANDLE_JSON_OP::SET)
-            subValue = newValue;
-        else if (op == HANDLE_JSON_OP::REMOVE) {
+        else if (op == HANDLE_JSON_OP::TAKE)
+            newValue = arr.takeAt(idx);
+        else
             arr.removeAt(idx);
-            value = arr;
-            return;
+        return;
+    }
+
+    QJsonValue subValue = arr.at(idx);
+    arr.replace(idx, QJsonValue()); // take the child out, subValue holds the only reference now
+    __handleJsonAttribute(subValue, path, pos + 1, newValue, op, stats, positions);
+    arr.replace(idx, subValue);
+}
+
+static void __handleJsonAttribute(QJsonValue& value, const QJsonPath::Compiled& path, int pos, QJsonValue& newValue, HANDLE_JSON_OP op, QJsonPath::OperationStats* stats, const int* positions)
+{
+    const auto type = path.type(pos);
+    if (type == QJsonPath::Compiled::Key) {
+        if (stats && !value.isObject())
+            stats->created++;
+        auto obj = value.isObject() ? value.toObject() : QJsonObject();
+        value = QJsonValue(); // obj holds the only reference now
+        __handleJsonAttribute(obj, path, pos, newValue, op, stats, positions);
+        value = std::move(obj);
+    }
+    else if (type == QJsonPath::Compiled::Index || type == QJsonPath::Compiled::Append) {
+        if (stats && !value.isArray())
+            stats->created++;
+        auto arr = value.isArray() ? value.toArray() : QJsonArray();
+        value = QJsonValue(); // arr holds the only reference now
+        __handleJsonAttribute(arr, path, pos, newValue, op, stats, positions);
+        value = std::move(arr);
+    }
+    else
+        Q_ASSERT_X(type == QJsonPath::Compiled::Key || type == QJsonPath::Compiled::Index, __FUNCTION__, QString("invalid path type at position %1").arg(pos).toUtf8());
+}
+
+
+// read only lookup, only const functions are used on the containers so nothing is detached or copied
+static QJsonValue __getJsonAttribute(QJsonValue value, const QJsonPath::Compiled& path, int pos, QJsonPath::OperationStats* stats)
+{
+    for (; pos < path.size(); pos++) {
+        const auto type = path.type(pos);
+        if (type == QJsonPath::Compiled::Key) {
+            if (!value.isObject())
+                return QJsonValue(QJsonValue::Undefined);
+            if (stats)
+                stats->nodes++;
+            const auto obj = value.toObject();
+            const auto it = obj.constFind(path.key(pos));
+            if (it == obj.constEnd())
+                return QJsonValue(QJsonValue::Undefined);
+            value = it.value();
         }
-        if (op == HANDLE_JSON_OP::SET || op == HANDLE_JSON_OP::REMOVE) {
-            arr[idx] = subValue;
-            value = arr;
+        else if (type == QJsonPath::Compiled::Index) {
+            if (!value.isArray())
+                return QJsonValue(QJsonValue::Undefined);
+            if (stats)
+                stats->nodes++;
+            const auto arr = value.toArray();
+            int idx = path.index(pos);
+            if (idx < 0)
+                idx = arr.size() + idx; // -1 is last element
+            if (idx < 0 || idx >= arr.size())
+                return QJsonValue(QJsonValue::Undefined);
+            value = arr.at(idx);
+        }
+        else if (type == QJsonPath::Compiled::Append)
+            return QJsonValue(QJsonValue::Undefined); // the element after the last one does not exist
+        else {
+            Q_ASSERT_X(type == QJsonPath::Compiled::Key || type == QJsonPath::Compiled::Index, __FUNCTION__, QString("invalid path type at position %1").arg(pos).toUtf8());
+            return value;
         }
-        else if (op == HANDLE_JSON_OP::GET)
-            value = subValue;
-        return;
     }
+    return value;
+}
 
-    qDebug() << "fatal error in " __FUNCTION__ ": unknown type" << value;
-    Q_ASSERT_X(value.isObject() || value.isArray(), __FUNCTION__, "unknown type");
+static QJsonValue _getJsonAttribute(const QJsonObject& obj, const QJsonPath::Compiled& path, QJsonPath::OperationStats* stats)
+{
+    if (path.isEmpty())
+        return obj;
+    if (path.type(0) != QJsonPath::Compiled::Key)
+        return __getJsonAttribute(obj, path, 0, stats);
+    if (stats)
+        stats->nodes++;
+    const auto it = obj.constFind(path.key(0));
+    if (it == obj.constEnd())
+        return QJsonValue(QJsonValue::Undefined);
+    return __getJsonAttribute(it.value(), path, 1, stats);
+}
+
+static QJsonValue _getJsonAttribute(const QJsonArray& arr, const QJsonPath::Compiled& path, QJsonPath::OperationStats* stats)
+{
+    if (path.isEmpty())
+        return arr;
+    if (path.type(0) != QJsonPath::Compiled::Index)
+        return __getJsonAttribute(arr, path, 0, stats);
+    if (stats)
+        stats->nodes++;
+    int idx = path.index(0);
+    if (idx < 0)
+        idx = arr.size() + idx; // -1 is last element
+    if (idx < 0 || idx >= arr.size())
+        return QJsonValue(QJsonValue::Undefined);
+    return __getJsonAttribute(arr.at(idx), path, 1, stats);
 }
 
 
-static void _handleJsonAttribute(QJsonValue& value, const QVariantList& path, const QJsonValue& newValue, HANDLE_JSON_OP op)
+// Remove and take look the path up with const functions only and record the position of every token, so a path that does
+// not exist returns before a container is changed; changing it first would detach and copy a shared ancestor. The change
+// then follows the positions without looking a key up again. The containers entered by the lookup are counted as nodes.
+using _JsonPositions = QVarLengthArray<int, 16>;
+
+static bool _handleJsonAttribute_locate(QJsonValue value, const QJsonPath::Compiled& path, _JsonPositions& positions, QJsonPath::OperationStats* stats)
 {
-    __handleJsonAttribute(value, path, newValue, op);
+    for (int pos = 0; pos < path.size(); pos++) {
+        const auto type = path.type(pos);
+        if (type == QJsonPath::Compiled::Key) {
+            if (!value.isObject())
+                return false;
+            if (stats)
+                stats->nodes++;
+            const auto obj = value.toObject();
+            const auto it = obj.constFind(path.key(pos));
+            if (it == obj.constEnd())
+                return false;
+            positions.append(int(it - obj.constBegin()));
+            value = it.value();
+        }
+        else if (type == QJsonPath::Compiled::Index) {
+            if (!value.isArray())
+                return false;
+            if (stats)
+                stats->nodes++;
+            const auto arr = value.toArray();
+            int idx = path.index(pos);
+            if (idx < 0)
+                idx = int(arr.size()) + idx; // -1 is last element
+            if (idx < 0 || idx >= arr.size())
+                return false;
+            positions.append(idx);
+            value = arr.at(idx);
+        }
+        else
+            return false; // "[+]" is never found
+    }
+    return true;
+}
 
-#ifdef DEBUG_HANDLE_JSON_ATTRIBUTE
-    if (op != HANDLE_JSON_OP::GET) {
-        qDebug() << (op == HANDLE_JSON_OP::SET ? "QJsonPath::set" : "QJsonPath::remove") << "path=" << path << "newValue=" << newValue;
-        auto doc = value.isArray() ? QJsonDocument(value.toArray()) : QJsonDocument(value.toObject());
-        qDebug().noquote() << QString::fromUtf8(doc.toJson(QJsonDocument::Indented));
+static void _handleJsonAttribute(QJsonValue& value, const QJsonPath::Compiled& path, QJsonValue& newValue, HANDLE_JSON_OP op, QJsonPath::OperationStats* stats)
+{
+    if (path.isEmpty())
+        return;
+    if (_handleJsonAttribute_creates(op)) {
+        __handleJsonAttribute(value, path, 0, newValue, op, stats, nullptr);
+        return;
     }
-#endif
+    _JsonPositions positions;
+    if (_handleJsonAttribute_locate(value, path, positions, stats))
+        __handleJsonAttribute(value, path, 0, newValue, op, stats, positions.constData());
 }
 
-static void _handleJsonAttribute(QJsonObject& obj, const QVariantList& path, const QJsonValue& newValue, HANDLE_JSON_OP op)
+static void _handleJsonAttribute(QJsonObject& obj, const QJsonPath::Compiled& path, QJsonValue& newValue, HANDLE_JSON_OP op, QJsonPath::OperationStats* stats)
 {
+    if (path.isEmpty())
+        return;
+
+    if (path.type(0) == QJsonPath::Compiled::Key) {
+        if (_handleJsonAttribute_creates(op)) {
+            __handleJsonAttribute(obj, path, 0, newValue, op, stats, nullptr);
+            return;
+        }
+        _JsonPositions positions;
+        if (_handleJsonAttribute_locate(obj, path, positions, stats))
+            __handleJsonAttribute(obj, path, 0, newValue, op, stats, positions.constData());
+        return;
+    }
+
     QJsonValue val = obj;
-    _handleJsonAttribute(val, path, newValue, op);
+    _handleJsonAttribute(val, path, newValue, op, stats);
     if (!val.isArray()) // an array cannot be converted to a QJsonObject
         obj = val.toObject();
     else
         Q_ASSERT_X(!val.isArray(), __FUNCTION__, QString("invalid result type '%1', path must result to an root object").arg(val.type()).toUtf8());
 }
 
-static void _handleJsonAttribute(QJsonArray& arr, const QVariantList& path, const QJsonValue& newValue, HANDLE_JSON_OP op)
+static void _handleJsonAttribute(QJsonArray& arr, const QJsonPath::Compiled& path, QJsonValue& newValue, HANDLE_JSON_OP op, QJsonPath::OperationStats* stats)
 {
+    if (path.isEmpty())
+        return;
+
+    if (path.type(0) == QJsonPath::Compiled::Index || path.type(0) == QJsonPath::Compiled::Append) {
+        if (_handleJsonAttribute_creates(op)) {
+            __handleJsonAttribute(arr, path, 0, newValue, op, stats, nullptr);
+            return;
+        }
+        _JsonPositions positions;
+        if (_handleJsonAttribute_locate(arr, path, positions, stats))
+            __handleJsonAttribute(arr, path, 0, newValue, op, stats, positions.constData());
+        return;
+    }
+
     QJsonValue val = arr;
-    _handleJsonAttribute(val, path, newValue, op);
+    _handleJsonAttribute(val, path, newValue, op, stats);
     if (val.isArray()) // an object cannot be converted to a QJsonArray
         arr = val.toArray();
     else
         Q_ASSERT_X(val.isArray(), __FUNCTION__, QString("invalid result type '%1', path must result to a root array").arg(val.type()).toUtf8());
 }
 
-static void _handleJsonAttribute(QJsonDocument& doc, const QVariantList& path, const QJsonValue& newValue, HANDLE_JSON_OP op)
+static void _handleJsonAttribute(QJsonDocument& doc, const QJsonPath::Compiled& path, QJsonValue& newValue, HANDLE_JSON_OP op, QJsonPath::OperationStats* stats)
 {
     QJsonValue val;
     if (doc.isArray())
         val = doc.array();
     else
         val = doc.object();
+    doc = QJsonDocument(); // val holds the only reference now
 
-    _handleJsonAttribute(val, path, newValue, op);
+    _handleJsonAttribute(val, path, newValue, op, stats);
 
     if (val.isArray())
         doc = QJsonDocument(val.toArray());
@@ -172,108 +370,555 @@ static void _handleJsonAttribute(QJsonDocument& doc, const QVariantList& path, c
 }
 
 
+void QJsonPath::setStatsCallback(const StatsCallback& callback, int sampling)
+{
+    QMutexLocker locker(&_handleJsonAttribute_statsMutex);
+    _handleJsonAttribute_statsCallback = callback ? QSharedPointer<StatsCallback>::create(callback) : QSharedPointer<StatsCallback>();
+    _handleJsonAttribute_statsSampling.store(qMax(1, sampling), std::memory_order_relaxed);
+    _handleJsonAttribute_statsEnabled.store(bool(callback), std::memory_order_relaxed);
+}
+
+void QJsonPath::Statistics::add(const OperationStats& stats)
+{
+    count[stats.operation]++;
+    nodes += stats.nodes;
+    modified += stats.modified;
+    created += stats.created;
+    padding += stats.padding;
+    int bucket = 0;
+    while (bucket < 63 && stats.nanoseconds >= (qint64(1) << bucket))
+        bucket++;
+    histogram[bucket]++;
+}
+
+qint64 QJsonPath::Statistics::percentile(double fraction) const
+{
+    const qint64 total = count[0] + count[1] + count[2];
+    if (!total)
+        return 0;
+    const qint64 rank = qMax<qint64>(1, qint64(fraction * double(total) + 0.5));
+    qint64 seen = 0;
+    for (int bucket = 0; bucket < 64; bucket++) {
+        seen += histogram[bucket];
+        if (seen >= rank)
+            return bucket < 63 ? qint64(1) << bucket : std::numeric_limits<qint64>::max();
+    }
+    return std::numeric_limits<qint64>::max();
+}
+
+
+// keys of compiled paths share their string data, the pool is limited so dynamically built paths cannot grow it forever;
+// every thread has its own pool, so compiling a path takes no lock
+static const int _handleJsonAttribute_internLimit = 4096;
+
+static QString _handleJsonAttribute_intern(const QString& key)
+{
+    static thread_local QSet<QString> pool;
+    auto it = pool.constFind(key);
+    if (it != pool.constEnd())
+        return *it;
+    if (pool.size() < _handleJsonAttribute_internLimit)
+        pool.insert(key);
+    return key;
+}
+
+// parses a path string, calls onKey(QString) for attribute names, onIndex(int) for array indexes and onAppend() for "[+]"
+template <class KeyFn, class IndexFn, class AppendFn> static void _handleJsonAttribute_parsePath(const QString& path, QChar separator, KeyFn onKey, IndexFn onIndex, AppendFn onAppend)
+{
+    const QChar bracketOpen('['), bracketClose(']');
+    int i=0, i0_name=0, i0_idx=-1;
+    for (; i < path.size(); i++) {
+        if (path[i] == separator) {
+            if (i0_name >= 0)
+                onKey(path.mid(i0_name, i - i0_name));
+            i0_name = i+1;
+            i0_idx = -1;
+        }
+        else if (path[i] == bracketOpen)
+            i0_idx = i+1;
+        else if (path[i] == bracketClose && i0_idx > 0) {
+            auto sIdx = path.mid(i0_idx, i - i0_idx);
+            bool ok;
+            int idx = sIdx.toInt(&ok);
+            const bool append = sIdx == QLatin1String("+");
+            if (ok || append) {
+                int n = i0_idx-1 - i0_name;
+                if (i0_name >= 0 && n > 0)
+                    onKey(path.mid(i0_name, n));
+                if (append)
+                    onAppend();
+                else
+                    onIndex(idx);
+                i0_name = -1;
+                i0_idx = -1;
+            }
+        }
+    }
+    if (i0_name >= 0)
+        onKey(path.mid(i0_name, i - i0_name));
+}
+
+
+QJsonPath::Compiled::Compiled(const QString& path)
+    : Compiled(path, QJsonPath::separator())
+{
+}
+
+QJsonPath::Compiled::Compiled(const QString& path, QChar separator)
+{
+    parse(path, separator, true);
+}
+
+QJsonPath::Compiled::Compiled(const QVariantList& path)
+{
+    parse(path, true);
+}
+
+QJsonPath::Compiled::Compiled(const QString& path, Temporary)
+{
+    parse(path, QJsonPath::separator(), false);
+}
+
+QJsonPath::Compiled::Compiled(const QVariantList& path, Temporary)
+{
+    parse(path, false);
+}
+
+void QJsonPath::Compiled::parse(const QString& path, QChar separator, bool intern)
+{
+    _handleJsonAttribute_parsePath(path, separator,
+        [this, intern](const QString& key) { m_tokens.append({ intern ? _handleJsonAttribute_intern(key) : key, 0, Key }); },
+        [this](int idx) { m_tokens.append({ QString(), idx, Index }); },
+        [this]() { m_tokens.append({ QString(), 0, Append }); });
+}
+
+void QJsonPath::Compiled::parse(const QVariantList& path, bool intern)
+{
+    m_tokens.reserve(path.size());
+    for (const auto& p : path) {
+        if (p.userType() == QMetaType::Type::QString)
+            m_tokens.append({ intern ? _handleJsonAttribute_intern(p.toString()) : p.toString(), 0, Key });
+        else if (p.userType() == QMetaType::Type::Int)
+            m_tokens.append({ QString(), p.toInt(), Index });
+        else if (!p.isValid())
+            m_tokens.append({ QString(), 0, Append }); // "[+]" as written by splitPath
+        else
+            m_tokens.append({ QString(), 0, Invalid });
+    }
+}
+
+QVariantList QJsonPath::Compiled::toVariantList() const
+{
+    QVariantList p;
+    p.reserve(m_tokens.size());
+    for (const auto& t : m_tokens) {
+        if (t.type == Key)
+            p << t.key;
+        else if (t.type == Index)
+            p << t.index;
+        else if (t.type == Append)
+            p << QVariant();
+        else
+            p << QVariant(false); // unsupported as well, so it stays invalid
+    }
+    return p;
+}
+
+bool QJsonPath::Compiled::operator==(const Compiled& other) const
+{
+    if (m_tokens.size() != other.m_tokens.size())
+        return false;
+    for (int i = 0; i < m_tokens.size(); i++) {
+        const auto& a = m_tokens[i];
+        const auto& b = other.m_tokens[i];
+        if (a.type != b.type || (a.type == Key && a.key != b.key) || (a.type == Index && a.index != b.index))
+            return false;
+    }
+    return true;
+}
+
+
 void QJsonPath::set(QJsonValue& root, const QVariantList& path, const QJsonValue& newValue)
 {
-    _handleJsonAttribute(root, path, newValue, HANDLE_JSON_OP::SET);
+    set(root, Compiled(path, Compiled::Temporary()), newValue);
 }
 void QJsonPath::set(QJsonObject& root, const QVariantList& path, const QJsonValue& newValue)
 {
-    _handleJsonAttribute(root, path, newValue, HANDLE_JSON_OP::SET);
+    set(root, Compiled(path, Compiled::Temporary()), newValue);
 }
 void QJsonPath::set(QJsonArray& root, const QVariantList& path, const QJsonValue& newValue)
 {
-    _handleJsonAttribute(root, path, newValue, HANDLE_JSON_OP::SET);
+    set(root, Compiled(path, Compiled::Temporary()), newValue);
 }
 void QJsonPath::set(QJsonDocument& root, const QVariantList& path, const QJsonValue& newValue)
 {
-    _handleJsonAttribute(root, path, newValue, HANDLE_JSON_OP::SET);
+    set(root, Compiled(path, Compiled::Temporary()), newValue);
+}
+void QJsonPath::set(QJsonValue& root, const QVariantList& path, QJsonValue&& newValue)
+{
+    set(root, Compiled(path, Compiled::Temporary()), std::move(newValue));
+}
+void QJsonPath::set(QJsonObject& root, const QVariantList& path, QJsonValue&& newValue)
+{
+    set(root, Compiled(path, Compiled::Temporary()), std::move(newValue));
+}
+void QJsonPath::set(QJsonArray& root, const QVariantList& path, QJsonValue&& newValue)
+{
+    set(root, Compiled(path, Compiled::Temporary()), std::move(newValue));
+}
+void QJsonPath::set(QJsonDocument& root, const QVariantList& path, QJsonValue&& newValue)
+{
+    set(root, Compiled(path, Compiled::Temporary()), std::move(newValue));
+}
+
+void QJsonPath::set(QJsonValue& root, const Compiled& path, const QJsonValue& newValue)
+{
+    set(root, path, QJsonValue(newValue));
+}
+void QJsonPath::set(QJsonObject& root, const Compiled& path, const QJsonValue& newValue)
+{
+    set(root, path, QJsonValue(newValue));
+}
+void QJsonPath::set(QJsonArray& root, const Compiled& path, const QJsonValue& newValue)
+{
+    set(root, path, QJsonValue(newValue));
+}
+void QJsonPath::set(QJsonDocument& root, const Compiled& path, const QJsonValue& newValue)
+{
+    set(root, path, QJsonValue(newValue));
+}
+void QJsonPath::set(QJsonValue& root, const Compiled& path, QJsonValue&& newValue)
+{
+    _OperationRecorder recorder(OperationStats::Set, path);
+    _handleJsonAttribute(root, path, newValue, HANDLE_JSON_OP::SET, recorder.stats());
+}
+void QJsonPath::set(QJsonObject& root, const Compiled& path, QJsonValue&& newValue)
+{
+    _OperationRecorder recorder(OperationStats::Set, path);
+    _handleJsonAttribute(root, path, newValue, HANDLE_JSON_OP::SET, recorder.stats());
+}
+void QJsonPath::set(QJsonArray& root, const Compiled& path, QJsonValue&& newValue)
+{
+    _OperationRecorder recorder(OperationStats::Set, path);
+    _handleJsonAttribute(root, path, newValue, HANDLE_JSON_OP::SET, recorder.stats());
+}
+void QJsonPath::set(QJsonDocument& root, const Compiled& path, QJsonValue&& newValue)
+{
+    _OperationRecorder recorder(OperationStats::Set, path);
+    _handleJsonAttribute(root, path, newValue, HANDLE_JSON_OP::SET, recorder.stats());
 }
 
 
 QJsonValue QJsonPath::get(const QJsonValue& root, const QVariantList& path, const QJsonValue& defaultValue)
 {
-    QJsonValue value = root;
-    _handleJsonAttribute(value, path, QJsonValue(), HANDLE_JSON_OP::GET);
-    return value.isUndefined() ? defaultValue : value;
+    return get(root, Compiled(path, Compiled::Temporary()), defaultValue);
 }
 QJsonValue QJsonPath::get(const QJsonObject& root, const QVariantList& path, const QJsonValue& defaultValue)
 {
-    QJsonValue value = root;
-    _handleJsonAttribute(value, path, QJsonValue(), HANDLE_JSON_OP::GET);
-    return value.isUndefined() ? defaultValue : value;
+    return get(root, Compiled(path, Compiled::Temporary()), defaultValue);
 }
 QJsonValue QJsonPath::get(const QJsonArray& root, const QVariantList& path, const QJsonValue& defaultValue)
 {
-    QJsonValue value = root;
-    _handleJsonAttribute(value, path, QJsonValue(), HANDLE_JSON_OP::GET);
-    return value.isUndefined() ? defaultValue : value;
+    return get(root, Compiled(path, Compiled::Temporary()), defaultValue);
 }
 QJsonValue QJsonPath::get(const QJsonDocument& root, const QVariantList& path, const QJsonValue& defaultValue)
 {
-    auto value = root.isArray() ? QJsonValue(root.array()) : QJsonValue(root.object());
-    _handleJsonAttribute(value, path, QJsonValue(), HANDLE_JSON_OP::GET);
+    return get(root, Compiled(path, Compiled::Temporary()), defaultValue);
+}
+
+QJsonValue QJsonPath::get(const QJsonValue& root, const Compiled& path, const QJsonValue& defaultValue)
+{
+    _OperationRecorder recorder(OperationStats::Get, path);
+    auto value = __getJsonAttribute(root, path, 0, recorder.stats());
+    return value.isUndefined() ? defaultValue : value;
+}
+QJsonValue QJsonPath::get(const QJsonObject& root, const Compiled& path, const QJsonValue& defaultValue)
+{
+    _OperationRecorder recorder(OperationStats::Get, path);
+    auto value = _getJsonAttribute(root, path, recorder.stats());
+    return value.isUndefined() ? defaultValue : value;
+}
+QJsonValue QJsonPath::get(const QJsonArray& root, const Compiled& path, const QJsonValue& defaultValue)
+{
+    _OperationRecorder recorder(OperationStats::Get, path);
+    auto value = _getJsonAttribute(root, path, recorder.stats());
+    return value.isUndefined() ? defaultValue : value;
+}
+QJsonValue QJsonPath::get(const QJsonDocument& root, const Compiled& path, const QJsonValue& defaultValue)
+{
+    // object() and array() share the document data, they do not copy it
+    _OperationRecorder recorder(OperationStats::Get, path);
+    auto value = root.isArray() ? _getJsonAttribute(root.array(), path, recorder.stats()) : _getJsonAttribute(root.object(), path, recorder.stats());
     return value.isUndefined() ? defaultValue : value;
 }
 
 
 void QJsonPath::remove(QJsonValue& root, const QVariantList& path)
 {
-    _handleJsonAttribute(root, path, QJsonValue(), HANDLE_JSON_OP::REMOVE);
+    remove(root, Compiled(path, Compiled::Temporary()));
 }
 void QJsonPath::remove(QJsonObject& root, const QVariantList& path)
 {
-    _handleJsonAttribute(root, path, QJsonValue(), HANDLE_JSON_OP::REMOVE);
+    remove(root, Compiled(path, Compiled::Temporary()));
 }
 void QJsonPath::remove(QJsonArray& root, const QVariantList& path)
 {
-    _handleJsonAttribute(root, path, QJsonValue(), HANDLE_JSON_OP::REMOVE);
+    remove(root, Compiled(path, Compiled::Temporary()));
 }
 void QJsonPath::remove(QJsonDocument& root, const QVariantList& path)
 {
-    _handleJsonAttribute(root, path, QJsonValue(), HANDLE_JSON_OP::REMOVE);
+    remove(root, Compiled(path, Compiled::Temporary()));
+}
+
+void QJsonPath::remove(QJsonValue& root, const Compiled& path)
+{
+    _OperationRecorder recorder(OperationStats::Remove, path);
+    QJsonValue removed;
+    _handleJsonAttribute(root, path, removed, HANDLE_JSON_OP::REMOVE, recorder.stats());
+}
+void QJsonPath::remove(QJsonObject& root, const Compiled& path)
+{
+    _OperationRecorder recorder(OperationStats::Remove, path);
+    QJsonValue removed;
+    _handleJsonAttribute(root, path, removed, HANDLE_JSON_OP::REMOVE, recorder.stats());
+}
+void QJsonPath::remove(QJsonArray& root, const Compiled& path)
+{
+    _OperationRecorder recorder(OperationStats::Remove, path);
+    QJsonValue removed;
+    _handleJsonAttribute(root, path, removed, HANDLE_JSON_OP::REMOVE, recorder.stats());
+}
+void QJsonPath::remove(QJsonDocument& root, const Compiled& path)
+{
+    _OperationRecorder recorder(OperationStats::Remove, path);
+    QJsonValue removed;
+    _handleJsonAttribute(root, path, removed, HANDLE_JSON_OP::REMOVE, recorder.stats());
 }
 
 
+QJsonValue QJsonPath::take(QJsonValue& root, const QVariantList& path)
+{
+    return take(root, Compiled(path, Compiled::Temporary()));
+}
+QJsonValue QJsonPath::take(QJsonObject& root, const QVariantList& path)
+{
+    return take(root, Compiled(path, Compiled::Temporary()));
+}
+QJsonValue QJsonPath::take(QJsonArray& root, const QVariantList& path)
+{
+    return take(root, Compiled(path, Compiled::Temporary()));
+}
+QJsonValue QJsonPath::take(QJsonDocument& root, const QVariantList& path)
+{
+    return take(root, Compiled(path, Compiled::Temporary()));
+}
+
+QJsonValue QJsonPath::take(QJsonValue& root, const Compiled& path)
+{
+    _OperationRecorder recorder(OperationStats::Remove, path);
+    QJsonValue taken(QJsonValue::Undefined);
+    _handleJsonAttribute(root, path, taken, HANDLE_JSON_OP::TAKE, recorder.stats());
+    return taken;
+}
+QJsonValue QJsonPath::take(QJsonObject& root, const Compiled& path)
+{
+    _OperationRecorder recorder(OperationStats::Remove, path);
+    QJsonValue taken(QJsonValue::Undefined);
+    _handleJsonAttribute(root, path, taken, HANDLE_JSON_OP::TAKE, recorder.stats());
+    return taken;
+}
+QJsonValue QJsonPath::take(QJsonArray& root, const Compiled& path)
+{
+    _OperationRecorder recorder(OperationStats::Remove, path);
+    QJsonValue taken(QJsonValue::Undefined);
+    _handleJsonAttribute(root, path, taken, HANDLE_JSON_OP::TAKE, recorder.stats());
+    return taken;
+}
+QJsonValue QJsonPath::take(QJsonDocument& root, const Compiled& path)
+{
+    _OperationRecorder recorder(OperationStats::Remove, path);
+    QJsonValue taken(QJsonValue::Undefined);
+    _handleJsonAttribute(root, path, taken, HANDLE_JSON_OP::TAKE, recorder.stats());
+    return taken;
+}
+
+bool QJsonPath::move(QJsonValue& root, const QVariantList& from, const QVariantList& to)
+{
+    return move(root, Compiled(from, Compiled::Temporary()), Compiled(to, Compiled::Temporary()));
+}
+bool QJsonPath::move(QJsonObject& root, const QVariantList& from, const QVariantList& to)
+{
+    return move(root, Compiled(from, Compiled::Temporary()), Compiled(to, Compiled::Temporary()));
+}
+bool QJsonPath::move(QJsonArray& root, const QVariantList& from, const QVariantList& to)
+{
+    return move(root, Compiled(from, Compiled::Temporary()), Compiled(to, Compiled::Temporary()));
+}
+bool QJsonPath::move(QJsonDocument& root, const QVariantList& from, const QVariantList& to)
+{
+    return move(root, Compiled(from, Compiled::Temporary()), Compiled(to, Compiled::Temporary()));
+}
+
+// a set at path changes the root: a QJsonObject or QJsonArray root keeps its type and no negative index counts down
+// beyond the first element of an existing array, any other missing or different container on the path is created
+static bool _handleJsonAttribute_settable(const QJsonValue& root, const QJsonPath::Compiled& path, bool keepsType)
+{
+    if (path.isEmpty())
+        return false;
+    if (keepsType && (path.type(0) == QJsonPath::Compiled::Key) != root.isObject())
+        return false;
+    QJsonValue value = root;
+    for (int pos = 0; pos < path.size(); pos++) {
+        const auto type = path.type(pos);
+        if (type == QJsonPath::Compiled::Key) {
+            const auto obj = value.toObject();
+            const auto it = obj.constFind(path.key(pos));
+            if (!value.isObject() || it == obj.constEnd())
+                return true;
+            value = it.value();
+        }
+        else if (type == QJsonPath::Compiled::Index && value.isArray()) {
+            const auto arr = value.toArray();
+            int idx = path.index(pos);
+            if (idx < 0 && !arr.isEmpty())
+                idx += int(arr.size());
+            if (idx < 0 && !arr.isEmpty())
+                return false;
+            if (idx < 0 || idx >= arr.size())
+                return true;
+            value = arr.at(idx);
+        }
+        else
+            return true;
+    }
+    return true;
+}
+
+static QJsonValue _handleJsonAttribute_root(const QJsonValue& root)
+{
+    return root;
+}
+static QJsonValue _handleJsonAttribute_root(const QJsonDocument& root)
+{
+    return root.isArray() ? QJsonValue(root.array()) : QJsonValue(root.object());
+}
+
+// takes the value at from and sets it at to, if to cannot be set the value is put back at the position it was taken from
+template <class T> static bool _handleJsonAttribute_move(T& root, const QJsonPath::Compiled& from, const QJsonPath::Compiled& to)
+{
+    const bool keepsType = std::is_same<T, QJsonObject>::value || std::is_same<T, QJsonArray>::value;
+    QJsonPath::Compiled source = from;
+    const int last = from.size() - 1;
+    if (last >= 0 && from.type(last) == QJsonPath::Compiled::Index && from.index(last) < 0) {
+        // the following elements move down by the take, putting the value back needs the index counted from the front
+        source.truncate(last);
+        const int size = int(QJsonPath::get(root, source).toArray().size());
+        source.append(size + from.index(last));
+    }
+    QJsonValue value = QJsonPath::take(root, source);
+    if (value.isUndefined())
+        return false;
+    if (_handleJsonAttribute_settable(_handleJsonAttribute_root(root), to, keepsType)) {
+        QJsonPath::set(root, to, std::move(value));
+        return true;
+    }
+    if (source.type(last) == QJsonPath::Compiled::Index)
+        QJsonPath::insert(root, source, value);
+    else
+        QJsonPath::set(root, source, std::move(value));
+    return false;
+}
+
+bool QJsonPath::move(QJsonValue& root, const Compiled& from, const Compiled& to)
+{
+    return _handleJsonAttribute_move(root, from, to);
+}
+bool QJsonPath::move(QJsonObject& root, const Compiled& from, const Compiled& to)
+{
+    return _handleJsonAttribute_move(root, from, to);
+}
+bool QJsonPath::move(QJsonArray& root, const Compiled& from, const Compiled& to)
+{
+    return _handleJsonAttribute_move(root, from, to);
+}
+bool QJsonPath::move(QJsonDocument& root, const Compiled& from, const Compiled& to)
+{
+    return _handleJsonAttribute_move(root, from, to);
+}
+
+
+template <class T> static void _handleJsonAttribute_changeArrayAt(T& root, const QJsonPath::Compiled& path, const std::function<void(QJsonArray& arr)>& change)
+{
+    for (int pos = 0; pos < path.size(); pos++) {
+        if (path.type(pos) == QJsonPath::Compiled::Append) {
+            Q_ASSERT_X(false, __FUNCTION__, "invalid path, the path of an array must not contain \"[+]\"");
+            return;
+        }
+    }
+    _OperationRecorder recorder(QJsonPath::OperationStats::Set, path);
+    QJsonValue value;
+    _handleJsonAttribute(root, path, value, HANDLE_JSON_OP::BORROW, recorder.stats());
+    auto arr = value.isArray() ? value.toArray() : QJsonArray();
+    value = QJsonValue(); // arr holds the only reference now
+    change(arr);
+    value = std::move(arr);
+    _handleJsonAttribute(root, path, value, HANDLE_JSON_OP::SET, recorder.stats());
+}
+
+// an empty path is the root itself
+void _handleJsonAttribute_changeArray(QJsonValue& root, const QJsonPath::Compiled& path, const std::function<void(QJsonArray& arr)>& change)
+{
+    if (!path.isEmpty())
+        return _handleJsonAttribute_changeArrayAt(root, path, change);
+    auto arr = root.isArray() ? root.toArray() : QJsonArray();
+    root = QJsonValue(); // arr holds the only reference now
+    change(arr);
+    root = std::move(arr);
+}
+void _handleJsonAttribute_changeArray(QJsonObject& root, const QJsonPath::Compiled& path, const std::function<void(QJsonArray& arr)>& change)
+{
+    if (!path.isEmpty())
+        return _handleJsonAttribute_changeArrayAt(root, path, change);
+    Q_ASSERT_X(!path.isEmpty(), __FUNCTION__, "invalid path, the root object is no array");
+}
+void _handleJsonAttribute_changeArray(QJsonArray& root, const QJsonPath::Compiled& path, const std::function<void(QJsonArray& arr)>& change)
+{
+    if (!path.isEmpty())
+        return _handleJsonAttribute_changeArrayAt(root, path, change);
+    change(root);
+}
+void _handleJsonAttribute_changeArray(QJsonDocument& root, const QJsonPath::Compiled& path, const std::function<void(QJsonArray& arr)>& change)
+{
+    if (!path.isEmpty())
+        return _handleJsonAttribute_changeArrayAt(root, path, change);
+    auto arr = root.isArray() ? root.array() : QJsonArray();
+    root = QJsonDocument(); // arr holds the only reference now
+    change(arr);
+    root = QJsonDocument(arr);
+}
+
 QChar QJsonPath::separator()
 {
-    return _handleJsonAttribute_separator;
+    return QChar(_handleJsonAttribute_separator.load(std::memory_order_relaxed));
 }
 void QJsonPath::setSeparator(QChar newSeparator)
 {
-    _handleJsonAttribute_separator = newSeparator;
+    _handleJsonAttribute_separator.store(newSeparator.unicode(), std::memory_order_relaxed);
 }
 
 
 QVariantList QJsonPath::splitPath(const QString& path)
 {
-    const QChar bracketOpen('['), bracketClose(']');
+    return splitPath(path, separator());
+}
+
+QVariantList QJsonPath::splitPath(const QString& path, QChar separator)
+{
     QVariantList p;
-    int i=0, i0_name=0, i0_idx=-1;
-    for (; i < path.size(); i++) {
-        if (path[i] == _handleJsonAttribute_separator) {
-            if (i0_name >= 0)
-                p << path.mid(i0_name, i - i0_name);
-            i0_name = i+1;
-            i0_idx = -1;
-        }
-        else if (path[i] == bracketOpen)
-            i0_idx = i+1;
-        else if (path[i] == bracketClose && i0_idx > 0) {
-            auto sIdx = path.mid(i0_idx, i - i0_idx);
-            bool ok;
-            int idx = sIdx.toInt(&ok);
-            if (ok) {
-                int n = i0_idx-1 - i0_name;
-                if (i0_name >= 0 && n > 0)
-                    p << path.mid(i0_name, n);
-                p << idx;
-                i0_name = -1;
-                i0_idx = -1;
-            }
-        }
-    }
-    if (i0_name >= 0)
-        p << path.mid(i0_name, i - i0_name);
+    _handleJsonAttribute_parsePath(path, separator,
+        [&p](const QString& key) { p << key; },
+        [&p](int idx) { p << idx; },
+        [&p]() { p << QVariant(); }); // "[+]" is an invalid QVariant
     return p;
 }
 
@@ -394,10 +1039,181 @@ template <class T> static void _handleJsonAttribute_unittest_array(T& array)
     Q_ASSERT(QJsonPath::get(array, "[0]") == QJsonValue(QJsonValue::Undefined));
 }
 
+// a literal has the same tokens as the path string, checked here at runtime
+template <std::size_t N> static bool _handleJsonAttribute_unittest_literal(const char (&path)[N])
+{
+    return QJsonPath::Compiled(QJsonPath::Literal<N>(path)) == QJsonPath::Compiled(QString::fromUtf8(path), '/');
+}
+
+template <class T> static void _handleJsonAttribute_unittest_compiled(T& doc)
+{
+    // compiled paths are parsed once and can be reused for any number of calls
+    const QJsonPath::Compiled path("name0/name1[2]/name2");
+    Q_ASSERT(path.size() == 4);
+    Q_ASSERT(path == QJsonPath::Compiled(QVariantList{"name0", "name1", 2, "name2"}));
+    Q_ASSERT(path.toVariantList() == QJsonPath::splitPath("name0/name1[2]/name2"));
+    Q_ASSERT(QJsonPath::get(doc, path) == QJsonValue(QJsonValue::Undefined));
+    Q_ASSERT(QJsonPath::get(doc, path, 11) == 11);
+
+    QJsonPath::set(doc, path, "abc");
+    Q_ASSERT(QJsonPath::get(doc, path) == "abc");
+    Q_ASSERT(QJsonPath::get(doc, "name0/name1[2]/name2") == "abc");
+    Q_ASSERT(QJsonPath::get(doc, QJsonPath::Compiled("name0/name1[-1]/name2")) == "abc");
+    Q_ASSERT(QJsonPath::get(doc, QJsonPath::Compiled("name0/name1[0]")) == QJsonValue(QJsonValue::Null));
+
+    // the separator is only used while compiling
+    QJsonPath::setSeparator('.');
+    const QJsonPath::Compiled pathDot("name0.name1[2].name2");
+    QJsonPath::setSeparator('/');
+    Q_ASSERT(pathDot == path);
+    Q_ASSERT(QJsonPath::get(doc, pathDot) == "abc");
+    // an explicit separator does not depend on the global one, e.g. for paths compiled on several threads
+    Q_ASSERT(QJsonPath::Compiled("name0:name1[2]:name2", ':') == path);
+    Q_ASSERT(QJsonPath::splitPath("name0.name1[2]", '.') == QVariantList({"name0", "name1", 2}));
+    Q_ASSERT(QJsonPath::separator() == '/');
+    // paths of a single call are not interned and parse the same way
+    Q_ASSERT(QJsonPath::Compiled("name0/name1[2]/name2", QJsonPath::Compiled::Temporary()) == path);
+    Q_ASSERT(QJsonPath::Compiled(QVariantList{"name0", "name1", 2, "name2"}, QJsonPath::Compiled::Temporary()) == path);
+
+    // invalid brackets stay part of the name, same as QJsonPath::splitPath
+    Q_ASSERT(QJsonPath::Compiled("name3[x]/name4").toVariantList() == QVariantList({"name3[x]", "name4"}));
+
+    // path literals are parsed by the compiler, QJSONPATH("name3[x]/name4") would not compile
+    Q_ASSERT(QJsonPath::get(doc, QJSONPATH("name0/name1[2]/name2")) == "abc");
+    Q_ASSERT(&QJSONPATH("name0") != &QJSONPATH("name0")); // one static path per call site
+    constexpr QJsonPath::Literal literal("name0/name1[-1][3]");
+    static_assert(literal.size() == 4 && literal.type(2) == QJsonPath::Compiled::Index && literal.index(2) == -1 && literal.index(3) == 3, "");
+    static_assert(literal.keySize(1) == 5 && literal.keyData(1)[4] == '1', "");
+    static_assert(QJsonPath::Literal("a.b[0]", '.').size() == 3 && QJsonPath::Literal("").size() == 1, "");
+    Q_ASSERT(QJsonPath::Compiled(literal).toVariantList() == QVariantList({"name0", "name1", -1, 3}));
+    Q_ASSERT(_handleJsonAttribute_unittest_literal("") && _handleJsonAttribute_unittest_literal("a") && _handleJsonAttribute_unittest_literal("/a/"));
+    Q_ASSERT(_handleJsonAttribute_unittest_literal("a//b") && _handleJsonAttribute_unittest_literal("[0]") && _handleJsonAttribute_unittest_literal("a[0][-1]/b"));
+    Q_ASSERT(_handleJsonAttribute_unittest_literal("a/[3]/") && _handleJsonAttribute_unittest_literal("\xc3\xbc/x[2147483647]") && _handleJsonAttribute_unittest_literal("a[-2147483648]"));
+
+    QJsonPath::remove(doc, path);
+    Q_ASSERT(QJsonPath::get(doc, path) == QJsonValue(QJsonValue::Undefined));
+
+    // modifying a document leaves its copies untouched
+    QJsonPath::set(doc, path, "abc");
+    const T copy = doc;
+    QJsonPath::set(doc, path, "xyz");
+    QJsonPath::remove(doc, "name0/name1[0]");
+    Q_ASSERT(QJsonPath::get(copy, path) == "abc");
+    Q_ASSERT(QJsonPath::get(doc, "name0/name1[1]/name2") == "xyz");
+
+    // negative index counting down beyond the first element changes nothing
+    QJsonPath::set(doc, "name0/name1[-9]", 1);
+    Q_ASSERT(QJsonPath::get(doc, "name0/name1").toArray().size() == 2);
+
+    QJsonPath::remove(doc, QJsonPath::Compiled("name0"));
+    Q_ASSERT(QJsonPath::get(doc, "name0") == QJsonValue(QJsonValue::Undefined));
+}
+
+static void _handleJsonAttribute_unittest_stats()
+{
+    QVector<QJsonPath::OperationStats> records;
+    QJsonPath::setStatsCallback([&records](const QJsonPath::OperationStats& stats) { records.append(stats); });
+
+    QJsonValue val;
+    QJsonPath::set(val, "a/b[2]", 1); // creates, enters and changes three containers, pads two elements
+    Q_ASSERT(records.size() == 1);
+    auto r = records.last();
+    Q_ASSERT(r.operation == QJsonPath::OperationStats::Set && r.depth == 3);
+    Q_ASSERT(r.nodes == 3 && r.created == 3 && r.modified == 3 && r.padding == 2 && r.nanoseconds >= 0);
+
+    Q_ASSERT(QJsonPath::get(val, QVariantList{ "a", "b", -1 }) == 1);
+    r = records.last();
+    Q_ASSERT(r.operation == QJsonPath::OperationStats::Get && r.nodes == 3 && r.modified == 0 && r.created == 0);
+    auto obj = val.toObject();
+    QJsonPath::get(obj, "a/x/y");
+    Q_ASSERT(records.last().nodes == 2);
+
+    QJsonPath::remove(val, "a/x"); // missing, nothing is changed
+    r = records.last();
+    Q_ASSERT(r.operation == QJsonPath::OperationStats::Remove && r.nodes == 2 && r.modified == 0);
+    Q_ASSERT(QJsonPath::take(val, "a/b[5]").isUndefined()); // the lookup enters three containers and changes none
+    r = records.last();
+    Q_ASSERT(r.operation == QJsonPath::OperationStats::Remove && r.nodes == 3 && r.modified == 0);
+    QJsonDocument doc(val.toObject()); // shares the containers with val, every changed container is detached
+    QJsonPath::remove(doc, "a/b[0]");
+    r = records.last();
+    Q_ASSERT(r.nodes == 3 && r.modified == 3 && records.size() == 6);
+
+    // every second operation is recorded
+    QJsonPath::setStatsCallback([&records](const QJsonPath::OperationStats& stats) { records.append(stats); }, 2);
+    records.clear();
+    for (int i = 0; i < 10; i++)
+        QJsonPath::set(val, QJsonPath::Compiled("a/c"), i);
+    Q_ASSERT(records.size() == 5);
+
+    QJsonPath::Statistics statistics;
+    for (const auto& stats : records)
+        statistics.add(stats);
+    Q_ASSERT(statistics.count[QJsonPath::OperationStats::Set] == 5 && statistics.nodes == 10 && statistics.modified == 10);
+    Q_ASSERT(statistics.percentile(0.5) > 0 && statistics.percentile(0.5) <= statistics.percentile(1.0));
+    QJsonPath::OperationStats slow;
+    slow.nanoseconds = 1000000000000; // no set takes 1000 seconds, 2^40 is the upper bound of its bucket
+    statistics.add(slow);
+    Q_ASSERT(statistics.percentile(1.0) == (qint64(1) << 40) && QJsonPath::Statistics().percentile(0.5) == 0);
+
+    QJsonPath::setStatsCallback(nullptr);
+    records.clear();
+    QJsonPath::set(val, "a/d", 1);
+    Q_ASSERT(records.isEmpty());
+}
+
+// take, move and set of a moved value on roots holding an object
+template <class T> static void _handleJsonAttribute_unittest_take(T& doc)
+{
+    QJsonPath::set(doc, "a/b", QJsonObject{ { "c", 1 }, { "d", QJsonArray{ 1, 2, 3 } } });
+    QJsonPath::set(doc, "list", QJsonArray{ "x", "y", "z" });
+
+    Q_ASSERT(QJsonPath::take(doc, "a/b/d[-1]") == 3 && QJsonPath::get(doc, "a/b/d") == QJsonArray({ 1, 2 }));
+    Q_ASSERT(QJsonPath::take(doc, QVariantList{ "list", 0 }) == "x" && QJsonPath::get(doc, "list") == QJsonArray({ "y", "z" }));
+    Q_ASSERT(QJsonPath::take(doc, "a/missing").isUndefined() && QJsonPath::take(doc, "list[5]").isUndefined());
+    Q_ASSERT(QJsonPath::take(doc, "a/b/c/d").isUndefined() && QJsonPath::take(doc, "a[0]").isUndefined());
+    Q_ASSERT(QJsonPath::get(doc, "a/b/c") == 1); // nothing is created or converted by a take of a missing path
+
+    // move resolves the target after the removal
+    Q_ASSERT(QJsonPath::move(doc, "a/b", "moved/b"));
+    Q_ASSERT(QJsonPath::get(doc, "a") == QJsonObject() && QJsonPath::get(doc, "moved/b/d[1]") == 2);
+    Q_ASSERT(QJsonPath::move(doc, QJsonPath::Compiled("list[0]"), QJsonPath::Compiled("list[-1]")) && QJsonPath::get(doc, "list") == QJsonArray({ "y" }));
+    Q_ASSERT(QJsonPath::move(doc, QVariantList{ "moved" }, QVariantList{ "moved", "inner" }) && QJsonPath::get(doc, "moved/inner/b/c") == 1);
+    Q_ASSERT(!QJsonPath::move(doc, "missing", "target") && QJsonPath::get(doc, "target").isUndefined());
+
+    // a target that cannot be set fails and leaves the tree unchanged
+    QJsonObject movable{ { "a", 1 }, { "b", QJsonArray{ 1, 2 } } };
+    const auto unmoved = movable;
+    Q_ASSERT(!QJsonPath::move(movable, "a", "b[-5]") && movable == unmoved);
+    Q_ASSERT(!QJsonPath::move(movable, "b[-1]", "[0]") && movable == unmoved);
+    Q_ASSERT(!QJsonPath::move(movable, QVariantList{ "b", 0 }, QVariantList{ "b", -3 }) && movable == unmoved);
+    Q_ASSERT(!QJsonPath::move(movable, QJsonPath::Compiled("a"), QJsonPath::Compiled()) && movable == unmoved);
+    QJsonArray movableArr{ 1, QJsonArray{ 2, 3 } };
+    const auto unmovedArr = movableArr;
+    Q_ASSERT(!QJsonPath::move(movableArr, "[0]", "x") && !QJsonPath::move(movableArr, "[1][-2]", "[1][-9]") && movableArr == unmovedArr);
+    QJsonValue movableValue = movable;
+    QJsonDocument movableDoc(movable);
+    Q_ASSERT(!QJsonPath::move(movableValue, "b[0]", "b[-3]") && movableValue == QJsonValue(unmoved));
+    Q_ASSERT(!QJsonPath::move(movableDoc, "b[1]", "b[-2]") && movableDoc.object() == unmoved);
+    Q_ASSERT(QJsonPath::move(movableDoc, "b[0]", "b[+]") && QJsonPath::get(movableDoc, "b") == QJsonArray({ 2, 1 }));
+    Q_ASSERT(QJsonPath::move(movableDoc, "b", "[0]") && movableDoc.array() == QJsonArray({ QJsonArray{ 2, 1 } })); // a document may change its type
+
+    // a moved value is released by the caller
+    QJsonValue value = QJsonObject{ { "e", QJsonArray{ 4 } } };
+    QJsonPath::set(doc, "a/e", std::move(value));
+    Q_ASSERT(value.isNull() && QJsonPath::get(doc, "a/e/e[0]") == 4);
+    value = QJsonArray{ 5 };
+    QJsonPath::set(doc, QVariantList{ "a", "f" }, std::move(value));
+    Q_ASSERT(value.isNull() && QJsonPath::get(doc, "a/f") == QJsonArray({ 5 }));
+
+    for (const auto& key : { "a", "list", "moved" })
+        QJsonPath::remove(doc, key);
+}
+
 void QJsonPath::unittest()
 {
-    auto sepBackup = _handleJsonAttribute_separator;
-    _handleJsonAttribute_separator = QChar('/');
+    const auto sepBackup = separator();
+    setSeparator('/');
 
     QJsonValue val;
     _handleJsonAttribute_unittest_object(val);
@@ -408,6 +1224,8 @@ void QJsonPath::unittest()
     QJsonObject obj;
     _handleJsonAttribute_unittest_object(obj);
     Q_ASSERT(obj == QJsonObject());
+    _handleJsonAttribute_unittest_compiled(obj);
+    Q_ASSERT(obj == QJsonObject());
 
     QJsonArray arr;
     _handleJsonAttribute_unittest_array(arr);
@@ -416,9 +1234,38 @@ void QJsonPath::unittest()
     QJsonDocument doc;
     _handleJsonAttribute_unittest_object(doc);
     Q_ASSERT(doc.object() == QJsonDocument().object());
+    _handleJsonAttribute_unittest_compiled(doc);
+    Q_ASSERT(doc.object() == QJsonDocument().object());
     _handleJsonAttribute_unittest_array(doc);
     Q_ASSERT(doc.array() == QJsonDocument().array());
 
-    _handleJsonAttribute_separator = sepBackup;
-    qDebug() << __FUNCTION__ " finished";
+    QJsonValue takeVal;
+    _handleJsonAttribute_unittest_take(takeVal);
+    Q_ASSERT(takeVal == QJsonValue(QJsonValue::Object));
+    _handleJsonAttribute_unittest_take(obj);
+    Q_ASSERT(obj == QJsonObject());
+    _handleJsonAttribute_unittest_take(doc);
+    Q_ASSERT(doc.object() == QJsonObject());
+    QJsonArray takeArr{ QJsonArray{ 1, 2 }, "x" };
+    Q_ASSERT(QJsonPath::take(takeArr, "[0][-1]") == 2 && QJsonPath::move(takeArr, "[1]", "[0][3]"));
+    Q_ASSERT(takeArr == QJsonArray({ QJsonArray{ 1, QJsonValue(), QJsonValue(), "x" } }));
+
+    _handleJsonAttribute_unittest_stats();
+    _handleJsonAttribute_unittest_batch();
+    _handleJsonAttribute_unittest_query();
+    _handleJsonAttribute_unittest_filter();
+    _handleJsonAttribute_unittest_stream();
+    _handleJsonAttribute_unittest_extractor();
+    _handleJsonAttribute_unittest_lazy();
+    _handleJsonAttribute_unittest_cbor();
+    _handleJsonAttribute_unittest_builder();
+    _handleJsonAttribute_unittest_shared();
+    _handleJsonAttribute_unittest_patch();
+    _handleJsonAttribute_unittest_index();
+    _handleJsonAttribute_unittest_parallel();
+    _handleJsonAttribute_unittest_projection();
+    _handleJsonAttribute_unittest_bulk();
+
+    setSeparator(sepBackup);
+    qDebug() << __FUNCTION__ << "finished";
 }
@@ -5,6 +5,23 @@
 
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QJsonArray>
+#include <QCborValue>
+#include <QCborMap>
+#include <QCborArray>
+#include <QHash>
+#include <QMutex>
+#include <QScopedPointer>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+
+QT_FORWARD_DECLARE_CLASS(QIODevice)
+QT_FORWARD_DECLARE_CLASS(QFile)
+QT_FORWARD_DECLARE_CLASS(QCborStreamReader)
 
 //!  QJsonPath
 /*!
@@ -16,12 +33,36 @@
  * void QJsonPath::set(T& destValue, const QString& path, const QJsonValue& newValue);
  * QJsonValue QJsonPath::get(T& destValue, const QString& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined));
  * void QJsonPath::remove(T& destValue, const QString& path);
+ * QJsonValue QJsonPath::take(T& destValue, const QString& path);
+ * bool QJsonPath::move(T& destValue, const QString& from, const QString& to);
+ * void QJsonPath::insert(T& destValue, const QString& path, const QJsonValue& value);
+ * QJsonArray QJsonPath::splice(T& destValue, const QString& arrayPath, int pos, int removeCount, const QJsonArray& values = QJsonArray());
+ * void QJsonPath::appendRange(T& destValue, const QString& arrayPath, const QJsonArray& values);
+ * void QJsonPath::resize(T& destValue, const QString& arrayPath, int size, const QJsonValue& fill = QJsonValue());
+ * void QJsonPath::fill(T& destValue, const QString& arrayPath, const QJsonValue& value, int size = -1);
  *
+ * All functions also accept a QVariantList or a precompiled QJsonPath::Compiled path instead of a string, the array functions insert, splice, appendRange, resize and fill accept a string or a precompiled path only.
+ * Many operations on the same root can be collected in a QJsonPath::Batch and applied in a single traversal.
+ * Wildcards, slices and recursive descent are supported by QJsonPath::Query, which returns its matches lazily.
+ * QJsonPath::Stream evaluates compiled paths on JSON text arriving in chunks, without building a document.
+ * QJsonPath::Extractor extracts many paths from complete JSON texts using a SIMD structural index, without building a document.
+ * QJsonPath::LazyDocument reads paths from a memory mapped JSON file, scanning only the containers on the paths.
+ * QJsonPath::Builder constructs a new document from many set calls in an arena backed node tree and converts it once at the end.
+ * QJsonPath::Projection writes selected paths of a document as JSON text to a QIODevice, without building the result document.
+ * QJsonPath::ParallelQuery evaluates a path on all elements of a large array with several threads, collecting or reducing the values.
+ * QJsonPath::Index finds elements of an array of objects by a key in O(1), it owns the root and is invalidated by its changes of the array.
+ * QJsonPath::Journal records set and remove calls as a JSON Patch (RFC 6902) and applies patches to replicas.
+ * QJsonPath::SharedDocument holds a document for concurrent readers, which get lock free immutable snapshots while writers publish new versions.
+ * CBOR is supported natively: set, get and remove also accept QCborValue, QCborMap and QCborArray, QJsonPath::CborReader evaluates paths on a QCborStreamReader.
  * Type T can be QJsonDocument, QJsonObject, QJsonArray or QJsonValue.
  * Restrictions: QJsonObject cannot have an array as root, QJsonArray cannot have an object as root.
  * Function QJsonPath::set will create all parent attributes necessary if missing or overwrite them if not matching the path.
  * Assigned values can be complex, simple or null, see examples.
- * Functions QJsonPath::setSeparator and QJsonPath::unittest are not re-entrant and not thread safe, all other functions are re-entrant but not thread safe.
+ * Function QJsonPath::get is read-only, it never detaches or copies the containers of the root, so reading from a shared document is cheap.
+ * Functions QJsonPath::set and QJsonPath::remove change only the containers along the path inplace, so their cost depends on the path depth and not on the document size.
+ * Function QJsonPath::unittest is not re-entrant, all other functions are re-entrant: they can run on several threads at the same time
+ * as long as no root is changed while another thread uses it. Objects of the nested classes (Extractor, LazyDocument, Builder, ...) keep state, use one per thread. Paths compiled with an explicit separator do not depend on QJsonPath::setSeparator.
+ * QJsonPath::SharedDocument is thread safe, many threads read snapshots of it while other threads change it.
  *
  * Examples:
  *   QJsonPath::set(doc, "name0/name1[2]", "abc");
@@ -32,9 +73,13 @@
  * For more examples see QJsonPath::unittest
  *
  * Path String:
- * A path specified as a QString uses separators and brackets. A QString is converted to a QVariantList by QJsonPath::splitPath.
+ * A path specified as a QString uses separators and brackets. A QString is parsed into tokens the same way QJsonPath::splitPath converts it to a QVariantList.
  * If brackets do not have correct syntax or a number in it, they are parsed as a attribute name without any warning.
  *
+ * Compiled Path:
+ * A path string or list can be parsed once into a QJsonPath::Compiled object, which stores keys and indexes in a compact token array.
+ * Use it for paths evaluated very often, this skips the parsing and QVariant conversion on every call.
+ *
  * Path List:
  * Path is specified as a QVariantList. No separator is needed, names can have any character in it, even separator and brackets are allowed.
  * The list consists of strings and integers only. A string is always an attribute name in an object, an integer is always an index in an array.
@@ -47,6 +92,1277 @@
 class QJsonPath
 {
 public:
+    template <std::size_t N> class Literal;
+
+    //!  QJsonPath::Compiled
+    /*!
+     * A path parsed once into a token array of keys and indexes.
+     * Construct it from a path string (using the current or an explicit separator) or a path list and reuse it for any number of calls.
+     *
+     * Example:
+     *   const QJsonPath::Compiled path("name0/name1[2]");
+     *   QJsonPath::set(doc, path, "abc");
+     *   Q_ASSERT(QJsonPath::get(doc, path) == "abc");
+     */
+    class Compiled
+    {
+    public:
+        enum TokenType
+        {
+            Key,     //!< attribute name in an object
+            Index,   //!< index in an array
+            Append,  //!< "[+]", the element after the last one of an array, set appends it, get and remove find nothing
+            Invalid, //!< unsupported type in a path list
+        };
+
+        //! Tag of a path used for a single call only, e.g. by the QString overloads of set, get and remove: its keys are not
+        //! interned, the keys of other compiled paths share their string data through a pool of the constructing thread.
+        struct Temporary {};
+
+        Compiled() = default;
+        explicit Compiled(const QString& path);
+        Compiled(const QString& path, QChar separator); //!< independent of the current separator
+        explicit Compiled(const QVariantList& path);
+        Compiled(const QString& path, Temporary);
+        Compiled(const QVariantList& path, Temporary);
+        template <std::size_t N> explicit Compiled(const Literal<N>& path);
+
+        int size() const { return int(m_tokens.size()); }
+        bool isEmpty() const { return m_tokens.isEmpty(); }
+        TokenType type(int i) const { return m_tokens[i].type; }
+        const QString& key(int i) const { return m_tokens[i].key; }
+        int index(int i) const { return m_tokens[i].index; }
+
+        /**
+         * @brief Appends an attribute name or an array index, e.g. to build the path of a match while walking a tree.
+         */
+        void append(const QString& key) { m_tokens.append({ key, 0, Key }); }
+        void append(int index) { m_tokens.append({ QString(), index, Index }); }
+        void appendElement() { m_tokens.append({ QString(), 0, Append }); } //!< "[+]"
+
+        /**
+         * @brief Removes all tokens from position size on.
+         */
+        void truncate(int size) { m_tokens.resize(size); }
+
+        /**
+         * @brief Converts the compiled path back to a list path.
+         */
+        QVariantList toVariantList() const;
+
+        bool operator==(const Compiled& other) const;
+        bool operator!=(const Compiled& other) const { return !(*this == other); }
+
+    private:
+        void parse(const QString& path, QChar separator, bool intern);
+        void parse(const QVariantList& path, bool intern);
+
+        struct Token
+        {
+            QString key;
+            int index;
+            TokenType type;
+        };
+        QVector<Token> m_tokens;
+    };
+
+    //!  QJsonPath::Literal
+    /*!
+     * A path string literal parsed by the compiler, use it through the macro QJSONPATH, which converts it once per call site
+     * into a static QJsonPath::Compiled. The separator is always '/' unless another one is given to the constructor.
+     * Unlike a path string, a bracket that is not an integer index or "[+]", is not closed or is followed by anything but a bracket
+     * or the separator is a compile error (a call of the non-constexpr function malformedPath).
+     *
+     * Example:
+     *   QJsonPath::get(doc, QJSONPATH("limits/cpu[0]"));
+     *   static_assert(QJsonPath::Literal("limits/cpu[0]").size() == 3, "");
+     */
+    template <std::size_t N> class Literal
+    {
+    public:
+        constexpr Literal(const char (&path)[N], char separator = '/')
+        {
+            for (std::size_t i = 0; i < N; i++)
+                m_text[i] = path[i];
+            parse(separator);
+        }
+
+        constexpr int size() const { return m_size; }
+        constexpr Compiled::TokenType type(int i) const { return m_tokens[i].type; }
+        constexpr int index(int i) const { return m_tokens[i].index; }
+        constexpr const char* keyData(int i) const { return m_text + m_tokens[i].offset; } //!< UTF-8, not zero terminated
+        constexpr int keySize(int i) const { return m_tokens[i].size; }
+
+    private:
+        static void malformedPath(const char* reason) { Q_UNUSED(reason); Q_ASSERT_X(false, "QJsonPath::Literal", reason); }
+
+        constexpr void parse(char separator)
+        {
+            int i = 0;
+            const int end = int(N) - 1; // without the terminating zero
+            for (;;) {
+                const int key = i;
+                while (i < end && m_text[i] != separator && m_text[i] != '[') {
+                    if (m_text[i] == ']')
+                        return malformedPath("']' without '['");
+                    i++;
+                }
+                // an empty name before an index is no key, the same as in path strings
+                if (i > key || i == end || m_text[i] == separator)
+                    m_tokens[m_size++] = { Compiled::Key, key, i - key, 0 };
+                while (i < end && m_text[i] == '[') {
+                    i++;
+                    if (i + 1 < end && m_text[i] == '+' && m_text[i + 1] == ']') {
+                        i += 2;
+                        m_tokens[m_size++] = { Compiled::Append, 0, 0, 0 };
+                        continue;
+                    }
+                    const bool negative = i < end && m_text[i] == '-';
+                    if (negative)
+                        i++;
+                    if (i == end || m_text[i] < '0' || m_text[i] > '9')
+                        return malformedPath("the bracket does not contain an integer index");
+                    long long index = 0;
+                    while (i < end && m_text[i] >= '0' && m_text[i] <= '9') {
+                        index = index * 10 + (m_text[i++] - '0');
+                        if (index > 2147483647LL + negative)
+                            return malformedPath("the index does not fit into an int");
+                    }
+                    if (i == end || m_text[i] != ']')
+                        return malformedPath("the bracket is not closed");
+                    i++;
+                    m_tokens[m_size++] = { Compiled::Index, 0, 0, int(negative ? -index : index) };
+                }
+                if (i == end)
+                    return;
+                if (m_text[i] != separator)
+                    return malformedPath("a bracket is followed by a name without a separator");
+                i++;
+            }
+        }
+
+        struct Token
+        {
+            Compiled::TokenType type = Compiled::Key;
+            int offset = 0;
+            int size = 0;
+            int index = 0;
+        };
+        char m_text[N] = {};
+        Token m_tokens[N] = {}; // a path has at most as many tokens as characters and one more
+        int m_size = 0;
+    };
+
+    //!  QJsonPath::Batch
+    /*!
+     * A list of get, set and remove operations applied to a root in a single traversal.
+     * Operations are grouped by their common path prefix, so each shared container is taken out and written back only once.
+     * The result is the same as calling the single functions in the order the operations were added.
+     *
+     * Example:
+     *   QJsonPath::Batch batch;
+     *   batch.set("svc/limits/cpu", 2);
+     *   batch.set("svc/limits/mem", 512);
+     *   const int cpu = batch.get("svc/limits/cpu");
+     *   const auto results = batch.apply(doc);
+     *   Q_ASSERT(results[cpu] == 2);
+     */
+    class Batch
+    {
+    public:
+        /**
+         * @brief Adds a get operation.
+         * @param path         [in] Path of the value.
+         * @param defaultValue [in] Value returned when the key is not found.
+         * @return Position of the value in the results of apply and query.
+         */
+        int get(const Compiled& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined));
+        int get(const QString& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined)) { return get(Compiled(path), defaultValue); }
+        int get(const QVariantList& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined)) { return get(Compiled(path), defaultValue); }
+
+        /**
+         * @brief Adds a set operation.
+         * @param path     [in] Path of the value, created if missing.
+         * @param newValue [in] New assigned value.
+         */
+        void set(const Compiled& path, const QJsonValue& newValue);
+        void set(const QString& path, const QJsonValue& newValue) { set(Compiled(path), newValue); }
+        void set(const QVariantList& path, const QJsonValue& newValue) { set(Compiled(path), newValue); }
+
+        /**
+         * @brief Adds a remove operation.
+         * @param path [in] Path of the attribute or array element.
+         */
+        void remove(const Compiled& path);
+        void remove(const QString& path) { remove(Compiled(path)); }
+        void remove(const QVariantList& path) { remove(Compiled(path)); }
+
+        int size() const { return int(m_operations.size()); }
+        bool isEmpty() const { return m_operations.isEmpty(); }
+        void clear();
+
+        /**
+         * @brief Applies all operations to root inplace.
+         * @param root [in/out] Object representing the JSON structure.
+         * @return Values of the get operations, in the order they were added.
+         */
+        QVector<QJsonValue> apply(QJsonValue& root) const;
+        QVector<QJsonValue> apply(QJsonObject& root) const;
+        QVector<QJsonValue> apply(QJsonArray& root) const;
+        QVector<QJsonValue> apply(QJsonDocument& root) const;
+
+        /**
+         * @brief Evaluates only the get operations, set and remove operations are ignored. The root is never modified or detached.
+         * @param root [in] Object representing the JSON structure.
+         * @return Values of the get operations, in the order they were added.
+         */
+        QVector<QJsonValue> query(const QJsonValue& root) const;
+        QVector<QJsonValue> query(const QJsonObject& root) const;
+        QVector<QJsonValue> query(const QJsonArray& root) const;
+        QVector<QJsonValue> query(const QJsonDocument& root) const;
+
+    private:
+        enum OperationType
+        {
+            Get,
+            Set,
+            Remove,
+        };
+        struct Operation
+        {
+            Compiled path;
+            QJsonValue value; // new value of a set, default value of a get
+            OperationType type;
+            int result;
+        };
+        struct Runner;
+
+        QVector<Operation> m_operations;
+        int m_results = 0;
+    };
+
+    //!  QJsonPath::Match
+    /*!
+     * A value found by a query together with its concrete path from the root.
+     */
+    struct Match
+    {
+        QJsonValue value;
+        Compiled path;
+    };
+
+    //!  QJsonPath::Filter
+    /*!
+     * A predicate on a JSON value, compiled once into a small bytecode program.
+     * Relative paths start with @ and use '.' and brackets: @, @.name, @.name.sub[0], @['any name'].
+     * Literals are numbers, strings in single or double quotes, true, false and null.
+     * Operators are == != < <= > >= && || ! and parentheses. A path without comparison tests if the attribute exists.
+     * Relational operators compare numbers with numbers and strings with strings only, anything else is false.
+     * With Qt 6 == and != compare strings in place without allocating, < <= > >= on strings create QStrings.
+     *
+     * Example:
+     *   const QJsonPath::Filter open("@.status == 'open' && @.total > 100");
+     *   Q_ASSERT(open.test(QJsonObject{{"status", "open"}, {"total", 150}}));
+     */
+    class Filter
+    {
+    public:
+        Filter() = default; //!< matches every value
+        explicit Filter(const QString& expression);
+
+        bool isValid() const { return m_error.isEmpty(); }
+        const QString& errorString() const { return m_error; }
+
+        /**
+         * @brief Evaluates the predicate with @ being value. An invalid filter is always false.
+         */
+        bool test(const QJsonValue& value) const;
+
+    private:
+        struct Compiler;
+
+        enum OpCode
+        {
+            PushPath,     // arg: relative path
+            PushConst,    // arg: constant
+            Exists,       // top = top is not undefined
+            Equal,        // comparisons replace the top two values by the result
+            NotEqual,
+            Less,
+            LessEqual,
+            Greater,
+            GreaterEqual,
+            Not,
+            JumpIfFalse,  // arg: target, the value is kept if jumping, && and || are short circuit
+            JumpIfTrue,
+            Pop,
+        };
+        struct Instruction
+        {
+            OpCode op;
+            int arg;
+        };
+        static constexpr int MaxStack = 32;
+        static constexpr int NoOrigin = std::numeric_limits<int>::min();
+
+        bool equal(const QJsonValue& value, const QJsonValue& a, int originA, const QJsonValue& b, int originB) const;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        QCborValue stringOperand(const QJsonValue& value, int origin) const;
+#endif
+
+        QVector<Instruction> m_code;
+        QVector<QJsonValue> m_constants;
+        QVector<Compiled> m_paths;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        QVector<QCborValue> m_stringConstants; // string constants of m_constants, compared without allocating
+        QVector<Compiled> m_parents;           // m_paths without the last token
+#endif
+        QString m_error;
+    };
+
+    class MatchIterator;
+    class MatchRange;
+
+    //!  QJsonPath::Query
+    /*!
+     * A path which can select many values, parsed once and evaluated lazily.
+     * In addition to names and indexes a query string supports:
+     *   *                 all attributes of an object or all elements of an array, also written as [*]
+     *   [start:end:step]  array slice, every part is optional and can be negative, e.g. [1:], [:-1], [::2], [::-1]
+     *   ..name            recursive descent, the name (or index, slice, wildcard) is searched in the value and all its descendants
+     *   [?(expression)]   all children for which the expression is true, see QJsonPath::Filter, e.g. orders[?(@.total > 100)]
+     *   //                an empty segment is a recursive descent too, e.g. "a//b" or with separator '.' "a..b"
+     *
+     * Matches are produced on demand, stop iterating as soon as you have what you need.
+     *
+     * Example:
+     *   for (const auto& m : QJsonPath::Query("items[*]/price").match(doc))
+     *       qDebug() << m.path.toVariantList() << m.value;
+     */
+    class Query
+    {
+    public:
+        enum TokenType
+        {
+            Key,      //!< attribute name in an object
+            Index,    //!< index in an array
+            Wildcard, //!< all attributes of an object or elements of an array
+            Slice,    //!< range of array elements
+            Descent,  //!< the next token is applied to the value and all its descendants
+            Filter,   //!< all attributes of an object or elements of an array matching a QJsonPath::Filter
+        };
+
+        Query() = default;
+        explicit Query(const QString& path);
+        Query(const QString& path, QChar separator); //!< independent of the current separator
+
+        int size() const { return int(m_tokens.size()); }
+        bool isEmpty() const { return m_tokens.isEmpty(); }
+        TokenType type(int i) const { return m_tokens[i].type; }
+        const QString& key(int i) const { return m_tokens[i].key; }
+        int index(int i) const { return m_tokens[i].index; }
+
+        /**
+         * @brief Returns false if a filter expression of the query has a syntax error, the filter matches nothing then.
+         */
+        bool isValid() const;
+
+        /**
+         * @brief Returns a lazy range over all values matching the query, see QJsonPath::MatchRange.
+         * @param root [in] Object representing the JSON structure, it is never modified or detached.
+         */
+        MatchRange match(const QJsonValue& root) const;
+        MatchRange match(const QJsonObject& root) const;
+        MatchRange match(const QJsonArray& root) const;
+        MatchRange match(const QJsonDocument& root) const;
+
+    private:
+        friend class MatchIterator;
+
+        // slice bounds not given in the query
+        static constexpr int NoBound = -0x7fffffff - 1;
+
+        struct Token
+        {
+            QString key;
+            int index; // index, slice start or filter
+            int end;   // slice end
+            int step;  // slice step
+            TokenType type;
+        };
+        QVector<Token> m_tokens;
+        QVector<QJsonPath::Filter> m_filters;
+    };
+
+    //!  QJsonPath::MatchIterator
+    /*!
+     * Input iterator over the matches of a query, depth first in document order.
+     * The tree is walked with an explicit stack, nothing is visited before it is needed for the next match.
+     */
+    class MatchIterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Match;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Match*;
+        using reference = const Match&;
+
+        MatchIterator() = default; //!< end iterator
+
+        const Match& operator*() const { return m_match; }
+        const Match* operator->() const { return &m_match; }
+        MatchIterator& operator++();
+        bool operator==(const MatchIterator& other) const;
+        bool operator!=(const MatchIterator& other) const { return !(*this == other); }
+
+    private:
+        friend class MatchRange;
+        MatchIterator(const Query& query, const QJsonValue& root);
+        bool enter(QJsonValue value, int pos);
+        void advance();
+
+        struct Frame
+        {
+            QJsonValue value; // object or array whose children are visited
+            QJsonObject object;
+            QJsonArray array;
+            int pos;          // query token applied to the children
+            int pathSize;     // length of the match path at value
+            int cursor;       // next child, -1 is the value itself for a descent
+            int end;
+            int step;
+        };
+        Query m_query;
+        QVector<Frame> m_stack;
+        Match m_match;
+        bool m_atEnd = true;
+    };
+
+    //!  QJsonPath::MatchRange
+    /*!
+     * Lazy range of the matches of a query, evaluated while iterating. It shares the data of the root, changes of the root afterwards are not seen.
+     */
+    class MatchRange
+    {
+    public:
+        MatchRange(const Query& query, const QJsonValue& root) : m_query(query), m_root(root) {}
+
+        MatchIterator begin() const { return MatchIterator(m_query, m_root); }
+        MatchIterator end() const { return MatchIterator(); }
+
+        /**
+         * @brief Collects up to limit matches (all if limit is negative).
+         */
+        QVector<Match> toVector(int limit = -1) const;
+
+    private:
+        Query m_query;
+        QJsonValue m_root;
+    };
+
+    //!  QJsonPath::Stream
+    /*!
+     * Push mode evaluation of compiled paths on UTF-8 JSON text that is fed in chunks, e.g. from QIODevice::readyRead.
+     * The text is tokenized incrementally, only values at the end of a path are copied and converted, everything else is skipped.
+     * A match is passed to the callback as soon as its last byte has arrived. Memory depends on the nesting depth and the size of the matched values,
+     * not on the size of the document. A negative index keeps the last elements of its array until the array is closed.
+     * The values are the same as QJsonPath::get returns on the parsed document. If an object has a key more than once, every occurrence is reported
+     * and the last one is the value of get. As with QJsonDocument::fromJson, the root must be an object or an array.
+     *
+     * Example:
+     *   QJsonPath::Stream stream({ QJsonPath::Compiled("status"), QJsonPath::Compiled("items[0]/id") },
+     *                            [](int path, const QJsonValue& value) { qDebug() << path << value; });
+     *   QObject::connect(socket, &QIODevice::readyRead, [&] { stream.feed(socket); });
+     */
+    class Stream
+    {
+    public:
+        using Callback = std::function<void(int path, const QJsonValue& value)>;
+
+        Stream() = default;
+        Stream(const QVector<Compiled>& paths, const Callback& callback);
+
+        /**
+         * @brief Adds a path, it applies to values starting after this call.
+         * @return Position of the path passed to the callback.
+         */
+        int addPath(const Compiled& path);
+        int size() const { return int(m_paths.size()); }
+        void setCallback(const Callback& callback) { m_callback = callback; }
+
+        /**
+         * @brief Parses the next chunk of the text, matches complete in it are passed to the callback.
+         * @return False if the text is not valid JSON, see errorString. Further chunks are ignored then.
+         */
+        bool feed(const char* data, int size);
+        bool feed(const QByteArray& chunk) { return feed(chunk.constData(), int(chunk.size())); }
+        bool feed(QIODevice* device); //!< feeds all bytes available on device
+
+        bool isFinished() const { return m_state == Done; } //!< the root value is complete
+        bool hasError() const { return !m_error.isEmpty(); }
+        const QString& errorString() const { return m_error; }
+
+        /**
+         * @brief Starts a new document, paths and callback are kept.
+         */
+        void reset();
+
+    private:
+        enum State
+        {
+            Value,      // a value is expected
+            ValueOrEnd, // first element of an array
+            Key,        // key after a comma
+            KeyOrEnd,   // first key of an object
+            Colon,
+            CommaOrEnd,
+            String,
+            Literal,    // number, true, false or null
+            Done,
+        };
+        struct Tail
+        {
+            int path;                   // path with a negative index on this array
+            QList<QByteArray> elements; // text of the last -index elements
+        };
+        struct Frame
+        {
+            QVector<int> paths; // paths continuing below this container
+            QVector<Tail> tails;
+            int index;          // current element of an array
+            bool array;
+        };
+        struct Capture
+        {
+            int start; // position of the value text in m_capture
+            int depth;
+            int path;  // path reported, or -1 for an element of a tail
+            int tail;
+        };
+
+        void fail(const QString& message, int i);
+        int string(const char* data, int i, int size);
+        void key();
+        void beginValue(const char* data, int i);
+        void endValue(const char* data, int end);
+        void close(const char* data, int i);
+        void capture(const char* data, int i, int path, int tail);
+        void flush(const char* data, int end);
+
+        QVector<Compiled> m_paths;
+        Callback m_callback;
+        State m_state = Value;
+        QVector<Frame> m_frames; // open containers, entries above m_depth are kept for reuse
+        int m_depth = 0;
+        QVector<int> m_candidates; // paths addressing the next value
+        bool m_stringKey = false;
+        bool m_keyNeeded = false;
+        bool m_keyEscaped = false;
+        int m_escape = 0; // -1 after a backslash, else hex digits of a unicode escape left
+        QByteArray m_key;
+        QByteArray m_literal;
+        QVector<Capture> m_captures;
+        QByteArray m_capture; // text of the captured values, copied from the chunks
+        int m_chunkStart = 0; // first byte of the current chunk not yet copied to m_capture
+        qint64 m_offset = 0;  // bytes of the previous chunks
+        QString m_error;
+    };
+
+    //!  QJsonPath::Extractor
+    /*!
+     * Extracts the values of a set of compiled paths from raw UTF-8 JSON text, e.g. one record of a log, without building a document.
+     * First a structural index of the quotes, braces, brackets, colons and commas outside of strings is built 64 bytes at a time,
+     * with AVX2 or SSE2 if the CPU supports it (chosen at runtime) or else with a scalar kernel. The paths are then resolved on the index,
+     * unrelated subtrees are skipped by counting brackets without looking at their text, and only the matched values are decoded.
+     * The values are the same as QJsonPath::get returns on the parsed document, skipped values are not validated.
+     * The index buffer is kept between calls, use one extractor per thread.
+     *
+     * Example:
+     *   QJsonPath::Extractor extractor({ QJsonPath::Compiled("level"), QJsonPath::Compiled("request/id") });
+     *   QVector<QJsonValue> values;
+     *   for (const auto& record : records) {
+     *       if (extractor.extract(record, values))
+     *           qDebug() << values[0] << values[1];
+     *   }
+     */
+    class Extractor
+    {
+    public:
+        Extractor() = default;
+        explicit Extractor(const QVector<Compiled>& paths);
+
+        /**
+         * @return Position of the value in the results of extract.
+         */
+        int addPath(const Compiled& path);
+        int size() const { return int(m_paths.size()); }
+
+        /**
+         * @brief Extracts the values of all paths from a JSON text whose root is an object or an array.
+         * @param values [out] Values in the order of the paths, undefined if a path is not found.
+         * @return False if the structure of the text is not valid, see errorString. All values are undefined then.
+         */
+        bool extract(const char* data, int size, QVector<QJsonValue>& values);
+        bool extract(const QByteArray& json, QVector<QJsonValue>& values) { return extract(json.constData(), int(json.size()), values); }
+        QVector<QJsonValue> extract(const QByteArray& json);
+
+        const QString& errorString() const { return m_error; }
+
+        /**
+         * @brief Name of the kernel building the structural index on this CPU: "avx2", "sse2" or "scalar".
+         */
+        static const char* kernel();
+
+    private:
+        struct Walker;
+
+        QVector<Compiled> m_paths;
+        QVector<QVector<QByteArray>> m_keys; // UTF-8 keys of the paths, compared without decoding
+        QVector<int> m_all;                  // positions of all paths
+        QVector<QVector<int>> m_lists;       // candidate paths and array elements of each depth, reused
+        QVector<int> m_index;                // positions of the structural characters, reused
+        QByteArray m_buffer;                 // text of a decoded value
+        QString m_error;
+    };
+
+    //!  QJsonPath::LazyDocument
+    /*!
+     * Read-only document over a memory mapped JSON file (or a byte array) that is parsed on demand. Opening it only maps the file,
+     * a get scans just the containers on its path with the structural index kernels of the Extractor and records the offsets of their
+     * children, nested containers are skipped without looking at their text. Only the value at the end of the path is converted to a
+     * QJsonValue. The recorded containers are reused by later gets, so time and memory grow with what is read, not with the size of the file.
+     * The values are the same as QJsonPath::get returns on the parsed document, text not on a path is not validated.
+     * Function get caches the containers it visits, a document is re-entrant but not thread safe.
+     *
+     * Example:
+     *   QJsonPath::LazyDocument doc;
+     *   if (doc.open("catalog.json"))
+     *       qDebug() << QJsonPath::get(doc, "products/p1234/price");
+     */
+    class LazyDocument
+    {
+    public:
+        LazyDocument();
+        explicit LazyDocument(const QByteArray& json);
+        ~LazyDocument();
+        LazyDocument(const LazyDocument&) = delete;
+        LazyDocument& operator=(const LazyDocument&) = delete;
+
+        /**
+         * @brief Maps the file, a file that cannot be mapped is read into memory.
+         * @return False if the file cannot be read or its root is not an object or an array, see errorString.
+         */
+        bool open(const QString& fileName);
+        bool setData(const QByteArray& json); //!< uses the text of json, the data is shared, not copied
+        void close();
+
+        bool isNull() const { return !m_data; }
+        bool isObject() const { return m_data && m_data[m_root] == '{'; }
+        bool isArray() const { return m_data && m_data[m_root] == '['; }
+        qint64 size() const { return m_size; } //!< bytes of the text
+
+        /**
+         * @brief Value defined by path, the same as QJsonPath::get on the parsed document.
+         * @return Value if found, else defaultValue. Also defaultValue if the text on the path is not valid JSON, see errorString.
+         */
+        QJsonValue get(const Compiled& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined)) const;
+
+        int containerCount() const { return int(m_containers.size()); } //!< containers scanned so far
+        const QString& errorString() const { return m_error; }
+
+    private:
+        struct Container
+        {
+            qint64 end;             // after the closing bracket
+            QVector<qint64> begins; // text of the children
+            QVector<qint64> ends;
+            QVector<qint64> keys;   // opening quote of the key of each child of an object
+            QVector<int> keySizes;  // bytes between the quotes
+            QVector<quint64> table; // open addressing hash table of the keys, entries are the hash << 32 | child + 1, the last child if a key is repeated
+        };
+
+        bool setText(const char* data, qint64 size);
+        const Container* container(qint64 begin) const;
+        QByteArray key(const Container& container, int child) const;
+        int find(const Container& container, const QByteArray& key) const;
+        void fail(const QString& message, qint64 pos) const;
+
+        QScopedPointer<QFile> m_file;
+        QByteArray m_bytes; // text if not mapped
+        const char* m_data = nullptr;
+        qint64 m_size = 0;
+        qint64 m_root = 0;
+        mutable QHash<qint64, Container> m_containers; // by position of the opening bracket
+        mutable QByteArray m_buffer;                   // text of a decoded value
+        mutable QString m_error;
+    };
+
+    //!  QJsonPath::CborReader
+    /*!
+     * Extracts the values of a set of compiled paths from a CBOR item read by a QCborStreamReader, without building a QCborValue of it.
+     * Only the containers on the paths are entered, every other item is skipped by the reader using its length prefix, map keys are
+     * compared as UTF-8 bytes and only the matched values are decoded. The values are the same as QJsonPath::get returns on
+     * QCborValue::fromCbor of the item, so the first occurrence of a repeated key is used. An indefinite length array with a negative
+     * index on a path is decoded, as its size is only known at its end. The data must be complete, use one reader per thread.
+     *
+     * Example:
+     *   QJsonPath::CborReader reader({ QJsonPath::Compiled("status"), QJsonPath::Compiled("items[0]/id") });
+     *   QVector<QCborValue> values;
+     *   if (reader.read(cbor, values))
+     *       qDebug() << values[0] << values[1];
+     */
+    class CborReader
+    {
+    public:
+        CborReader() = default;
+        explicit CborReader(const QVector<Compiled>& paths);
+
+        /**
+         * @return Position of the value in the results of read.
+         */
+        int addPath(const Compiled& path);
+        int size() const { return int(m_paths.size()); }
+
+        /**
+         * @brief Reads the current item of reader, e.g. the next item of a CBOR sequence, and extracts the values of all paths from it.
+         * @param values [out] Values in the order of the paths, undefined if a path is not found.
+         * @return False if the item is not valid CBOR, see errorString. All values are undefined then.
+         */
+        bool read(QCborStreamReader& reader, QVector<QCborValue>& values);
+        bool read(const QByteArray& cbor, QVector<QCborValue>& values); //!< the data must be a single item
+        QVector<QCborValue> read(const QByteArray& cbor);
+
+        const QString& errorString() const { return m_error; }
+
+    private:
+        struct Walker;
+
+        QVector<Compiled> m_paths;
+        QVector<QVector<QByteArray>> m_keys; // UTF-8 keys of the paths, compared without decoding
+        QVector<int> m_all;                  // positions of all paths
+        QVector<QVector<int>> m_lists;       // candidate paths of each depth, reused
+        QByteArray m_key;                    // key of a map read from the stream, reused
+        QString m_error;
+    };
+
+    //!  QJsonPath::Builder
+    /*!
+     * Builds a new document from many set calls. Nodes are kept in a flat tree with their child lists in an arena and the keys interned,
+     * so a set neither detaches nor re-inserts any QJsonObject or QJsonArray and padding an array only appends node numbers.
+     * The document is converted once at the end with toDocument, or written by toJson as compact text without creating Qt containers.
+     * The result is the same as calling QJsonPath::set with the same paths and values in the same order on an empty QJsonValue.
+     *
+     * Example:
+     *   QJsonPath::Builder builder;
+     *   for (int i = 0; i < rows.size(); i++) {
+     *       builder.set(QVariantList{ "items", i, "id" }, rows[i].id);
+     *       builder.append(QVariantList{ "items", i, "tags" }, "new");
+     *   }
+     *   const QByteArray json = builder.toJson();
+     */
+    class Builder
+    {
+    public:
+        Builder();
+        ~Builder();
+        Builder(const Builder&) = delete;
+        Builder& operator=(const Builder&) = delete;
+
+        /**
+         * @brief Sets the value at path, missing containers on the path are created, the same as QJsonPath::set.
+         * @param path     [in] Path of the value.
+         * @param newValue [in] New assigned value, an object or array value is split up into nodes only if a later path enters it.
+         */
+        void set(const Compiled& path, const QJsonValue& newValue);
+        void set(const QString& path, const QJsonValue& newValue) { set(Compiled(path, Compiled::Temporary()), newValue); }
+        void set(const QVariantList& path, const QJsonValue& newValue) { set(Compiled(path, Compiled::Temporary()), newValue); }
+
+        /**
+         * @brief Appends newValue to the array at path, the array is created if missing. An empty path appends to the root array.
+         */
+        void append(const Compiled& path, const QJsonValue& newValue);
+        void append(const QString& path, const QJsonValue& newValue) { append(Compiled(path, Compiled::Temporary()), newValue); }
+        void append(const QVariantList& path, const QJsonValue& newValue) { append(Compiled(path, Compiled::Temporary()), newValue); }
+
+        /**
+         * @brief Inserts newValue before the array element of the last index of path, the following elements move up.
+         * A negative index counts down from the end as in set, an index after the end pads the array with null.
+         */
+        void insert(const Compiled& path, const QJsonValue& newValue);
+        void insert(const QString& path, const QJsonValue& newValue) { insert(Compiled(path, Compiled::Temporary()), newValue); }
+        void insert(const QVariantList& path, const QJsonValue& newValue) { insert(Compiled(path, Compiled::Temporary()), newValue); }
+
+        bool isEmpty() const;
+        void clear();
+        int nodeCount() const { return int(m_nodes.size()); }
+
+        QJsonValue toJsonValue() const; //!< undefined if nothing was set
+        QJsonDocument toDocument() const;
+        QByteArray toJson() const; //!< compact text as written by QJsonDocument::toJson, empty if nothing was set
+
+    private:
+        struct Node
+        {
+            qint32 type;       // QJsonValue::Type
+            qint32 key;        // interned key of an object member, -1 else
+            qint32 value;      // position in m_values of a value that is not split up into nodes, -1 else
+            qint32 object;     // id of the members of an object in m_members, renewed when the node becomes an object again
+            qint32 size;       // child nodes of an object or array
+            qint32 capacity;
+            qint32* children;  // in the arena
+        };
+        struct Member
+        {
+            qint32 object; // -1 for a free entry
+            qint32 key;
+            qint32 node;
+        };
+
+        qint32 child(qint32 parent, const Compiled& path, int pos);
+        qint32 member(qint32 object, const QString& key);
+        qint32 addNode(qint32 key);
+        void addMember(qint32 object, qint32 key, qint32 node);
+        void insertChild(qint32 parent, qint32 pos, qint32 node);
+        void container(qint32 n, QJsonValue::Type type);
+        void assign(qint32 n, const QJsonValue& value);
+        qint32* allocate(qint32 count);
+        QVector<qint32> keyRanks() const;
+        QVector<qint32> members(qint32 n, const QVector<qint32>& ranks) const;
+        QJsonValue value(qint32 n, const QVector<qint32>& ranks) const;
+        void write(QByteArray& out, qint32 n, const QVector<qint32>& ranks, const QVector<QByteArray>& keys) const;
+
+        QVector<Node> m_nodes;         // the root is node 0
+        QVector<QJsonValue> m_values;  // values of the nodes that are not split up
+        QHash<QString, qint32> m_keyIds;
+        QVector<QString> m_keys;
+        QVector<Member> m_members;     // open addressing hash table of the object members by object id and key
+        qint32 m_memberCount = 0;
+        qint32 m_objects = 0;
+        QVector<qint32*> m_blocks;     // arena of the child lists, a grown list leaves its old space unused
+        qint32* m_free = nullptr;
+        qint32 m_freeSize = 0;
+    };
+
+    //!  QJsonPath::SharedDocument
+    /*!
+     * A document read by many threads while other threads change it. A reader takes a Snapshot, an immutable version of the root
+     * which stays valid as long as the Snapshot lives. Taking it needs no lock and writes no counter shared with other readers,
+     * the reader only announces the version it uses in a slot of its own (a hazard pointer on a cache line of its own).
+     * Changes are serialized: each one copies the current root, which shares all containers implicitly, so only the containers
+     * on the changed path are copied, and publishes the result atomically as the next version.
+     * A replaced version is deleted by the next change, or the destructor, after the last Snapshot using it is gone.
+     * Readers should use compiled paths, a path string is compiled on every call.
+     *
+     * Example:
+     *   QJsonPath::SharedDocument config(QJsonDocument::fromJson(text).object());
+     *   const QJsonPath::Compiled host("server/host"), port("server/port");
+     *   // any number of reader threads, both values are from the same version
+     *   const auto snapshot = config.snapshot();
+     *   connectTo(snapshot.get(host).toString(), snapshot.get(port).toInt());
+     *   // updater thread
+     *   config.set(port, 8080);
+     */
+    class SharedDocument
+    {
+        struct Version;
+        struct Slot;
+        struct SlotBlock;
+
+    public:
+        class Snapshot
+        {
+        public:
+            Snapshot(Snapshot&& other) noexcept : m_slot(other.m_slot), m_version(other.m_version) { other.m_slot = nullptr; }
+            ~Snapshot();
+            Snapshot(const Snapshot&) = delete;
+            Snapshot& operator=(const Snapshot&) = delete;
+
+            const QJsonValue& root() const;
+            quint64 version() const; //!< 0 for the initial root, incremented by every change
+
+            QJsonValue get(const Compiled& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined)) const;
+            QJsonValue get(const QString& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined)) const { return get(Compiled(path, Compiled::Temporary()), defaultValue); }
+            QJsonValue get(const QVariantList& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined)) const { return get(Compiled(path, Compiled::Temporary()), defaultValue); }
+
+        private:
+            friend class SharedDocument;
+            Snapshot(Slot* slot, const Version* version) : m_slot(slot), m_version(version) {}
+
+            Slot* m_slot;
+            const Version* m_version;
+        };
+
+        explicit SharedDocument(const QJsonValue& root = QJsonValue(QJsonValue::Object));
+        ~SharedDocument(); //!< no Snapshot may be alive anymore
+        SharedDocument(const SharedDocument&) = delete;
+        SharedDocument& operator=(const SharedDocument&) = delete;
+
+        /**
+         * @brief Returns the current version, thread safe and lock free.
+         */
+        Snapshot snapshot() const;
+        QJsonValue get(const Compiled& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined)) const { return snapshot().get(path, defaultValue); }
+
+        /**
+         * @brief Applies a change to a copy of the current root and publishes it, thread safe, changes are serialized.
+         * @param change [in/out] Called with the copy, e.g. to run a QJsonPath::Batch or several sets.
+         * @return Version of the published root.
+         */
+        quint64 update(const std::function<void(QJsonValue& root)>& change);
+        quint64 set(const Compiled& path, const QJsonValue& newValue);
+        quint64 set(const QString& path, const QJsonValue& newValue) { return set(Compiled(path, Compiled::Temporary()), newValue); }
+        quint64 set(const QVariantList& path, const QJsonValue& newValue) { return set(Compiled(path, Compiled::Temporary()), newValue); }
+        quint64 remove(const Compiled& path);
+        quint64 remove(const QString& path) { return remove(Compiled(path, Compiled::Temporary())); }
+        quint64 remove(const QVariantList& path) { return remove(Compiled(path, Compiled::Temporary())); }
+
+    private:
+        Slot* acquireSlot() const;
+        void reclaim();
+
+        std::atomic<Version*> m_current;
+        mutable std::atomic<SlotBlock*> m_slots; // grows by a block when all slots are used, never shrinks
+        QMutex m_writer;
+        QVector<Version*> m_retired;             // replaced versions, deleted when no slot announces them anymore
+    };
+
+    //!  QJsonPath::Projection
+    /*!
+     * Writes the values of a list of paths of a document as compact JSON text with their nested structure, e.g. the fields selected
+     * by a request, without creating a QJsonObject or QJsonArray for the result. The paths are merged into a tree once, write walks
+     * it along the document and streams the text into a QByteArray or a QIODevice. Paths missing in the document are left out, as are
+     * containers that would stay empty. A path that is a prefix of another one selects its whole value.
+     * The text is the same as QJsonDocument::toJson(QJsonDocument::Compact) of a new document after QJsonPath::set of every
+     * existing path with its value; array elements keep their positions, elements before them that are not selected are null.
+     * Negative indexes count down from the end of the array of the document.
+     *
+     * Example:
+     *   const QJsonPath::Projection fields(QStringList{ "id", "name", "address/city" });
+     *   fields.write(socket, doc); // {"address":{"city":"Berlin"},"id":7,"name":"x"}
+     */
+    class Projection
+    {
+    public:
+        explicit Projection(const QVector<Compiled>& paths);
+        explicit Projection(const QStringList& paths);
+
+        int pathCount() const { return m_paths; }
+
+        /**
+         * @brief Appends the projection of root to out. A root that is not an object or array is written only for an empty path.
+         */
+        void write(QByteArray& out, const QJsonValue& root) const;
+        void write(QByteArray& out, const QJsonDocument& root) const;
+        /**
+         * @brief Writes the projection of root to device in chunks, false if the device did not take all of it.
+         */
+        bool write(QIODevice* device, const QJsonValue& root) const;
+        bool write(QIODevice* device, const QJsonDocument& root) const;
+
+        QByteArray toJson(const QJsonValue& root) const { QByteArray out; write(out, root); return out; }
+        QByteArray toJson(const QJsonDocument& root) const { QByteArray out; write(out, root); return out; }
+
+    private:
+        struct Member
+        {
+            QString key;
+            QByteArray text; // escaped key with the colon
+            qint32 node;
+        };
+        struct Node
+        {
+            bool leaf = false;            // the whole value is selected
+            QVector<Member> members;      // sorted by key, the order of QJsonObject
+            QVector<QPair<qint32, qint32>> elements; // index and node
+        };
+        struct Writer;
+
+        void add(const Compiled& path);
+
+        QVector<Node> m_nodes;
+        int m_paths = 0;
+    };
+
+    //!  QJsonPath::ParallelQuery
+    /*!
+     * Evaluates a path on every element of a large array with several threads, e.g. "samples[*]/value" of millions of samples.
+     * The array is split into ranges which the calling thread and idle threads of QThreadPool::globalInstance take one after another.
+     * All threads read the same array with const functions only, nothing is detached or copied. collect returns the values in the
+     * order of the elements, reduce sums up the numbers without collecting them. Arrays smaller than two ranges are evaluated
+     * on the calling thread. The ranges depend only on the array size and the minimum range, so reduce returns the same sums
+     * for any number of threads.
+     *
+     * Example:
+     *   const QJsonPath::ParallelQuery query("samples[*]/value");
+     *   const auto stats = query.reduce(doc);
+     *   qDebug() << stats.count << stats.min << stats.max << stats.mean();
+     */
+    class ParallelQuery
+    {
+    public:
+        struct Reduction
+        {
+            qint64 count = 0;  //!< elements with a number at the path
+            qint64 others = 0; //!< elements without a number at the path
+            double sum = 0;
+            double min = std::numeric_limits<double>::infinity();
+            double max = -std::numeric_limits<double>::infinity();
+
+            double mean() const { return count ? sum / double(count) : std::numeric_limits<double>::quiet_NaN(); }
+            void add(const QJsonValue& value);
+            void add(const Reduction& other);
+        };
+
+        /**
+         * @param arrayPath   [in] Path of the array.
+         * @param elementPath [in] Path of the value in each element, an empty path is the element itself.
+         */
+        ParallelQuery(const Compiled& arrayPath, const Compiled& elementPath);
+        /**
+         * @param path [in] Path string with exactly one "[*]" for the elements of the array, e.g. "samples[*]/value", or "[*]/value" for a root array.
+         */
+        explicit ParallelQuery(const QString& path);
+
+        bool isValid() const { return m_valid; } //!< false if a path string does not have exactly one "[*]"
+        void setThreadCount(int threads) { m_threads = threads; } //!< 0 (default) uses QThread::idealThreadCount
+        void setMinimumRange(int elements) { m_minimumRange = qMax(1, elements); } //!< elements of a range at least, default 16384
+
+        /**
+         * @brief Values at the element path of all elements, in order, undefined for elements without the path.
+         */
+        QVector<QJsonValue> collect(const QJsonValue& root) const;
+        QVector<QJsonValue> collect(const QJsonObject& root) const { return collect(QJsonValue(root)); }
+        QVector<QJsonValue> collect(const QJsonArray& root) const { return collect(QJsonValue(root)); }
+        QVector<QJsonValue> collect(const QJsonDocument& root) const;
+
+        /**
+         * @brief Count, sum, minimum and maximum of the numbers at the element path.
+         */
+        Reduction reduce(const QJsonValue& root) const;
+        Reduction reduce(const QJsonObject& root) const { return reduce(QJsonValue(root)); }
+        Reduction reduce(const QJsonArray& root) const { return reduce(QJsonValue(root)); }
+        Reduction reduce(const QJsonDocument& root) const;
+
+    private:
+        int rangeCount(int size) const;
+        void run(int size, int ranges, const std::function<void(int range, int begin, int end)>& work) const;
+
+        Compiled m_arrayPath;
+        Compiled m_elementPath;
+        bool m_valid = true;
+        int m_threads = 0;
+        int m_minimumRange = 16384;
+    };
+
+    //!  QJsonPath::Index
+    /*!
+     * Hash index of the elements of an array of objects by a key, e.g. the element of "users" whose "id" is 42,
+     * found in O(1) instead of a get on every element. Keys are strings or numbers, a key shared by several elements finds the first.
+     * The index owns the root it indexes, so it can never be used with another document: change the root through set, remove
+     * and take of the index, which invalidate it when they change the array, an ancestor of it or the key of an element, and
+     * keep it for changes of other attributes of the elements. For any other change take the root out with takeRoot and put it
+     * back with setRoot, which invalidates the index. An invalid index is rebuilt by the next lookup.
+     * Array indexes in the array path match every index when changes are compared.
+     *
+     * Example:
+     *   QJsonPath::Index users(std::move(doc), QJsonPath::Compiled("users"), QJsonPath::Compiled("id"));
+     *   const int pos = users.find(42);
+     *   const auto name = users.get(42, QJsonPath::Compiled("name"));
+     *   users.set("users[+]/id", 43);
+     */
+    class Index
+    {
+    public:
+        Index(QJsonValue root, const Compiled& arrayPath, const Compiled& keyPath);
+        Index(const QJsonDocument& root, const Compiled& arrayPath, const Compiled& keyPath);
+        Index(const Index&) = delete;
+        Index& operator=(const Index&) = delete;
+
+        /**
+         * @brief Position of the first element with the key in the array, -1 if there is none.
+         */
+        int find(const QJsonValue& key);
+
+        /**
+         * @brief Value at subPath of the first element with the key, the element itself for an empty subPath.
+         */
+        QJsonValue get(const QJsonValue& key, const Compiled& subPath = Compiled(), const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined));
+
+        /**
+         * @brief QJsonPath::set, QJsonPath::remove and QJsonPath::take on the root, invalidating the index if they can change it.
+         */
+        void set(const Compiled& path, QJsonValue newValue);
+        void set(const QString& path, QJsonValue newValue) { set(Compiled(path, Compiled::Temporary()), std::move(newValue)); }
+        void remove(const Compiled& path);
+        void remove(const QString& path) { remove(Compiled(path, Compiled::Temporary())); }
+        QJsonValue take(const Compiled& path);
+        QJsonValue take(const QString& path) { return take(Compiled(path, Compiled::Temporary())); }
+
+        const QJsonValue& root() const { return m_root; }
+        QJsonValue takeRoot(); //!< moves the root out, without a copy, the index is empty and invalid then
+        void setRoot(QJsonValue root);
+
+        const Compiled& arrayPath() const { return m_arrayPath; }
+        const Compiled& keyPath() const { return m_keyPath; }
+        bool isValid() const { return m_valid; }
+        void invalidate() { m_valid = false; }
+        int rebuilds() const { return m_rebuilds; } //!< times the index was built
+
+        /**
+         * @brief True if a change at path can change the array or the key of an element.
+         */
+        bool isAffectedBy(const Compiled& path) const;
+
+    private:
+        void build();
+
+        QJsonValue m_root;
+        Compiled m_arrayPath;
+        Compiled m_keyPath;
+        QHash<QString, int> m_strings;
+        QHash<double, int> m_numbers;
+        bool m_valid = false;
+        int m_rebuilds = 0;
+    };
+
+    //!  QJsonPath::Journal
+    /*!
+     * Records the set and remove calls made through it as JSON Patch operations (RFC 6902), so replicas can be updated with the
+     * changes instead of the whole document. Paths are JSON Pointers (RFC 6901) with the indexes resolved against the array sizes
+     * at the time of the change: a negative index is recorded as the element it counted down to, every null element padding an
+     * array is an add of its own and a container created or replaced by a set is recorded once, with its new content.
+     * A set or remove that changes nothing records nothing.
+     * Journal::apply replays a patch, consecutive operations on independent paths are collected into one QJsonPath::Batch,
+     * so their common containers are taken out and written back once.
+     *
+     * Example:
+     *   QJsonPath::Journal journal;
+     *   journal.set(state, "services/svc1/port", 8081);
+     *   journal.remove(state, "services/svc2");
+     *   send(QJsonDocument(journal.patch()).toJson(QJsonDocument::Compact));
+     *   // on the replica
+     *   QString error;
+     *   if (!QJsonPath::Journal::apply(replica, QJsonDocument::fromJson(message).array(), &error))
+     *       qWarning() << error;
+     */
+    class Journal
+    {
+    public:
+        /**
+         * @brief Calls QJsonPath::set and records the operations of the change.
+         */
+        void set(QJsonValue& root, const Compiled& path, const QJsonValue& newValue);
+        void set(QJsonObject& root, const Compiled& path, const QJsonValue& newValue);
+        void set(QJsonArray& root, const Compiled& path, const QJsonValue& newValue);
+        void set(QJsonDocument& root, const Compiled& path, const QJsonValue& newValue);
+        template <class T> void set(T& root, const QString& path, const QJsonValue& newValue) { set(root, Compiled(path, Compiled::Temporary()), newValue); }
+        template <class T> void set(T& root, const QVariantList& path, const QJsonValue& newValue) { set(root, Compiled(path, Compiled::Temporary()), newValue); }
+
+        /**
+         * @brief Calls QJsonPath::remove and records a remove operation if the value existed.
+         */
+        void remove(QJsonValue& root, const Compiled& path);
+        void remove(QJsonObject& root, const Compiled& path);
+        void remove(QJsonArray& root, const Compiled& path);
+        void remove(QJsonDocument& root, const Compiled& path);
+        template <class T> void remove(T& root, const QString& path) { remove(root, Compiled(path, Compiled::Temporary())); }
+        template <class T> void remove(T& root, const QVariantList& path) { remove(root, Compiled(path, Compiled::Temporary())); }
+
+        const QJsonArray& patch() const { return m_patch; } //!< operations recorded since the last clear
+        int size() const { return int(m_patch.size()); }
+        bool isEmpty() const { return m_patch.isEmpty(); }
+        void clear() { m_patch = QJsonArray(); }
+
+        /**
+         * @brief Applies a JSON Patch with the operations add, remove, replace, move, copy and test to root.
+         * The root is only changed if all operations succeed.
+         * @param root        [in/out] Object representing the JSON structure, an object or array root must keep its type.
+         * @param patch       [in] Array of operations.
+         * @param errorString [out] Position and reason of the failed operation, unchanged on success.
+         * @return False if an operation is not valid, its path does not exist or a test fails.
+         */
+        static bool apply(QJsonValue& root, const QJsonArray& patch, QString* errorString = nullptr);
+        static bool apply(QJsonObject& root, const QJsonArray& patch, QString* errorString = nullptr);
+        static bool apply(QJsonArray& root, const QJsonArray& patch, QString* errorString = nullptr);
+        static bool apply(QJsonDocument& root, const QJsonArray& patch, QString* errorString = nullptr);
+
+    private:
+        struct Change;
+
+        QVector<Change> record(const QJsonValue& root, const Compiled& path, const QJsonValue& newValue, bool remove) const;
+        template <class T> void commit(const T& root, const QVector<Change>& changes);
+
+        QJsonArray m_patch;
+    };
+
+    //!  QJsonPath::OperationStats
+    /*!
+     * Counters of a single get, set or remove on a JSON root, passed to the callback registered with setStatsCallback.
+     * Qt does not expose reference counts, a container is copied on its first change if it is shared with another
+     * document, e.g. a copy of the root, so modified is the upper bound of the detaches of an operation.
+     */
+    struct OperationStats
+    {
+        enum Operation
+        {
+            Get,
+            Set,
+            Remove,
+        };
+        Operation operation = Get;
+        int depth = 0;          //!< tokens of the path
+        int nodes = 0;          //!< containers entered along the path
+        int modified = 0;       //!< containers changed inplace, none if a remove or take does not find the path
+        int created = 0;        //!< containers created for missing values or values of another type on the path
+        int padding = 0;        //!< null elements appended to arrays
+        qint64 nanoseconds = 0; //!< latency of the operation
+    };
+    using StatsCallback = std::function<void(const OperationStats&)>;
+
+    //!  QJsonPath::Statistics
+    /*!
+     * Sums of OperationStats and a latency histogram, e.g. filled by a registered callback.
+     * It is not thread safe, lock it in the callback if operations run on several threads.
+     *
+     * Example:
+     *   QJsonPath::Statistics statistics;
+     *   QJsonPath::setStatsCallback([&statistics](const QJsonPath::OperationStats& stats) { statistics.add(stats); }, 100);
+     *   ...
+     *   QJsonPath::setStatsCallback(nullptr);
+     *   qDebug() << statistics.count[QJsonPath::OperationStats::Set] << statistics.percentile(0.99) << "ns";
+     */
+    struct Statistics
+    {
+        qint64 count[3] = {};     //!< operations by OperationStats::Operation
+        qint64 nodes = 0;
+        qint64 modified = 0;
+        qint64 created = 0;
+        qint64 padding = 0;
+        qint64 histogram[64] = {}; //!< bucket i counts latencies below 2^i ns, not counted by a lower bucket
+
+        void add(const OperationStats& stats);
+
+        /**
+         * @return Upper bound in ns of the latency bucket reaching the fraction (0 to 1) of all operations, 0 if there are none.
+         */
+        qint64 percentile(double fraction) const;
+    };
+
+    // CBOR roots have their own get overloads for path strings, they return QCborValue
+    template <class T> using IsCbor = std::integral_constant<bool, std::is_same<typename std::decay<T>::type, QCborValue>::value || std::is_same<typename std::decay<T>::type, QCborMap>::value
+                                                                 || std::is_same<typename std::decay<T>::type, QCborArray>::value>;
+
+    /**
+     * @brief Function will return a lazy range of all values matching a query string, see QJsonPath::Query.
+     * @param root  [in] Object representing the JSON structure.
+     * @param query [in] Query string (default seperator is '/').
+     */
+    template <class T> static MatchRange match(const T& root, const QString& query)
+    {
+        return Query(query).match(root);
+    }
+
     /**
      * @brief Function will modify a json object inplace, setting the json attribute definied by path to newValue, creating the full path if missing.
      * @param root     [in/out] Object representing the JSON structure.
@@ -55,7 +1371,11 @@ public:
      */
     template <class T> static void set(T& root, const QString& path, const QJsonValue& newValue)
     {
-        set(root, splitPath(path), newValue);
+        set(root, Compiled(path, Compiled::Temporary()), newValue);
+    }
+    template <class T> static void set(T& root, const QString& path, QJsonValue&& newValue)
+    {
+        set(root, Compiled(path, Compiled::Temporary()), std::move(newValue));
     }
 
     /**
@@ -68,22 +1388,47 @@ public:
     static void set(QJsonObject& root, const QVariantList& path, const QJsonValue& newValue);
     static void set(QJsonArray& root, const QVariantList& path, const QJsonValue& newValue);
     static void set(QJsonDocument& root, const QVariantList& path, const QJsonValue& newValue);
+    static void set(QJsonValue& root, const QVariantList& path, QJsonValue&& newValue);
+    static void set(QJsonObject& root, const QVariantList& path, QJsonValue&& newValue);
+    static void set(QJsonArray& root, const QVariantList& path, QJsonValue&& newValue);
+    static void set(QJsonDocument& root, const QVariantList& path, QJsonValue&& newValue);
+
+    /**
+     * @brief Function will modify a json object inplace, setting the json attribute definied by path to newValue, creating the full path if missing.
+     * @param root     [in/out] Object representing the JSON structure.
+     * @param path     [in] Precompiled path.
+     * @param newValue [in] New assigned value.
+     */
+    static void set(QJsonValue& root, const Compiled& path, const QJsonValue& newValue);
+    static void set(QJsonObject& root, const Compiled& path, const QJsonValue& newValue);
+    static void set(QJsonArray& root, const Compiled& path, const QJsonValue& newValue);
+    static void set(QJsonDocument& root, const Compiled& path, const QJsonValue& newValue);
+
+    /**
+     * @brief Same as set, newValue is moved into the tree. A subtree taken from a document and set somewhere else this way keeps
+     * its containers unshared, so later changes inside of it are made inplace without copying it.
+     */
+    static void set(QJsonValue& root, const Compiled& path, QJsonValue&& newValue);
+    static void set(QJsonObject& root, const Compiled& path, QJsonValue&& newValue);
+    static void set(QJsonArray& root, const Compiled& path, QJsonValue&& newValue);
+    static void set(QJsonDocument& root, const Compiled& path, QJsonValue&& newValue);
 
     /**
      * @brief Function will retrieve a json object defined by path. The json object can also be part of a tree with child elements.
-     * @param root         [in/out] Object representing the JSON structure.
+     * @param root         [in] Object representing the JSON structure, it is never modified or detached.
      * @param path         [in] Path expression string (default seperator is '/').
      * @param defaultValue [in] Value returned when the key is not found.
      * @return Value if found, else defaultValue.
      */
-    template <class T> static QJsonValue get(T& root, const QString& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined))
+    template <class T, typename std::enable_if<!IsCbor<T>::value, int>::type = 0>
+    static QJsonValue get(T& root, const QString& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined))
     {
-        return get(root, splitPath(path), defaultValue);
+        return get(root, Compiled(path, Compiled::Temporary()), defaultValue);
     }
 
     /**
      * @brief Function will retrieve a json object defined by path. The json object can also be part of a tree with child elements.
-     * @param root         [in/out] Object representing the JSON structure.
+     * @param root         [in] Object representing the JSON structure, it is never modified or detached.
      * @param path         [in] Path expression list.
      * @param defaultValue [in] Value returned when the key is not found.
      * @return Value if found, else defaultValue.
@@ -92,6 +1437,20 @@ public:
     static QJsonValue get(const QJsonObject& root, const QVariantList& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined));
     static QJsonValue get(const QJsonArray& root, const QVariantList& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined));
     static QJsonValue get(const QJsonDocument& root, const QVariantList& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined));
+    static QJsonValue get(const LazyDocument& root, const QVariantList& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined));
+
+    /**
+     * @brief Function will retrieve a json object defined by path. The json object can also be part of a tree with child elements.
+     * @param root         [in] Object representing the JSON structure, it is never modified or detached.
+     * @param path         [in] Precompiled path.
+     * @param defaultValue [in] Value returned when the key is not found.
+     * @return Value if found, else defaultValue.
+     */
+    static QJsonValue get(const QJsonValue& root, const Compiled& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined));
+    static QJsonValue get(const QJsonObject& root, const Compiled& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined));
+    static QJsonValue get(const QJsonArray& root, const Compiled& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined));
+    static QJsonValue get(const QJsonDocument& root, const Compiled& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined));
+    static QJsonValue get(const LazyDocument& root, const Compiled& path, const QJsonValue& defaultValue = QJsonValue(QJsonValue::Undefined)) { return root.get(path, defaultValue); }
 
     /**
      * @brief Function will delete a json attribute or array element defined by path inplace.
@@ -100,7 +1459,7 @@ public:
      */
     template <class T> static void remove(T& root, const QString& path)
     {
-        remove(root, splitPath(path));
+        remove(root, Compiled(path, Compiled::Temporary()));
     }
 
     /**
@@ -113,6 +1472,158 @@ public:
     static void remove(QJsonArray& root, const QVariantList& path);
     static void remove(QJsonDocument& root, const QVariantList& path);
 
+    /**
+     * @brief Function will delete a json attribute or array element defined by path inplace.
+     * @param root   [in/out] Object representing the JSON structure.
+     * @param path   [in] Precompiled path.
+     */
+    static void remove(QJsonValue& root, const Compiled& path);
+    static void remove(QJsonObject& root, const Compiled& path);
+    static void remove(QJsonArray& root, const Compiled& path);
+    static void remove(QJsonDocument& root, const Compiled& path);
+
+    /**
+     * @brief Function will remove the json attribute or array element defined by path inplace and return it, in a single traversal.
+     * The value is moved out of the tree, so a subtree that was not shared with other copies of root is returned unshared.
+     * @param root   [in/out] Object representing the JSON structure.
+     * @param path   [in] Path expression string, list or precompiled path.
+     * @return Removed value, undefined if the path does not exist.
+     */
+    template <class T> static QJsonValue take(T& root, const QString& path)
+    {
+        return take(root, Compiled(path, Compiled::Temporary()));
+    }
+    static QJsonValue take(QJsonValue& root, const QVariantList& path);
+    static QJsonValue take(QJsonObject& root, const QVariantList& path);
+    static QJsonValue take(QJsonArray& root, const QVariantList& path);
+    static QJsonValue take(QJsonDocument& root, const QVariantList& path);
+    static QJsonValue take(QJsonValue& root, const Compiled& path);
+    static QJsonValue take(QJsonObject& root, const Compiled& path);
+    static QJsonValue take(QJsonArray& root, const Compiled& path);
+    static QJsonValue take(QJsonDocument& root, const Compiled& path);
+
+    /**
+     * @brief Function will move the value at path from to path to, a take followed by a set with the taken value, without copying it.
+     * Path to is resolved after the value is removed, e.g. moving "items[0]" to "items[-1]" replaces the last of the remaining elements.
+     * @param root   [in/out] Object representing the JSON structure.
+     * @param from   [in] Path of the value, path expression string, list or precompiled path.
+     * @param to     [in] New path of the value, missing parents are created as by set.
+     * @return false if from does not exist or to cannot be set, e.g. an index counting down beyond the first element or an index
+     *         on a QJsonObject root, root is unchanged then.
+     */
+    template <class T> static bool move(T& root, const QString& from, const QString& to)
+    {
+        return move(root, Compiled(from, Compiled::Temporary()), Compiled(to, Compiled::Temporary()));
+    }
+    static bool move(QJsonValue& root, const QVariantList& from, const QVariantList& to);
+    static bool move(QJsonObject& root, const QVariantList& from, const QVariantList& to);
+    static bool move(QJsonArray& root, const QVariantList& from, const QVariantList& to);
+    static bool move(QJsonDocument& root, const QVariantList& from, const QVariantList& to);
+    static bool move(QJsonValue& root, const Compiled& from, const Compiled& to);
+    static bool move(QJsonObject& root, const Compiled& from, const Compiled& to);
+    static bool move(QJsonArray& root, const Compiled& from, const Compiled& to);
+    static bool move(QJsonDocument& root, const Compiled& from, const Compiled& to);
+
+    /**
+     * @brief Function will insert value before the array element of the last index of path, the following elements move up.
+     * A negative index counts down from the end as in set, an index after the end pads the array with null, "[+]" appends.
+     * The array operations below take the array out of the tree once, change it inplace and put it back, missing parents and
+     * the array are created as by set, a value that is no array is replaced by an array. An empty array path is the root array.
+     * @param root   [in/out] Object representing the JSON structure.
+     * @param path   [in] Path of the new element, path expression string or precompiled path.
+     * @param value  [in] Inserted value.
+     */
+    template <class T> static void insert(T& root, const QString& path, const QJsonValue& value)
+    {
+        insert(root, Compiled(path, Compiled::Temporary()), value);
+    }
+    static void insert(QJsonValue& root, const Compiled& path, const QJsonValue& value);
+    static void insert(QJsonObject& root, const Compiled& path, const QJsonValue& value);
+    static void insert(QJsonArray& root, const Compiled& path, const QJsonValue& value);
+    static void insert(QJsonDocument& root, const Compiled& path, const QJsonValue& value);
+
+    /**
+     * @brief Function will replace removeCount elements of the array at arrayPath from pos on with values, as Array.splice in JavaScript.
+     * A negative pos counts down from the end, pos and removeCount are clamped to the array. It runs in O(elements after pos + values).
+     * @return Removed elements.
+     */
+    template <class T> static QJsonArray splice(T& root, const QString& arrayPath, int pos, int removeCount, const QJsonArray& values = QJsonArray())
+    {
+        return splice(root, Compiled(arrayPath, Compiled::Temporary()), pos, removeCount, values);
+    }
+    static QJsonArray splice(QJsonValue& root, const Compiled& arrayPath, int pos, int removeCount, const QJsonArray& values = QJsonArray());
+    static QJsonArray splice(QJsonObject& root, const Compiled& arrayPath, int pos, int removeCount, const QJsonArray& values = QJsonArray());
+    static QJsonArray splice(QJsonArray& root, const Compiled& arrayPath, int pos, int removeCount, const QJsonArray& values = QJsonArray());
+    static QJsonArray splice(QJsonDocument& root, const Compiled& arrayPath, int pos, int removeCount, const QJsonArray& values = QJsonArray());
+
+    /**
+     * @brief Function will append all values to the array at arrayPath, taking the array out of the tree once instead of once per element.
+     */
+    template <class T> static void appendRange(T& root, const QString& arrayPath, const QJsonArray& values)
+    {
+        appendRange(root, Compiled(arrayPath, Compiled::Temporary()), values);
+    }
+    static void appendRange(QJsonValue& root, const Compiled& arrayPath, const QJsonArray& values);
+    static void appendRange(QJsonObject& root, const Compiled& arrayPath, const QJsonArray& values);
+    static void appendRange(QJsonArray& root, const Compiled& arrayPath, const QJsonArray& values);
+    static void appendRange(QJsonDocument& root, const Compiled& arrayPath, const QJsonArray& values);
+
+    /**
+     * @brief Function will remove the elements of the array at arrayPath from size on or append fill up to size.
+     */
+    template <class T> static void resize(T& root, const QString& arrayPath, int size, const QJsonValue& fill = QJsonValue())
+    {
+        resize(root, Compiled(arrayPath, Compiled::Temporary()), size, fill);
+    }
+    static void resize(QJsonValue& root, const Compiled& arrayPath, int size, const QJsonValue& fill = QJsonValue());
+    static void resize(QJsonObject& root, const Compiled& arrayPath, int size, const QJsonValue& fill = QJsonValue());
+    static void resize(QJsonArray& root, const Compiled& arrayPath, int size, const QJsonValue& fill = QJsonValue());
+    static void resize(QJsonDocument& root, const Compiled& arrayPath, int size, const QJsonValue& fill = QJsonValue());
+
+    /**
+     * @brief Function will set all elements of the array at arrayPath to value, after resizing it to size if size is not negative.
+     */
+    template <class T> static void fill(T& root, const QString& arrayPath, const QJsonValue& value, int size = -1)
+    {
+        fill(root, Compiled(arrayPath, Compiled::Temporary()), value, size);
+    }
+    static void fill(QJsonValue& root, const Compiled& arrayPath, const QJsonValue& value, int size = -1);
+    static void fill(QJsonObject& root, const Compiled& arrayPath, const QJsonValue& value, int size = -1);
+    static void fill(QJsonArray& root, const Compiled& arrayPath, const QJsonValue& value, int size = -1);
+    static void fill(QJsonDocument& root, const Compiled& arrayPath, const QJsonValue& value, int size = -1);
+
+    /**
+     * @brief CBOR versions of set, get and remove, they work directly on the CBOR containers without a conversion to JSON.
+     * A key of a path matches the text string keys of a map, an index matches an array element. Missing parents are created by set
+     * as with JSON, arrays are padded with null. A value that is not found is QCborValue::Undefined.
+     */
+    static void set(QCborValue& root, const QString& path, const QCborValue& newValue) { set(root, Compiled(path, Compiled::Temporary()), newValue); }
+    static void set(QCborMap& root, const QString& path, const QCborValue& newValue) { set(root, Compiled(path, Compiled::Temporary()), newValue); }
+    static void set(QCborArray& root, const QString& path, const QCborValue& newValue) { set(root, Compiled(path, Compiled::Temporary()), newValue); }
+    static void set(QCborValue& root, const QVariantList& path, const QCborValue& newValue);
+    static void set(QCborMap& root, const QVariantList& path, const QCborValue& newValue);
+    static void set(QCborArray& root, const QVariantList& path, const QCborValue& newValue);
+    static void set(QCborValue& root, const Compiled& path, const QCborValue& newValue);
+    static void set(QCborMap& root, const Compiled& path, const QCborValue& newValue);
+    static void set(QCborArray& root, const Compiled& path, const QCborValue& newValue);
+
+    static QCborValue get(const QCborValue& root, const QString& path, const QCborValue& defaultValue = QCborValue(QCborValue::Undefined)) { return get(root, Compiled(path, Compiled::Temporary()), defaultValue); }
+    static QCborValue get(const QCborMap& root, const QString& path, const QCborValue& defaultValue = QCborValue(QCborValue::Undefined)) { return get(root, Compiled(path, Compiled::Temporary()), defaultValue); }
+    static QCborValue get(const QCborArray& root, const QString& path, const QCborValue& defaultValue = QCborValue(QCborValue::Undefined)) { return get(root, Compiled(path, Compiled::Temporary()), defaultValue); }
+    static QCborValue get(const QCborValue& root, const QVariantList& path, const QCborValue& defaultValue = QCborValue(QCborValue::Undefined));
+    static QCborValue get(const QCborMap& root, const QVariantList& path, const QCborValue& defaultValue = QCborValue(QCborValue::Undefined));
+    static QCborValue get(const QCborArray& root, const QVariantList& path, const QCborValue& defaultValue = QCborValue(QCborValue::Undefined));
+    static QCborValue get(const QCborValue& root, const Compiled& path, const QCborValue& defaultValue = QCborValue(QCborValue::Undefined));
+    static QCborValue get(const QCborMap& root, const Compiled& path, const QCborValue& defaultValue = QCborValue(QCborValue::Undefined));
+    static QCborValue get(const QCborArray& root, const Compiled& path, const QCborValue& defaultValue = QCborValue(QCborValue::Undefined));
+
+    static void remove(QCborValue& root, const QVariantList& path);
+    static void remove(QCborMap& root, const QVariantList& path);
+    static void remove(QCborArray& root, const QVariantList& path);
+    static void remove(QCborValue& root, const Compiled& path);
+    static void remove(QCborMap& root, const Compiled& path);
+    static void remove(QCborArray& root, const Compiled& path);
+
     /**
      * @brief Function returns current path separator (default is '/').
      * @return Current character for separator.
@@ -121,15 +1632,28 @@ public:
 
     /**
      * @brief Function will change path separator to newSeparator. This is only used for path strings, path lists do not have a separator.
+     * It is safe to call while other threads use path strings, but it changes the separator for all of them,
+     * compile paths with an explicit separator instead if threads need different ones.
      * @param newSeparator New character for path separator.
      */
     static void setSeparator(QChar newSeparator);
 
+    /**
+     * @brief Registers a callback receiving the counters of every sampling-th get, set and remove on a JSON root, a null callback unregisters it.
+     * Operations are only counted and timed while a callback is registered. It is called on the thread of the operation.
+     * Each thread counts its own operations for the sampling, a sampled operation locks a mutex to get the callback.
+     * @param callback [in] Function called after the operation.
+     * @param sampling [in] 1 records every operation, n every n-th operation of a thread.
+     */
+    static void setStatsCallback(const StatsCallback& callback, int sampling = 1);
+
     /**
      * @brief Converts string path to a list path. Using QVariantList for path is a more flexible way of specifying a path, you can use separators or brackets in names or as a name.
+     * "[+]" is converted to an invalid QVariant, which a list path reads back as "[+]".
      * @param path String path specifying the JSON attribute (default seperator is '/').
      */
     static QVariantList splitPath(const QString& path);
+    static QVariantList splitPath(const QString& path, QChar separator);
 
     /**
      * @brief Unit test and examples on how to use the functions.
@@ -137,4 +1661,25 @@ public:
     static void unittest();
 };
 
+template <std::size_t N> QJsonPath::Compiled::Compiled(const Literal<N>& path)
+{
+    m_tokens.reserve(path.size());
+    for (int i = 0; i < path.size(); i++) {
+        if (path.type(i) == Key)
+            append(QString::fromUtf8(path.keyData(i), path.keySize(i)));
+        else if (path.type(i) == Append)
+            appendElement();
+        else
+            append(path.index(i));
+    }
+}
+
+// QJsonPath::Compiled of a path string literal, parsed and checked by the compiler and converted once on the first call, e.g.
+// QJsonPath::get(doc, QJSONPATH("limits/cpu[0]"))
+#define QJSONPATH(path) ([]() -> const QJsonPath::Compiled& {                      \
+    static constexpr QJsonPath::Literal<sizeof(path)> _qjsonpath_literal(path);    \
+    static const QJsonPath::Compiled _qjsonpath_compiled(_qjsonpath_literal);      \
+    return _qjsonpath_compiled;                                                    \
+}())
+
 #endif // QJSONPATH_H
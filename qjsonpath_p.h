@@ -0,0 +1,73 @@
+// MIT License Copyright (C) 2023 heksbeks https://github.com/heksbeks/qjsonpath
+
+#ifndef QJSONPATH_P_H
+#define QJSONPATH_P_H
+
+#include "qjsonpath.h"
+
+// Internal declarations shared by the QJsonPath source files, not part of the API.
+
+enum class HANDLE_JSON_OP
+{
+    SET,
+    REMOVE,
+    TAKE,   // remove and return the value
+    BORROW, // return the value and leave null in its place, the path is created as by SET, the value is put back by SET
+};
+
+// unit tests of the other source files, called by QJsonPath::unittest
+void _handleJsonAttribute_unittest_batch();
+void _handleJsonAttribute_unittest_query();
+void _handleJsonAttribute_unittest_filter();
+void _handleJsonAttribute_unittest_stream();
+void _handleJsonAttribute_unittest_extractor();
+void _handleJsonAttribute_unittest_lazy();
+void _handleJsonAttribute_unittest_cbor();
+void _handleJsonAttribute_unittest_builder();
+void _handleJsonAttribute_unittest_shared();
+void _handleJsonAttribute_unittest_patch();
+void _handleJsonAttribute_unittest_index();
+void _handleJsonAttribute_unittest_parallel();
+void _handleJsonAttribute_unittest_projection();
+void _handleJsonAttribute_unittest_bulk();
+
+// calls change with the array at path, taken out of root so it is changed inplace, and puts it back, in O(path depth) besides the change;
+// missing parents are created as by set, a value that is no array is replaced by an empty array, an empty path is the root itself
+void _handleJsonAttribute_changeArray(QJsonValue& root, const QJsonPath::Compiled& path, const std::function<void(QJsonArray& arr)>& change);
+void _handleJsonAttribute_changeArray(QJsonObject& root, const QJsonPath::Compiled& path, const std::function<void(QJsonArray& arr)>& change);
+void _handleJsonAttribute_changeArray(QJsonArray& root, const QJsonPath::Compiled& path, const std::function<void(QJsonArray& arr)>& change);
+void _handleJsonAttribute_changeArray(QJsonDocument& root, const QJsonPath::Compiled& path, const std::function<void(QJsonArray& arr)>& change);
+
+// compact JSON text of a string and of a value as written by QJsonDocument::toJson, appended to out
+void _handleJsonAttribute_writeString(QByteArray& out, const QString& text);
+void _handleJsonAttribute_writeValue(QByteArray& out, const QJsonValue& value);
+
+// true, false, null or a number as defined by RFC 8259
+bool _handleJsonAttribute_isLiteral(const char* text, int size);
+
+// value of the JSON text of a single value, undefined if the text is not valid, buffer is reused for values parsed by QJsonDocument
+QJsonValue _handleJsonAttribute_decode(const char* text, int length, QByteArray& buffer);
+
+// Structural characters of JSON text: {}[]:, outside of strings and the opening quotes of strings,
+// found 64 bytes at a time with the structural index kernels of QJsonPath::Extractor
+class _JsonScanner
+{
+public:
+    _JsonScanner(const char* data, qint64 size, qint64 pos); // pos must not be inside of a string
+    qint64 next(); //!< position of the next structural character, -1 at the end of the text
+    bool inString() const { return m_inStringCarry; } //!< the text scanned so far ends inside of a string
+
+private:
+    const char* m_data;
+    qint64 m_size;
+    qint64 m_base;          // next block
+    qint64 m_blockBase = 0; // current block
+    quint64 m_bits = 0;     // structural characters of the current block not returned yet
+    quint64 m_escapedCarry = 0;
+    quint64 m_inStringCarry = 0;
+};
+
+// appends all paths of value to paths, with negative indexes and paths that do not exist, for differential tests against get
+void _handleJsonAttribute_unittest_paths(const QJsonValue& value, QJsonPath::Compiled& path, QVector<QJsonPath::Compiled>& paths);
+
+#endif // QJSONPATH_P_H
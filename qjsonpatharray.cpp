@@ -0,0 +1,297 @@
+// MIT License Copyright (C) 2023 heksbeks https://github.com/heksbeks/qjsonpath
+
+#include "qjsonpath.h"
+#include "qjsonpath_p.h"
+#include <QJsonArray>
+
+
+// Every operation walks the path twice, once to borrow the array out of the tree as the only reference and once to put it
+// back after it is changed inplace. The elements behind a changed range are moved once, instead of once per inserted or removed element.
+
+template <class T> static void _array_insert(T& root, const QJsonPath::Compiled& path, const QJsonValue& value)
+{
+    const int last = path.size() - 1;
+    if (path.isEmpty() || (path.type(last) != QJsonPath::Compiled::Index && path.type(last) != QJsonPath::Compiled::Append)) {
+        Q_ASSERT_X(false, __FUNCTION__, "invalid path, path must end with an array index or \"[+]\"");
+        return;
+    }
+    auto arrayPath = path;
+    arrayPath.truncate(last);
+    const bool append = path.type(last) == QJsonPath::Compiled::Append;
+    const int index = path.index(last);
+    _handleJsonAttribute_changeArray(root, arrayPath, [&](QJsonArray& arr) {
+        const int size = int(arr.size());
+        int idx = append ? size : index;
+        if (idx < 0)
+            idx = size ? size + idx : 0; // -1 is last element
+        if (idx < 0) // counts down beyond the first element
+            return;
+        while (idx > arr.size())
+            arr.append(QJsonValue());
+        arr.insert(idx, value);
+    });
+}
+
+template <class T> static QJsonArray _array_splice(T& root, const QJsonPath::Compiled& arrayPath, int pos, int removeCount, const QJsonArray& values)
+{
+    QJsonArray removed;
+    _handleJsonAttribute_changeArray(root, arrayPath, [&](QJsonArray& arr) {
+        const int size = int(arr.size());
+        const int begin = pos < 0 ? qMax(0, size + pos) : qMin(pos, size);
+        const int count = qBound(0, removeCount, size - begin);
+        const int added = int(values.size());
+        for (int i = begin; i < begin + count; i++)
+            removed.append(arr.at(i));
+
+        if (count == added) {
+            for (int i = 0; i < added; i++)
+                arr.replace(begin + i, values.at(i));
+        }
+        else if (begin + count == size) {
+            // at the end nothing moves
+            for (int i = 0; i < count; i++)
+                arr.removeLast();
+            for (const auto& value : values)
+                arr.append(value);
+        }
+        else if (count + added == 1) {
+            if (count)
+                arr.removeAt(begin);
+            else
+                arr.insert(begin, values.first());
+        }
+        else {
+            // the elements behind the range are taken off once and appended again after the values
+            QJsonArray tail;
+            for (int i = begin + count; i < size; i++)
+                tail.append(arr.at(i));
+            while (arr.size() > begin)
+                arr.removeLast();
+            for (const auto& value : values)
+                arr.append(value);
+            for (const auto& value : tail)
+                arr.append(value);
+        }
+    });
+    return removed;
+}
+
+template <class T> static void _array_appendRange(T& root, const QJsonPath::Compiled& arrayPath, const QJsonArray& values)
+{
+    _handleJsonAttribute_changeArray(root, arrayPath, [&](QJsonArray& arr) {
+        for (const auto& value : values)
+            arr.append(value);
+    });
+}
+
+template <class T> static void _array_resize(T& root, const QJsonPath::Compiled& arrayPath, int size, const QJsonValue& fill)
+{
+    _handleJsonAttribute_changeArray(root, arrayPath, [&](QJsonArray& arr) {
+        while (arr.size() > qMax(size, 0))
+            arr.removeLast();
+        while (arr.size() < size)
+            arr.append(fill);
+    });
+}
+
+template <class T> static void _array_fill(T& root, const QJsonPath::Compiled& arrayPath, const QJsonValue& value, int size)
+{
+    _handleJsonAttribute_changeArray(root, arrayPath, [&](QJsonArray& arr) {
+        if (size < 0)
+            size = int(arr.size());
+        while (arr.size() > size)
+            arr.removeLast();
+        for (int i = 0; i < arr.size(); i++)
+            arr.replace(i, value);
+        while (arr.size() < size)
+            arr.append(value);
+    });
+}
+
+
+void QJsonPath::insert(QJsonValue& root, const Compiled& path, const QJsonValue& value)
+{
+    _array_insert(root, path, value);
+}
+void QJsonPath::insert(QJsonObject& root, const Compiled& path, const QJsonValue& value)
+{
+    _array_insert(root, path, value);
+}
+void QJsonPath::insert(QJsonArray& root, const Compiled& path, const QJsonValue& value)
+{
+    _array_insert(root, path, value);
+}
+void QJsonPath::insert(QJsonDocument& root, const Compiled& path, const QJsonValue& value)
+{
+    _array_insert(root, path, value);
+}
+
+QJsonArray QJsonPath::splice(QJsonValue& root, const Compiled& arrayPath, int pos, int removeCount, const QJsonArray& values)
+{
+    return _array_splice(root, arrayPath, pos, removeCount, values);
+}
+QJsonArray QJsonPath::splice(QJsonObject& root, const Compiled& arrayPath, int pos, int removeCount, const QJsonArray& values)
+{
+    return _array_splice(root, arrayPath, pos, removeCount, values);
+}
+QJsonArray QJsonPath::splice(QJsonArray& root, const Compiled& arrayPath, int pos, int removeCount, const QJsonArray& values)
+{
+    return _array_splice(root, arrayPath, pos, removeCount, values);
+}
+QJsonArray QJsonPath::splice(QJsonDocument& root, const Compiled& arrayPath, int pos, int removeCount, const QJsonArray& values)
+{
+    return _array_splice(root, arrayPath, pos, removeCount, values);
+}
+
+void QJsonPath::appendRange(QJsonValue& root, const Compiled& arrayPath, const QJsonArray& values)
+{
+    _array_appendRange(root, arrayPath, values);
+}
+void QJsonPath::appendRange(QJsonObject& root, const Compiled& arrayPath, const QJsonArray& values)
+{
+    _array_appendRange(root, arrayPath, values);
+}
+void QJsonPath::appendRange(QJsonArray& root, const Compiled& arrayPath, const QJsonArray& values)
+{
+    _array_appendRange(root, arrayPath, values);
+}
+void QJsonPath::appendRange(QJsonDocument& root, const Compiled& arrayPath, const QJsonArray& values)
+{
+    _array_appendRange(root, arrayPath, values);
+}
+
+void QJsonPath::resize(QJsonValue& root, const Compiled& arrayPath, int size, const QJsonValue& fill)
+{
+    _array_resize(root, arrayPath, size, fill);
+}
+void QJsonPath::resize(QJsonObject& root, const Compiled& arrayPath, int size, const QJsonValue& fill)
+{
+    _array_resize(root, arrayPath, size, fill);
+}
+void QJsonPath::resize(QJsonArray& root, const Compiled& arrayPath, int size, const QJsonValue& fill)
+{
+    _array_resize(root, arrayPath, size, fill);
+}
+void QJsonPath::resize(QJsonDocument& root, const Compiled& arrayPath, int size, const QJsonValue& fill)
+{
+    _array_resize(root, arrayPath, size, fill);
+}
+
+void QJsonPath::fill(QJsonValue& root, const Compiled& arrayPath, const QJsonValue& value, int size)
+{
+    _array_fill(root, arrayPath, value, size);
+}
+void QJsonPath::fill(QJsonObject& root, const Compiled& arrayPath, const QJsonValue& value, int size)
+{
+    _array_fill(root, arrayPath, value, size);
+}
+void QJsonPath::fill(QJsonArray& root, const Compiled& arrayPath, const QJsonValue& value, int size)
+{
+    _array_fill(root, arrayPath, value, size);
+}
+void QJsonPath::fill(QJsonDocument& root, const Compiled& arrayPath, const QJsonValue& value, int size)
+{
+    _array_fill(root, arrayPath, value, size);
+}
+
+
+void _handleJsonAttribute_unittest_bulk()
+{
+    // "[+]" appends with set, creating the array, and finds nothing with get and remove
+    QJsonObject obj;
+    QJsonPath::set(obj, "a[+]", 1);
+    QJsonPath::set(obj, "a[+]/name", "x");
+    QJsonPath::set(obj, QJsonPath::Compiled("a[+][+]"), 2);
+    Q_ASSERT(obj["a"] == QJsonArray({ 1, QJsonObject{ { "name", "x" } }, QJsonArray{ 2 } }));
+    Q_ASSERT(QJsonPath::get(obj, "a[+]").isUndefined() && QJsonPath::get(obj, "a[+]", 5) == 5);
+    QJsonPath::remove(obj, "a[+]");
+    Q_ASSERT(QJsonPath::get(obj, "a").toArray().size() == 3);
+    Q_ASSERT(QJsonPath::splitPath("a[+]") == QVariantList({ "a", QVariant() }));
+    Q_ASSERT(QJsonPath::Compiled("a[+]").toVariantList() == QVariantList({ "a", QVariant() }));
+    // a list path reads it back, an unsupported list token stays invalid
+    Q_ASSERT(QJsonPath::Compiled(QJsonPath::splitPath("a[+]")) == QJsonPath::Compiled("a[+]"));
+    Q_ASSERT(QJsonPath::Compiled(QJsonPath::Compiled(QVariantList{ 1.5 }).toVariantList()).type(0) == QJsonPath::Compiled::Invalid);
+    QJsonPath::set(obj, QJsonPath::splitPath("a[+]"), 3);
+    Q_ASSERT(obj["a"].toArray().size() == 4 && QJsonPath::get(obj, "a[-1]") == 3);
+    QJsonPath::remove(obj, "a[-1]");
+    constexpr QJsonPath::Literal literal("a[+]");
+    static_assert(literal.size() == 2 && literal.type(1) == QJsonPath::Compiled::Append, "\"[+]\" is an append token");
+    Q_ASSERT(QJsonPath::Compiled(literal) == QJsonPath::Compiled("a[+]"));
+    QJsonArray arr;
+    QJsonPath::set(arr, "[+]", "first");
+    QJsonPath::set(arr, "[+]", "second");
+    Q_ASSERT(arr == QJsonArray({ "first", "second" }));
+    QJsonValue taken(QJsonArray{ 1 });
+    Q_ASSERT(QJsonPath::take(taken, "[+]").isUndefined() && taken == QJsonArray({ 1 }));
+
+    // CBOR, Builder and Journal append the same way
+    QCborMap map;
+    QJsonPath::set(map, "a[+]", 1);
+    QJsonPath::set(map, "a[+]", 2);
+    Q_ASSERT(QJsonPath::get(map, "a[1]") == 2 && QJsonPath::get(map, "a[+]").isUndefined());
+    QJsonPath::Builder builder;
+    builder.set("a[+]", 1);
+    builder.set("a[+]/b", 2);
+    builder.insert("a[+]", 3);
+    Q_ASSERT(builder.toJsonValue() == QJsonObject({ { "a", QJsonArray{ 1, QJsonObject{ { "b", 2 } }, 3 } } }));
+    QJsonPath::Journal journal;
+    QJsonObject replica = obj;
+    journal.set(obj, "a[+]", "j");
+    Q_ASSERT(QJsonPath::Journal::apply(replica, journal.patch()) && replica == obj && QJsonPath::get(obj, "a[3]") == "j");
+
+    // insert
+    QJsonDocument doc(QJsonObject{ { "list", QJsonArray{ 1, 2, 3 } } });
+    QJsonPath::insert(doc, "list[1]", "x");
+    QJsonPath::insert(doc, "list[-1]", "y");
+    QJsonPath::insert(doc, "list[+]", "z");
+    QJsonPath::insert(doc, "list[-9]", "none");
+    QJsonPath::insert(doc, "list[8]", "pad");
+    Q_ASSERT(QJsonPath::get(doc, "list") == QJsonArray({ 1, "x", 2, "y", 3, "z", QJsonValue(), QJsonValue(), "pad" }));
+    QJsonPath::insert(doc, "new/list[0]", 1);
+    QJsonPath::insert(doc, "list[0][0]", 1); // the element is replaced by an array, same as set
+    Q_ASSERT(QJsonPath::get(doc, "new/list") == QJsonArray({ 1 }) && QJsonPath::get(doc, "list[0]") == QJsonArray({ 1 }));
+
+    // splice, with the counts of Array.splice in JavaScript
+    QJsonValue value(QJsonObject{ { "a", QJsonArray{ 0, 1, 2, 3, 4, 5 } } });
+    Q_ASSERT(QJsonPath::splice(value, "a", 1, 2, QJsonArray{ "x", "y" }) == QJsonArray({ 1, 2 }));
+    Q_ASSERT(QJsonPath::get(value, "a") == QJsonArray({ 0, "x", "y", 3, 4, 5 }));
+    Q_ASSERT(QJsonPath::splice(value, "a", 1, 2, QJsonArray{ "z" }) == QJsonArray({ "x", "y" }));
+    Q_ASSERT(QJsonPath::splice(value, "a", -2, 1) == QJsonArray({ 4 }));
+    Q_ASSERT(QJsonPath::splice(value, "a", 1, 0, QJsonArray{ "p", "q", "r" }).isEmpty());
+    Q_ASSERT(QJsonPath::get(value, "a") == QJsonArray({ 0, "p", "q", "r", "z", 3, 5 }));
+    Q_ASSERT(QJsonPath::splice(value, "a", 5, 100, QJsonArray{ 6, 7, 8 }) == QJsonArray({ 3, 5 }));
+    Q_ASSERT(QJsonPath::splice(value, "a", 100, 1, QJsonArray{ 9 }).isEmpty() && QJsonPath::splice(value, "a", -100, 1) == QJsonArray({ 0 }));
+    Q_ASSERT(QJsonPath::splice(value, "a", 2, -1).isEmpty() && QJsonPath::splice(value, "a", 3, 1).size() == 1);
+    Q_ASSERT(QJsonPath::get(value, "a") == QJsonArray({ "p", "q", "r", 6, 7, 8, 9 }));
+    Q_ASSERT(QJsonPath::splice(value, "b", 0, 1, QJsonArray{ 1 }).isEmpty() && QJsonPath::get(value, "b") == QJsonArray({ 1 }));
+
+    // appendRange, resize and fill, also on a root array and on a value that is no array
+    QJsonArray root{ 1 };
+    QJsonPath::appendRange(root, QJsonPath::Compiled(), QJsonArray{ 2, 3 });
+    QJsonPath::resize(root, QJsonPath::Compiled(), 5, 0);
+    Q_ASSERT(root == QJsonArray({ 1, 2, 3, 0, 0 }));
+    QJsonPath::resize(root, QJsonPath::Compiled(), 2);
+    QJsonPath::fill(root, "[2]", true, 2);
+    Q_ASSERT(root == QJsonArray({ 1, 2, QJsonArray{ true, true } }));
+    QJsonPath::fill(root, QJsonPath::Compiled(), "f");
+    Q_ASSERT(root == QJsonArray({ "f", "f", "f" }));
+    QJsonPath::resize(root, QJsonPath::Compiled(), -1);
+    Q_ASSERT(root.isEmpty());
+    QJsonValue scalar(5);
+    QJsonPath::appendRange(scalar, QJsonPath::Compiled(), QJsonArray{ 1 });
+    QJsonDocument empty;
+    QJsonPath::resize(empty, QJsonPath::Compiled(), 2);
+    Q_ASSERT(scalar == QJsonArray({ 1 }) && empty.array() == QJsonArray({ QJsonValue(), QJsonValue() }));
+    QJsonObject nested{ { "x", 1 } };
+    QJsonPath::appendRange(nested, "x/y", QJsonArray{ 1, 2 });
+    QJsonPath::resize(nested, "z", 1, "z");
+    Q_ASSERT(nested == QJsonObject({ { "x", QJsonObject{ { "y", QJsonArray{ 1, 2 } } } }, { "z", QJsonArray{ "z" } } }));
+
+    // the array is changed inplace, a copy of the root keeps the old one
+    QJsonObject users{ { "users", QJsonArray{ QJsonObject{ { "id", 1 } } } } };
+    const auto copy = users;
+    QJsonPath::splice(users, "users", 0, 0, QJsonArray{ QJsonObject{ { "id", 2 } } });
+    QJsonPath::set(users, "users[+]/id", 3);
+    Q_ASSERT(users["users"].toArray().size() == 3 && QJsonPath::get(users, "users[1]/id") == 1);
+    Q_ASSERT(copy["users"].toArray().size() == 1);
+}
@@ -0,0 +1,574 @@
+// MIT License Copyright (C) 2023 heksbeks https://github.com/heksbeks/qjsonpath
+
+#include "qjsonpath.h"
+#include "qjsonpath_p.h"
+#include <QJsonArray>
+#include <QHash>
+
+
+// Operations are split up by their path token at the current depth. Operations on different keys of an object are
+// independent of each other, so every child is visited once with all of its operations in their original order.
+// Only array elements are visited one operation at a time if an index depends on the array size at that moment, e.g. "[+]".
+struct QJsonPath::Batch::Runner
+{
+    const QVector<Operation>& ops;
+    QVector<QJsonValue>& results;
+
+    // results start with the default values, found values replace them
+    static QVector<QJsonValue> defaultResults(const QVector<Operation>& ops, int size)
+    {
+        QVector<QJsonValue> results(size);
+        for (const auto& op : ops) {
+            if (op.type == Get)
+                results[op.result] = op.value;
+        }
+        return results;
+    }
+
+    void result(const Operation& op, const QJsonValue& value)
+    {
+        if (!value.isUndefined())
+            results[op.result] = value;
+    }
+
+    bool hasWrites(const QVector<int>& list) const
+    {
+        for (int i : list) {
+            if (ops[i].type != Get)
+                return true;
+        }
+        return false;
+    }
+
+    static void invalidToken(int pos)
+    {
+        Q_UNUSED(pos)
+        Q_ASSERT_X(false, __FUNCTION__, QString("invalid path type at position %1").arg(pos).toUtf8());
+    }
+
+    // "[+]" expects an array like an index
+    static Compiled::TokenType containerType(Compiled::TokenType type)
+    {
+        return type == Compiled::Append ? Compiled::Index : type;
+    }
+
+    // splits operations with a key at pos into groups of the same key
+    QVector<QVector<int>> groupByKey(const QVector<int>& list, int pos) const
+    {
+        QVector<QVector<int>> groups;
+        QHash<QString, int> keys;
+        for (int i : list) {
+            const auto it = keys.constFind(ops[i].path.key(pos));
+            if (it != keys.constEnd())
+                groups[it.value()].append(i);
+            else {
+                keys.insert(ops[i].path.key(pos), int(groups.size()));
+                groups.append(QVector<int>{i});
+            }
+        }
+        return groups;
+    }
+
+    // splits operations with an index at pos into groups of the same element, negative indexes are resolved with size
+    QVector<QVector<int>> groupByIndex(const QVector<int>& list, int pos, int size) const
+    {
+        QVector<QVector<int>> groups;
+        QHash<int, int> indexes;
+        for (int i : list) {
+            int idx = ops[i].path.index(pos);
+            if (idx < 0)
+                idx = size + idx; // -1 is last element
+            const auto it = indexes.constFind(idx);
+            if (it != indexes.constEnd())
+                groups[it.value()].append(i);
+            else {
+                indexes.insert(idx, int(groups.size()));
+                groups.append(QVector<int>{i});
+            }
+        }
+        return groups;
+    }
+
+    // read only evaluation of the get operations, set and remove operations are skipped
+    void lookup(const QJsonValue& value, const QVector<int>& list, int pos)
+    {
+        QVector<int> keyOps, indexOps;
+        for (int i : list) {
+            const auto& op = ops[i];
+            if (op.type != Get)
+                continue;
+            if (op.path.size() == pos)
+                result(op, value);
+            else if (op.path.type(pos) == Compiled::Key)
+                keyOps.append(i);
+            else if (op.path.type(pos) == Compiled::Index)
+                indexOps.append(i);
+            else if (op.path.type(pos) == Compiled::Append)
+                continue; // the element after the last one is never found
+            else {
+                invalidToken(pos);
+                result(op, value);
+            }
+        }
+
+        if (!keyOps.isEmpty() && value.isObject()) {
+            const auto obj = value.toObject();
+            for (const auto& group : groupByKey(keyOps, pos)) {
+                const auto it = obj.constFind(ops[group.first()].path.key(pos));
+                if (it != obj.constEnd())
+                    lookup(it.value(), group, pos + 1);
+            }
+        }
+        if (!indexOps.isEmpty() && value.isArray()) {
+            const auto arr = value.toArray();
+            for (const auto& group : groupByIndex(indexOps, pos, int(arr.size()))) {
+                int idx = ops[group.first()].path.index(pos);
+                if (idx < 0)
+                    idx = int(arr.size()) + idx; // -1 is last element
+                if (idx >= 0 && idx < arr.size())
+                    lookup(arr.at(idx), group, pos + 1);
+            }
+        }
+    }
+
+    // operations with a path of length pos act on the slot itself, longer paths on its children
+    void slot(QJsonValue& value, bool& removed, const QVector<int>& list, int pos)
+    {
+        if (!hasWrites(list)) {
+            lookup(value, list, pos);
+            return;
+        }
+
+        int i = 0;
+        while (i < list.size()) {
+            const auto& op = ops[list[i]];
+            if (op.path.size() == pos) {
+                if (op.type == Get)
+                    result(op, value);
+                else if (pos == 0) {
+                    // an empty path does not change the root, same as the single functions
+                }
+                else if (op.type == Set) {
+                    value = op.value;
+                    removed = false;
+                }
+                else if (op.type == Remove) {
+                    value = QJsonValue(QJsonValue::Undefined);
+                    removed = true;
+                }
+                i++;
+                continue;
+            }
+
+            int j = i + 1;
+            while (j < list.size() && ops[list[j]].path.size() > pos)
+                j++;
+            container(value, list.mid(i, j - i), pos);
+            if (!value.isUndefined())
+                removed = false;
+            i = j;
+        }
+    }
+
+    // all operations have a path longer than pos
+    void container(QJsonValue& value, const QVector<int>& list, int pos)
+    {
+        int i = 0;
+        while (i < list.size()) {
+            // a run of operations expecting the same container type, a set with another type in between replaces the container
+            const auto type = containerType(ops[list[i]].path.type(pos));
+            int j = i + 1;
+            while (j < list.size() && containerType(ops[list[j]].path.type(pos)) == type)
+                j++;
+
+            if (type != Compiled::Key && type != Compiled::Index) {
+                for (; i < j; i++) {
+                    invalidToken(pos);
+                    if (ops[list[i]].type == Get)
+                        result(ops[list[i]], value);
+                }
+                continue;
+            }
+
+            // operations before the first set find no container and change nothing
+            const bool matching = type == Compiled::Key ? value.isObject() : value.isArray();
+            if (!matching) {
+                while (i < j && ops[list[i]].type != Set)
+                    i++;
+                if (i == j)
+                    continue;
+            }
+
+            const auto run = list.mid(i, j - i);
+            if (type == Compiled::Key) {
+                auto obj = matching ? value.toObject() : QJsonObject();
+                value = QJsonValue(); // obj holds the only reference now
+                object(obj, run, pos);
+                value = std::move(obj);
+            }
+            else {
+                auto arr = matching ? value.toArray() : QJsonArray();
+                value = QJsonValue(); // arr holds the only reference now
+                array(arr, run, pos);
+                value = std::move(arr);
+            }
+            i = j;
+        }
+    }
+
+    // all operations have a key at pos
+    void object(QJsonObject& obj, const QVector<int>& list, int pos)
+    {
+        for (const auto& group : groupByKey(list, pos)) {
+            const auto& keyName = ops[group.first()].path.key(pos);
+            if (!hasWrites(group)) {
+                const auto it = obj.constFind(keyName);
+                if (it != obj.constEnd())
+                    lookup(it.value(), group, pos + 1);
+                continue;
+            }
+
+            auto it = obj.find(keyName);
+            const bool existed = it != obj.end();
+            QJsonValue subValue(QJsonValue::Undefined);
+            if (existed) {
+                subValue = *it;
+                *it = QJsonValue(); // take the child out, subValue holds the only reference now
+            }
+            bool removed = false;
+            slot(subValue, removed, group, pos + 1);
+
+            if (subValue.isUndefined()) {
+                if (existed)
+                    obj.erase(it);
+            }
+            else if (existed)
+                *it = subValue;
+            else
+                obj.insert(keyName, subValue);
+        }
+    }
+
+    // all operations have an index or "[+]" at pos
+    void array(QJsonArray& arr, const QVector<int>& list, int pos)
+    {
+        // elements can be grouped as long as no operation pads, appends to or shrinks the array
+        bool grouped = true;
+        for (int i : list) {
+            const auto& op = ops[i];
+            const int idx = op.path.index(pos);
+            if (op.path.type(pos) == Compiled::Append || idx < 0 || idx >= arr.size() || (op.type == Remove && op.path.size() == pos + 1)) {
+                grouped = false;
+                break;
+            }
+        }
+
+        if (grouped) {
+            for (const auto& group : groupByIndex(list, pos, int(arr.size())))
+                element(arr, group, pos);
+        }
+        else {
+            for (int i : list)
+                element(arr, QVector<int>{i}, pos);
+        }
+    }
+
+    // all operations address the same array element, "[+]" is the element after the last one, which only a set creates
+    void element(QJsonArray& arr, const QVector<int>& group, int pos)
+    {
+        const auto& path = ops[group.first()].path;
+        int idx = path.type(pos) == Compiled::Append ? int(arr.size()) : path.index(pos);
+        if (idx < 0)
+            idx = arr.size() ? int(arr.size()) + idx : 0; // -1 is last element
+        if (idx < 0 || (idx >= arr.size() && ops[group.first()].type != Set) || !hasWrites(group)) {
+            lookup(idx >= 0 && idx < arr.size() ? arr.at(idx) : QJsonValue(QJsonValue::Undefined), group, pos + 1);
+            return;
+        }
+        while (idx >= arr.size())
+            arr.append(QJsonValue());
+
+        QJsonValue subValue = arr.at(idx);
+        arr.replace(idx, QJsonValue()); // take the child out, subValue holds the only reference now
+        bool removed = false;
+        slot(subValue, removed, group, pos + 1);
+
+        if (removed)
+            arr.removeAt(idx);
+        else
+            arr.replace(idx, subValue);
+    }
+
+    void apply(QJsonValue& root)
+    {
+        QVector<int> list(ops.size());
+        for (int i = 0; i < list.size(); i++)
+            list[i] = i;
+        bool removed = false;
+        slot(root, removed, list, 0);
+    }
+
+    void query(const QJsonValue& root)
+    {
+        QVector<int> list(ops.size());
+        for (int i = 0; i < list.size(); i++)
+            list[i] = i;
+        lookup(root, list, 0);
+    }
+};
+
+
+int QJsonPath::Batch::get(const Compiled& path, const QJsonValue& defaultValue)
+{
+    m_operations.append(Operation{path, defaultValue, Get, m_results});
+    return m_results++;
+}
+
+void QJsonPath::Batch::set(const Compiled& path, const QJsonValue& newValue)
+{
+    m_operations.append(Operation{path, newValue, Set, -1});
+}
+
+void QJsonPath::Batch::remove(const Compiled& path)
+{
+    m_operations.append(Operation{path, QJsonValue(), Remove, -1});
+}
+
+void QJsonPath::Batch::clear()
+{
+    m_operations.clear();
+    m_results = 0;
+}
+
+QVector<QJsonValue> QJsonPath::Batch::apply(QJsonValue& root) const
+{
+    auto results = Runner::defaultResults(m_operations, m_results);
+    Runner{m_operations, results}.apply(root);
+    return results;
+}
+
+QVector<QJsonValue> QJsonPath::Batch::apply(QJsonObject& root) const
+{
+    QJsonValue val = root;
+    root = QJsonObject(); // val holds the only reference now
+    const auto results = apply(val);
+    if (!val.isArray()) // an array cannot be converted to a QJsonObject
+        root = val.toObject();
+    else
+        Q_ASSERT_X(!val.isArray(), __FUNCTION__, QString("invalid result type '%1', path must result to an root object").arg(val.type()).toUtf8());
+    return results;
+}
+
+QVector<QJsonValue> QJsonPath::Batch::apply(QJsonArray& root) const
+{
+    QJsonValue val = root;
+    root = QJsonArray(); // val holds the only reference now
+    const auto results = apply(val);
+    if (val.isArray()) // an object cannot be converted to a QJsonArray
+        root = val.toArray();
+    else
+        Q_ASSERT_X(val.isArray(), __FUNCTION__, QString("invalid result type '%1', path must result to a root array").arg(val.type()).toUtf8());
+    return results;
+}
+
+QVector<QJsonValue> QJsonPath::Batch::apply(QJsonDocument& root) const
+{
+    QJsonValue val;
+    if (root.isArray())
+        val = root.array();
+    else
+        val = root.object();
+    root = QJsonDocument(); // val holds the only reference now
+
+    const auto results = apply(val);
+
+    if (val.isArray())
+        root = QJsonDocument(val.toArray());
+    else
+        root = QJsonDocument(val.toObject());
+    return results;
+}
+
+QVector<QJsonValue> QJsonPath::Batch::query(const QJsonValue& root) const
+{
+    auto results = Runner::defaultResults(m_operations, m_results);
+    Runner{m_operations, results}.query(root);
+    return results;
+}
+
+QVector<QJsonValue> QJsonPath::Batch::query(const QJsonObject& root) const
+{
+    return query(QJsonValue(root));
+}
+
+QVector<QJsonValue> QJsonPath::Batch::query(const QJsonArray& root) const
+{
+    return query(QJsonValue(root));
+}
+
+QVector<QJsonValue> QJsonPath::Batch::query(const QJsonDocument& root) const
+{
+    // object() and array() share the document data, they do not copy it
+    return root.isArray() ? query(QJsonValue(root.array())) : query(QJsonValue(root.object()));
+}
+
+
+struct _BatchTestOp
+{
+    char type; // 'g'et, 's'et or 'r'emove
+    QJsonPath::Compiled path;
+    QJsonValue value;
+};
+
+// applies the operations as a batch and one by one with the single functions, both must give the same results
+template <class T> static void _handleJsonAttribute_unittest_batch(const T& root, const QVector<_BatchTestOp>& ops)
+{
+    QJsonPath::Batch batch;
+    T expected = root;
+    QVector<QJsonValue> expectedResults;
+    for (const auto& op : ops) {
+        if (op.type == 'g') {
+            Q_ASSERT(batch.get(op.path, op.value) == expectedResults.size());
+            expectedResults.append(QJsonPath::get(expected, op.path, op.value));
+        }
+        else if (op.type == 's') {
+            batch.set(op.path, op.value);
+            QJsonPath::set(expected, op.path, op.value);
+        }
+        else {
+            batch.remove(op.path);
+            QJsonPath::remove(expected, op.path);
+        }
+    }
+    Q_ASSERT(batch.size() == ops.size());
+
+    T actual = root;
+    const auto results = batch.apply(actual);
+    Q_ASSERT(actual == expected);
+    Q_ASSERT(results == expectedResults);
+
+    // query evaluates the gets only, on the unchanged root
+    QVector<QJsonValue> queryResults;
+    for (const auto& op : ops) {
+        if (op.type == 'g')
+            queryResults.append(QJsonPath::get(root, op.path, op.value));
+    }
+    Q_ASSERT(batch.query(root) == queryResults);
+}
+
+template <class T> static void _handleJsonAttribute_unittest_batch_object(const T& root)
+{
+    using C = QJsonPath::Compiled;
+
+    // shared prefix
+    _handleJsonAttribute_unittest_batch(root, {
+        {'s', C("svc/limits/cpu"), 2},
+        {'s', C("svc/limits/mem"), 512},
+        {'s', C("svc/limits/cpu"), 3},
+        {'g', C("svc/limits/cpu"), {}},
+        {'g', C("svc/limits/disk"), 7},
+        {'s', C("svc/name"), "n"},
+        {'g', C("svc"), {}},
+        {'g', C(QVariantList()), {}},
+    });
+
+    // order of operations on the same attribute
+    _handleJsonAttribute_unittest_batch(root, {
+        {'g', C("svc/limits/cpu"), {}},
+        {'r', C("svc/limits/cpu"), {}},
+        {'g', C("svc/limits/cpu"), -1},
+        {'s', C("svc/limits/cpu/max"), 4},
+        {'s', C("x"), 6},
+        {'r', C("x"), {}},
+        {'r', C("missing/path"), {}},
+        {'g', C("missing/path"), {}},
+        {'s', C(QVariantList()), 1},
+    });
+
+    // arrays, padding, negative indexes and removed elements
+    _handleJsonAttribute_unittest_batch(root, {
+        {'s', C("svc/list[1]/a"), 2},
+        {'g', C("svc/list[-1]"), {}},
+        {'g', C("svc/list[4]"), 0},
+        {'s', C("svc/list[6]"), 1},
+        {'g', C("svc/list[4]"), 0},
+        {'r', C("svc/list[0]"), {}},
+        {'g', C("svc/list[0]/a"), {}},
+        {'s', C("svc/list[-9]"), 1},
+        {'s', C("svc/list[-1][2]"), "x"},
+        {'r', C("svc/list[99]"), {}},
+    });
+
+    // padding of an array changes what later operations find
+    _handleJsonAttribute_unittest_batch(root, {
+        {'g', C("svc/list[4]"), 0},
+        {'s', C("svc/list[6]"), 1},
+        {'g', C("svc/list[4]"), 0},
+        {'s', C("svc/list[0]"), 2},
+    });
+
+    // type changes of a container in between
+    _handleJsonAttribute_unittest_batch(root, {
+        {'g', C("svc/limits/cpu"), {}},
+        {'r', C("svc/limits[0]"), {}},
+        {'s', C("svc/limits[0]"), 1},
+        {'g', C("svc/limits/cpu"), 0},
+        {'s', C("svc/limits/cpu"), 3},
+        {'g', C("svc/limits[0]"), {}},
+        {'s', C("x/y"), 1},
+    });
+
+    // "[+]" appends one element per set, get and remove find nothing
+    _handleJsonAttribute_unittest_batch(root, {
+        {'s', C("svc/list[+]"), 4},
+        {'s', C("svc/list[+]/a"), 5},
+        {'g', C("svc/list[-1]/a"), {}},
+        {'g', C("svc/list[+]"), 0},
+        {'r', C("svc/list[+]"), {}},
+        {'s', C("svc/list[1]/b"), 6},
+        {'s', C("svc/new[+][+]"), 7},
+        {'r', C("svc/limits[+]"), {}},
+        {'s', C("svc/limits[+]"), 8},
+    });
+}
+
+template <class T> static void _handleJsonAttribute_unittest_batch_array(const T& root)
+{
+    using C = QJsonPath::Compiled;
+    _handleJsonAttribute_unittest_batch(root, {
+        {'s', C("[0]/a"), 2},
+        {'s', C("[0]/b"), 3},
+        {'s', C("[3]"), "x"},
+        {'r', C("[1]"), {}},
+        {'g', C("[-1]"), {}},
+        {'g', C("[1]"), {}},
+        {'g', C("[0]"), {}},
+        {'s', C("[+]"), "y"},
+        {'r', C("[+]"), {}},
+        {'g', C("[-1]"), {}},
+    });
+}
+
+void _handleJsonAttribute_unittest_batch()
+{
+    const QJsonObject obj{
+        {"svc", QJsonObject{
+             {"limits", QJsonObject{{"cpu", 1}, {"mem", 2}}},
+             {"list", QJsonArray{1, QJsonObject{{"a", 1}}, 3}},
+         }},
+        {"x", 5},
+    };
+    _handleJsonAttribute_unittest_batch_object(QJsonValue(obj));
+    _handleJsonAttribute_unittest_batch_object(obj);
+    _handleJsonAttribute_unittest_batch_object(QJsonDocument(obj));
+
+    const QJsonArray arr{QJsonObject{{"a", 1}}, 2};
+    _handleJsonAttribute_unittest_batch_array(QJsonValue(arr));
+    _handleJsonAttribute_unittest_batch_array(arr);
+    _handleJsonAttribute_unittest_batch_array(QJsonDocument(arr));
+
+    QJsonPath::Batch batch;
+    batch.set("a/b", 1);
+    Q_ASSERT(batch.get("a/b") == 0);
+    batch.clear();
+    Q_ASSERT(batch.isEmpty() && batch.get({"a", "b"}) == 0);
+}
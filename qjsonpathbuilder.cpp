@@ -0,0 +1,558 @@
+// MIT License Copyright (C) 2023 heksbeks https://github.com/heksbeks/qjsonpath
+
+#include "qjsonpath.h"
+#include "qjsonpath_p.h"
+#include <QJsonArray>
+#include <QLocale>
+#include <algorithm>
+#include <cstring>
+
+
+// child lists smaller than a block share it, a larger list gets a block of its own
+static const qint32 _builder_blockSize = 16384;
+
+QJsonPath::Builder::Builder()
+{
+    clear();
+}
+
+QJsonPath::Builder::~Builder()
+{
+    for (auto block : m_blocks)
+        delete[] block;
+}
+
+bool QJsonPath::Builder::isEmpty() const
+{
+    return m_nodes[0].type == QJsonValue::Undefined;
+}
+
+void QJsonPath::Builder::clear()
+{
+    for (auto block : m_blocks)
+        delete[] block;
+    m_blocks.clear();
+    m_free = nullptr;
+    m_freeSize = 0;
+    m_nodes.clear();
+    m_values.clear();
+    m_keyIds.clear();
+    m_keys.clear();
+    m_members.clear();
+    m_memberCount = 0;
+    m_objects = 0;
+    addNode(-1);
+    m_nodes[0].type = QJsonValue::Undefined;
+}
+
+qint32* QJsonPath::Builder::allocate(qint32 count)
+{
+    if (count > m_freeSize) {
+        const qint32 size = qMax(count, _builder_blockSize);
+        m_blocks.append(new qint32[size]);
+        m_free = m_blocks.last();
+        m_freeSize = size;
+    }
+    qint32* p = m_free;
+    m_free += count;
+    m_freeSize -= count;
+    return p;
+}
+
+// new nodes are null like the values QJsonPath::set inserts for missing keys and array padding
+qint32 QJsonPath::Builder::addNode(qint32 key)
+{
+    m_nodes.append(Node{ QJsonValue::Null, key, -1, -1, 0, 0, nullptr });
+    return qint32(m_nodes.size()) - 1;
+}
+
+void QJsonPath::Builder::insertChild(qint32 parent, qint32 pos, qint32 node)
+{
+    Node& p = m_nodes[parent];
+    if (p.size == p.capacity) {
+        const qint32 capacity = qMax(4, p.capacity * 2);
+        if (p.children && p.children + p.capacity == m_free && capacity - p.capacity <= m_freeSize) {
+            // the list is the last allocation, it grows in place
+            m_free += capacity - p.capacity;
+            m_freeSize -= capacity - p.capacity;
+        }
+        else {
+            qint32* children = allocate(capacity);
+            if (p.size)
+                std::memcpy(children, p.children, sizeof(qint32) * size_t(p.size));
+            p.children = children;
+        }
+        p.capacity = capacity;
+    }
+    if (pos < p.size)
+        std::memmove(p.children + pos + 1, p.children + pos, sizeof(qint32) * size_t(p.size - pos));
+    p.children[pos] = node;
+    p.size++;
+}
+
+static inline quint32 _builder_hash(qint32 object, qint32 key)
+{
+    quint32 h = quint32(object) * 0x9E3779B1u ^ quint32(key) * 0x85EBCA77u;
+    return h ^ (h >> 15);
+}
+
+void QJsonPath::Builder::addMember(qint32 object, qint32 key, qint32 node)
+{
+    if ((m_memberCount + 1) * 2 > m_members.size()) {
+        const QVector<Member> members = m_members;
+        m_members.fill(Member{ -1, -1, -1 }, qMax(64, int(members.size()) * 2));
+        m_memberCount = 0;
+        for (const auto& m : members) {
+            if (m.object >= 0)
+                addMember(m.object, m.key, m.node);
+        }
+    }
+    const quint32 mask = quint32(m_members.size()) - 1;
+    quint32 pos = _builder_hash(object, key) & mask;
+    while (m_members[pos].object >= 0)
+        pos = (pos + 1) & mask;
+    m_members[pos] = Member{ object, key, node };
+    m_memberCount++;
+}
+
+qint32 QJsonPath::Builder::member(qint32 object, const QString& key)
+{
+    const qint32 id = m_nodes[object].object;
+    qint32 keyId = m_keyIds.value(key, -1);
+    if (keyId < 0) {
+        keyId = qint32(m_keys.size());
+        m_keys.append(key);
+        m_keyIds.insert(key, keyId);
+    }
+    else {
+        const quint32 mask = quint32(m_members.size()) - 1;
+        for (quint32 pos = _builder_hash(id, keyId) & mask; m_members[pos].object >= 0; pos = (pos + 1) & mask) {
+            const auto& m = m_members[pos];
+            if (m.object == id && m.key == keyId)
+                return m.node;
+        }
+    }
+    const qint32 n = addNode(keyId);
+    insertChild(object, m_nodes[object].size, n);
+    addMember(id, keyId, n);
+    return n;
+}
+
+// makes node n an object or an array, a value of that type is split up into nodes, any other value is replaced by an empty container
+void QJsonPath::Builder::container(qint32 n, QJsonValue::Type type)
+{
+    Node& node = m_nodes[n];
+    if (node.type == type && node.value < 0)
+        return;
+    QJsonValue value;
+    if (node.value >= 0) {
+        value = m_values[node.value];
+        m_values[node.value] = QJsonValue(); // the slot stays unused, value holds the only reference now
+        node.value = -1;
+    }
+    node.type = type;
+    node.size = 0;
+    node.capacity = 0;
+    node.children = nullptr;
+    if (type == QJsonValue::Object)
+        node.object = m_objects++; // members of an earlier object of this node are not found anymore
+    if (value.type() != type)
+        return;
+
+    if (type == QJsonValue::Object) {
+        const auto obj = value.toObject();
+        for (auto it = obj.constBegin(); it != obj.constEnd(); ++it)
+            assign(member(n, it.key()), it.value());
+    }
+    else {
+        const auto arr = value.toArray();
+        for (const auto& element : arr) {
+            const qint32 c = addNode(-1);
+            insertChild(n, m_nodes[n].size, c);
+            assign(c, element);
+        }
+    }
+}
+
+void QJsonPath::Builder::assign(qint32 n, const QJsonValue& value)
+{
+    Node& node = m_nodes[n];
+    node.type = value.type();
+    node.size = 0;
+    node.capacity = 0;
+    node.children = nullptr;
+    if (node.value >= 0)
+        m_values[node.value] = value;
+    else {
+        node.value = qint32(m_values.size());
+        m_values.append(value);
+    }
+}
+
+// child of parent for the token at pos, created if missing, -1 if a negative index counts down beyond the first element
+qint32 QJsonPath::Builder::child(qint32 parent, const Compiled& path, int pos)
+{
+    const auto type = path.type(pos);
+    if (type == Compiled::Key) {
+        container(parent, QJsonValue::Object);
+        return member(parent, path.key(pos));
+    }
+    if (type == Compiled::Append) {
+        container(parent, QJsonValue::Array);
+        const qint32 c = addNode(-1);
+        insertChild(parent, m_nodes[parent].size, c);
+        return c;
+    }
+    if (type == Compiled::Index) {
+        container(parent, QJsonValue::Array);
+        qint32 idx = path.index(pos);
+        const qint32 size = m_nodes[parent].size;
+        if (idx < 0)
+            idx = size ? size + idx : 0; // -1 is last element
+        if (idx < 0) // counts down beyond the first element
+            return -1;
+        while (idx >= m_nodes[parent].size)
+            insertChild(parent, m_nodes[parent].size, addNode(-1));
+        return m_nodes[parent].children[idx];
+    }
+    Q_ASSERT_X(type == Compiled::Key || type == Compiled::Index || type == Compiled::Append, __FUNCTION__, QString("invalid path type at position %1").arg(pos).toUtf8());
+    return -1;
+}
+
+void QJsonPath::Builder::set(const Compiled& path, const QJsonValue& newValue)
+{
+    if (path.isEmpty())
+        return;
+    qint32 n = 0;
+    for (int pos = 0; pos < path.size() && n >= 0; pos++)
+        n = child(n, path, pos);
+    if (n >= 0)
+        assign(n, newValue);
+}
+
+void QJsonPath::Builder::append(const Compiled& path, const QJsonValue& newValue)
+{
+    qint32 n = 0;
+    for (int pos = 0; pos < path.size() && n >= 0; pos++)
+        n = child(n, path, pos);
+    if (n < 0)
+        return;
+    container(n, QJsonValue::Array);
+    const qint32 c = addNode(-1);
+    insertChild(n, m_nodes[n].size, c);
+    assign(c, newValue);
+}
+
+void QJsonPath::Builder::insert(const Compiled& path, const QJsonValue& newValue)
+{
+    if (path.isEmpty() || (path.type(path.size() - 1) != Compiled::Index && path.type(path.size() - 1) != Compiled::Append)) {
+        Q_ASSERT_X(false, __FUNCTION__, "invalid path, path must end with an array index or \"[+]\"");
+        return;
+    }
+    qint32 n = 0;
+    for (int pos = 0; pos < path.size() - 1 && n >= 0; pos++)
+        n = child(n, path, pos);
+    if (n < 0)
+        return;
+    container(n, QJsonValue::Array);
+    const qint32 size = m_nodes[n].size;
+    qint32 idx = path.type(path.size() - 1) == Compiled::Append ? size : path.index(path.size() - 1);
+    if (idx < 0)
+        idx = size ? size + idx : 0; // -1 is last element
+    if (idx < 0) // counts down beyond the first element
+        return;
+    while (idx > m_nodes[n].size)
+        insertChild(n, m_nodes[n].size, addNode(-1));
+    const qint32 c = addNode(-1);
+    insertChild(n, idx, c);
+    assign(c, newValue);
+}
+
+
+// position of each key in sorted order, members are converted and written in the key order of QJsonObject
+QVector<qint32> QJsonPath::Builder::keyRanks() const
+{
+    QVector<qint32> order(m_keys.size());
+    for (qint32 i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [this](qint32 a, qint32 b) { return m_keys[a] < m_keys[b]; });
+    QVector<qint32> ranks(m_keys.size());
+    for (qint32 i = 0; i < order.size(); i++)
+        ranks[order[i]] = i;
+    return ranks;
+}
+
+// members of object n in key order, undefined members are left out as QJsonObject does
+QVector<qint32> QJsonPath::Builder::members(qint32 n, const QVector<qint32>& ranks) const
+{
+    const Node& node = m_nodes[n];
+    QVector<qint32> members;
+    members.reserve(node.size);
+    for (qint32 i = 0; i < node.size; i++) {
+        if (m_nodes[node.children[i]].type != QJsonValue::Undefined)
+            members.append(node.children[i]);
+    }
+    std::sort(members.begin(), members.end(), [this, &ranks](qint32 a, qint32 b) { return ranks[m_nodes[a].key] < ranks[m_nodes[b].key]; });
+    return members;
+}
+
+QJsonValue QJsonPath::Builder::value(qint32 n, const QVector<qint32>& ranks) const
+{
+    const Node& node = m_nodes[n];
+    if (node.value >= 0)
+        return m_values[node.value];
+    if (node.type == QJsonValue::Object) {
+        QJsonObject obj;
+        for (const qint32 c : members(n, ranks))
+            obj.insert(m_keys[m_nodes[c].key], value(c, ranks)); // appended, the keys are sorted
+        return obj;
+    }
+    if (node.type == QJsonValue::Array) {
+        QJsonArray arr;
+        for (qint32 i = 0; i < node.size; i++)
+            arr.append(value(node.children[i], ranks));
+        return arr;
+    }
+    return QJsonValue(QJsonValue::Type(node.type));
+}
+
+QJsonValue QJsonPath::Builder::toJsonValue() const
+{
+    return value(0, keyRanks());
+}
+
+QJsonDocument QJsonPath::Builder::toDocument() const
+{
+    const auto root = toJsonValue();
+    if (root.isObject())
+        return QJsonDocument(root.toObject());
+    if (root.isArray())
+        return QJsonDocument(root.toArray());
+    return QJsonDocument();
+}
+
+
+void _handleJsonAttribute_writeString(QByteArray& out, const QString& text)
+{
+    static const char hex[] = "0123456789abcdef";
+    const auto utf8 = text.toUtf8();
+    out += '"';
+    for (const char c : utf8) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (uchar(c) < 0x20) {
+                out += "\\u00";
+                out += hex[uchar(c) >> 4];
+                out += hex[uchar(c) & 0xf];
+            }
+            else
+                out += c;
+        }
+    }
+    out += '"';
+}
+
+void _handleJsonAttribute_writeValue(QByteArray& out, const QJsonValue& value)
+{
+    switch (value.type()) {
+    case QJsonValue::Bool:
+        out += value.toBool() ? "true" : "false";
+        break;
+    case QJsonValue::Double: {
+        // integers as integers, others as the shortest text that reads back exactly, the number format of QJsonDocument
+        const double d = value.toDouble();
+        if (!qIsFinite(d))
+            out += "null";
+        else if (qAbs(d) < 1e15 && d == double(qint64(d)))
+            out += QByteArray::number(qint64(d));
+        else
+            out += QByteArray::number(d, 'g', QLocale::FloatingPointShortest);
+        break;
+    }
+    case QJsonValue::String:
+        _handleJsonAttribute_writeString(out, value.toString());
+        break;
+    case QJsonValue::Object: {
+        const auto obj = value.toObject();
+        out += '{';
+        bool first = true;
+        for (auto it = obj.constBegin(); it != obj.constEnd(); ++it) {
+            if (!first)
+                out += ',';
+            first = false;
+            _handleJsonAttribute_writeString(out, it.key());
+            out += ':';
+            _handleJsonAttribute_writeValue(out, it.value());
+        }
+        out += '}';
+        break;
+    }
+    case QJsonValue::Array: {
+        const auto arr = value.toArray();
+        out += '[';
+        for (qsizetype i = 0; i < arr.size(); i++) {
+            if (i)
+                out += ',';
+            _handleJsonAttribute_writeValue(out, arr.at(i));
+        }
+        out += ']';
+        break;
+    }
+    default:
+        out += "null";
+        break;
+    }
+}
+
+void QJsonPath::Builder::write(QByteArray& out, qint32 n, const QVector<qint32>& ranks, const QVector<QByteArray>& keys) const
+{
+    const Node& node = m_nodes[n];
+    if (node.value >= 0)
+        _handleJsonAttribute_writeValue(out, m_values[node.value]);
+    else if (node.type == QJsonValue::Object) {
+        out += '{';
+        bool first = true;
+        for (const qint32 c : members(n, ranks)) {
+            if (!first)
+                out += ',';
+            first = false;
+            out += keys[m_nodes[c].key];
+            write(out, c, ranks, keys);
+        }
+        out += '}';
+    }
+    else if (node.type == QJsonValue::Array) {
+        out += '[';
+        for (qint32 i = 0; i < node.size; i++) {
+            if (i)
+                out += ',';
+            write(out, node.children[i], ranks, keys);
+        }
+        out += ']';
+    }
+    else
+        out += "null";
+}
+
+QByteArray QJsonPath::Builder::toJson() const
+{
+    QByteArray out;
+    if (m_nodes[0].type != QJsonValue::Object && m_nodes[0].type != QJsonValue::Array)
+        return out;
+    // every key is escaped once, with the colon
+    QVector<QByteArray> keys(m_keys.size());
+    for (qint32 i = 0; i < keys.size(); i++) {
+        _handleJsonAttribute_writeString(keys[i], m_keys[i]);
+        keys[i] += ':';
+    }
+    write(out, 0, keyRanks(), keys);
+    return out;
+}
+
+
+void _handleJsonAttribute_unittest_builder()
+{
+    // the same results as set on a QJsonValue, after every step
+    {
+        const QVector<QPair<QString, QJsonValue>> steps{
+            { "a/b", 1 },
+            { "a/c[2]", "x" },
+            { "a/c[-1]", true },
+            { "a/c[-5]", 1 },            // beyond the first element, nothing is set
+            { "a/b/d", 2 },              // a number becomes an object
+            { "a/c", 3 },                // an array becomes a number
+            { "a/c/e", 4 },              // and an object, without the members of earlier objects
+            { "a/c/e", QJsonValue() },
+            { "o", QJsonObject{ { "p", 1 }, { "q", QJsonArray{ 1, 2 } } } },
+            { "o/q[4]", 0.1 },           // the object value is split up and the array padded
+            { "o/r", "s" },
+            { "o", QJsonArray{ "replaced" } },
+            { "o[-1]", -1e300 },
+            { "z[0][1]/y", 123456789012.0 },
+            { "q\"\\\n\x01é/t", "tab\tquote\" € 😀" },
+            { "", 5 },
+        };
+        QJsonPath::Builder builder;
+        QJsonValue json;
+        Q_ASSERT(builder.isEmpty() && builder.toJsonValue().isUndefined() && builder.toJson().isEmpty() && builder.toDocument().isNull());
+        for (const auto& step : steps) {
+            QJsonPath::set(json, step.first, step.second);
+            builder.set(step.first, step.second);
+            Q_ASSERT_X(builder.toJsonValue() == json, __FUNCTION__, step.first.toUtf8());
+            Q_ASSERT_X(QJsonDocument::fromJson(builder.toJson()) == builder.toDocument(), __FUNCTION__, step.first.toUtf8());
+        }
+        Q_ASSERT(builder.toDocument() == QJsonDocument(json.toObject()));
+
+        QJsonPath::Builder arrayBuilder;
+        QJsonValue arrayJson;
+        for (const auto& path : { "[1]/x", "[-1]/y", "[3]", "[0][2]", "[-2]/k" }) {
+            QJsonPath::set(arrayJson, path, path);
+            arrayBuilder.set(path, path);
+        }
+        Q_ASSERT(arrayBuilder.toJsonValue() == arrayJson);
+        Q_ASSERT(arrayBuilder.toDocument() == QJsonDocument(arrayJson.toArray()));
+        Q_ASSERT(QJsonDocument::fromJson(arrayBuilder.toJson()) == arrayBuilder.toDocument());
+    }
+
+    // a document rebuilt from all of its values
+    {
+        const auto doc = QJsonDocument::fromJson(R"({"id":7,"items":[{"n":"a","t":[1,2]},{"n":"b","t":[]},null],"meta":{"":{"x":false},"y":-0.5}})");
+        QVector<QJsonPath::Compiled> paths;
+        QJsonPath::Compiled root;
+        _handleJsonAttribute_unittest_paths(doc.object(), root, paths);
+        QJsonPath::Builder builder;
+        QJsonValue json;
+        for (const auto& path : paths) {
+            const auto value = QJsonPath::get(doc, path);
+            if (value.isUndefined() || value.isObject() || value.isArray())
+                continue;
+            QJsonPath::set(json, path, value);
+            builder.set(path, value);
+        }
+        Q_ASSERT(builder.toJsonValue() == json);
+        Q_ASSERT(QJsonDocument::fromJson(builder.toJson()) == QJsonDocument(json.toObject()));
+    }
+
+    // append and insert
+    {
+        QJsonPath::Builder builder;
+        builder.append("list", 1);
+        builder.append("list", 2);
+        builder.insert("list[0]", 0);
+        builder.insert("list[-1]", 9);
+        builder.insert("list[6]", 6);
+        builder.insert(QVariantList{ "list", 2 }, QJsonObject{ { "k", "v" } });
+        builder.set("list[2]/w", true);
+        builder.append("list[2]/k", "x"); // a string becomes an array
+        Q_ASSERT(builder.toJsonValue() == QJsonObject({ { "list", QJsonArray{ 0, 1, QJsonObject{ { "k", QJsonArray{ "x" } }, { "w", true } }, 9, 2, QJsonValue(), QJsonValue(), 6 } } }));
+        Q_ASSERT(QJsonDocument::fromJson(builder.toJson()) == builder.toDocument());
+
+        builder.clear();
+        Q_ASSERT(builder.isEmpty() && builder.nodeCount() == 1);
+        builder.append(QJsonPath::Compiled(), "first");
+        builder.append(QJsonPath::Compiled(), "second");
+        Q_ASSERT(builder.toJson() == R"(["first","second"])");
+    }
+
+    // large objects and arrays grow their child lists in the arena
+    {
+        QJsonPath::Builder builder;
+        QJsonObject expected;
+        for (int i = 0; i < 3000; i++) {
+            const auto key = QString("k%1").arg(i);
+            builder.set(QVariantList{ "obj", key }, i);
+            builder.append("arr", i);
+            expected.insert(key, i);
+        }
+        const auto result = builder.toJsonValue().toObject();
+        Q_ASSERT(result.value("obj") == expected);
+        Q_ASSERT(result.value("arr").toArray().size() == 3000 && result.value("arr").toArray().at(2999) == 2999);
+    }
+}
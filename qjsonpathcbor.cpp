@@ -0,0 +1,566 @@
+// MIT License Copyright (C) 2023 heksbeks https://github.com/heksbeks/qjsonpath
+
+#include "qjsonpath.h"
+#include "qjsonpath_p.h"
+#include <QCborStreamReader>
+
+
+// Mutation engine for CBOR, the same scheme as for JSON: every container is taken out of its holder before it is modified,
+// so it is the only reference and changes are made inplace.
+static void __handleCborAttribute(QCborValue& value, const QJsonPath::Compiled& path, int pos, const QCborValue& newValue, HANDLE_JSON_OP op);
+
+// token at pos must be a key
+static void __handleCborAttribute(QCborMap& map, const QJsonPath::Compiled& path, int pos, const QCborValue& newValue, HANDLE_JSON_OP op)
+{
+    const auto& keyName = path.key(pos);
+    auto it = map.find(keyName);
+    if (it == map.end()) {
+        if (op == HANDLE_JSON_OP::REMOVE)
+            return;
+        it = map.insert(keyName, QCborValue());
+    }
+
+    if (pos + 1 >= path.size()) {
+        if (op == HANDLE_JSON_OP::SET)
+            it.value() = newValue;
+        else if (op == HANDLE_JSON_OP::REMOVE)
+            map.erase(it);
+        return;
+    }
+
+    QCborValue subValue = it.value();
+    it.value() = QCborValue(); // take the child out, subValue holds the only reference now
+    __handleCborAttribute(subValue, path, pos + 1, newValue, op);
+    it.value() = subValue;
+}
+
+// token at pos must be an index or "[+]"
+static void __handleCborAttribute(QCborArray& arr, const QJsonPath::Compiled& path, int pos, const QCborValue& newValue, HANDLE_JSON_OP op)
+{
+    qsizetype idx = path.type(pos) == QJsonPath::Compiled::Append ? arr.size() : path.index(pos);
+    if (idx < 0)
+        idx = arr.size() ? arr.size() + idx : 0; // -1 is last element
+    if (idx < 0) // counts down beyond the first element
+        return;
+    if (op == HANDLE_JSON_OP::SET) {
+        while (idx >= arr.size())
+            arr.append(QCborValue(QCborValue::Null));
+    }
+    else if (op == HANDLE_JSON_OP::REMOVE) {
+        if (idx >= arr.size())
+            return;
+    }
+
+    if (pos + 1 >= path.size()) {
+        if (op == HANDLE_JSON_OP::SET)
+            arr[idx] = newValue;
+        else if (op == HANDLE_JSON_OP::REMOVE)
+            arr.removeAt(idx);
+        return;
+    }
+
+    QCborValue subValue = arr.at(idx);
+    arr[idx] = QCborValue(); // take the child out, subValue holds the only reference now
+    __handleCborAttribute(subValue, path, pos + 1, newValue, op);
+    arr[idx] = subValue;
+}
+
+static void __handleCborAttribute(QCborValue& value, const QJsonPath::Compiled& path, int pos, const QCborValue& newValue, HANDLE_JSON_OP op)
+{
+    const auto type = path.type(pos);
+    if (type == QJsonPath::Compiled::Key) {
+        if (!value.isMap() && op == HANDLE_JSON_OP::REMOVE)
+            return;
+        auto map = value.isMap() ? value.toMap() : QCborMap();
+        value = QCborValue(); // map holds the only reference now
+        __handleCborAttribute(map, path, pos, newValue, op);
+        value = map;
+    }
+    else if (type == QJsonPath::Compiled::Index || type == QJsonPath::Compiled::Append) {
+        if (!value.isArray() && op == HANDLE_JSON_OP::REMOVE)
+            return;
+        auto arr = value.isArray() ? value.toArray() : QCborArray();
+        value = QCborValue(); // arr holds the only reference now
+        __handleCborAttribute(arr, path, pos, newValue, op);
+        value = arr;
+    }
+    else
+        Q_ASSERT_X(type == QJsonPath::Compiled::Key || type == QJsonPath::Compiled::Index || type == QJsonPath::Compiled::Append, __FUNCTION__, QString("invalid path type at position %1").arg(pos).toUtf8());
+}
+
+static void _handleCborAttribute(QCborValue& value, const QJsonPath::Compiled& path, const QCborValue& newValue, HANDLE_JSON_OP op)
+{
+    if (path.isEmpty())
+        return;
+    __handleCborAttribute(value, path, 0, newValue, op);
+}
+
+static void _handleCborAttribute(QCborMap& map, const QJsonPath::Compiled& path, const QCborValue& newValue, HANDLE_JSON_OP op)
+{
+    if (path.isEmpty())
+        return;
+    if (path.type(0) == QJsonPath::Compiled::Key) {
+        __handleCborAttribute(map, path, 0, newValue, op);
+        return;
+    }
+    Q_ASSERT_X(path.type(0) == QJsonPath::Compiled::Key, __FUNCTION__, "invalid path, path must result to a root map");
+}
+
+static void _handleCborAttribute(QCborArray& arr, const QJsonPath::Compiled& path, const QCborValue& newValue, HANDLE_JSON_OP op)
+{
+    if (path.isEmpty())
+        return;
+    if (path.type(0) == QJsonPath::Compiled::Index || path.type(0) == QJsonPath::Compiled::Append) {
+        __handleCborAttribute(arr, path, 0, newValue, op);
+        return;
+    }
+    Q_ASSERT_X(path.type(0) == QJsonPath::Compiled::Index || path.type(0) == QJsonPath::Compiled::Append, __FUNCTION__, "invalid path, path must result to a root array");
+}
+
+
+// read only lookup from token pos on, only const functions are used on the containers so nothing is detached or copied
+static QCborValue __getCborAttribute(QCborValue value, const QJsonPath::Compiled& path, int pos)
+{
+    for (; pos < path.size(); pos++) {
+        const auto type = path.type(pos);
+        if (type == QJsonPath::Compiled::Key) {
+            if (!value.isMap())
+                return QCborValue(QCborValue::Undefined);
+            const auto map = value.toMap();
+            const auto it = map.constFind(path.key(pos));
+            if (it == map.constEnd())
+                return QCborValue(QCborValue::Undefined);
+            value = it.value();
+        }
+        else if (type == QJsonPath::Compiled::Index) {
+            if (!value.isArray())
+                return QCborValue(QCborValue::Undefined);
+            const auto arr = value.toArray();
+            qsizetype idx = path.index(pos);
+            if (idx < 0)
+                idx = arr.size() + idx; // -1 is last element
+            if (idx < 0 || idx >= arr.size())
+                return QCborValue(QCborValue::Undefined);
+            value = arr.at(idx);
+        }
+        else if (type == QJsonPath::Compiled::Append)
+            return QCborValue(QCborValue::Undefined); // the element after the last one never exists
+        else {
+            Q_ASSERT_X(type == QJsonPath::Compiled::Key || type == QJsonPath::Compiled::Index, __FUNCTION__, QString("invalid path type at position %1").arg(pos).toUtf8());
+            return value;
+        }
+    }
+    return value;
+}
+
+
+void QJsonPath::set(QCborValue& root, const QVariantList& path, const QCborValue& newValue)
+{
+    _handleCborAttribute(root, Compiled(path, Compiled::Temporary()), newValue, HANDLE_JSON_OP::SET);
+}
+void QJsonPath::set(QCborMap& root, const QVariantList& path, const QCborValue& newValue)
+{
+    _handleCborAttribute(root, Compiled(path, Compiled::Temporary()), newValue, HANDLE_JSON_OP::SET);
+}
+void QJsonPath::set(QCborArray& root, const QVariantList& path, const QCborValue& newValue)
+{
+    _handleCborAttribute(root, Compiled(path, Compiled::Temporary()), newValue, HANDLE_JSON_OP::SET);
+}
+
+void QJsonPath::set(QCborValue& root, const Compiled& path, const QCborValue& newValue)
+{
+    _handleCborAttribute(root, path, newValue, HANDLE_JSON_OP::SET);
+}
+void QJsonPath::set(QCborMap& root, const Compiled& path, const QCborValue& newValue)
+{
+    _handleCborAttribute(root, path, newValue, HANDLE_JSON_OP::SET);
+}
+void QJsonPath::set(QCborArray& root, const Compiled& path, const QCborValue& newValue)
+{
+    _handleCborAttribute(root, path, newValue, HANDLE_JSON_OP::SET);
+}
+
+QCborValue QJsonPath::get(const QCborValue& root, const QVariantList& path, const QCborValue& defaultValue)
+{
+    return get(root, Compiled(path, Compiled::Temporary()), defaultValue);
+}
+QCborValue QJsonPath::get(const QCborMap& root, const QVariantList& path, const QCborValue& defaultValue)
+{
+    return get(root, Compiled(path, Compiled::Temporary()), defaultValue);
+}
+QCborValue QJsonPath::get(const QCborArray& root, const QVariantList& path, const QCborValue& defaultValue)
+{
+    return get(root, Compiled(path, Compiled::Temporary()), defaultValue);
+}
+
+QCborValue QJsonPath::get(const QCborValue& root, const Compiled& path, const QCborValue& defaultValue)
+{
+    auto value = __getCborAttribute(root, path, 0);
+    return value.isUndefined() ? defaultValue : value;
+}
+QCborValue QJsonPath::get(const QCborMap& root, const Compiled& path, const QCborValue& defaultValue)
+{
+    auto value = __getCborAttribute(root, path, 0);
+    return value.isUndefined() ? defaultValue : value;
+}
+QCborValue QJsonPath::get(const QCborArray& root, const Compiled& path, const QCborValue& defaultValue)
+{
+    auto value = __getCborAttribute(root, path, 0);
+    return value.isUndefined() ? defaultValue : value;
+}
+
+void QJsonPath::remove(QCborValue& root, const QVariantList& path)
+{
+    _handleCborAttribute(root, Compiled(path, Compiled::Temporary()), QCborValue(), HANDLE_JSON_OP::REMOVE);
+}
+void QJsonPath::remove(QCborMap& root, const QVariantList& path)
+{
+    _handleCborAttribute(root, Compiled(path, Compiled::Temporary()), QCborValue(), HANDLE_JSON_OP::REMOVE);
+}
+void QJsonPath::remove(QCborArray& root, const QVariantList& path)
+{
+    _handleCborAttribute(root, Compiled(path, Compiled::Temporary()), QCborValue(), HANDLE_JSON_OP::REMOVE);
+}
+
+void QJsonPath::remove(QCborValue& root, const Compiled& path)
+{
+    _handleCborAttribute(root, path, QCborValue(), HANDLE_JSON_OP::REMOVE);
+}
+void QJsonPath::remove(QCborMap& root, const Compiled& path)
+{
+    _handleCborAttribute(root, path, QCborValue(), HANDLE_JSON_OP::REMOVE);
+}
+void QJsonPath::remove(QCborArray& root, const Compiled& path)
+{
+    _handleCborAttribute(root, path, QCborValue(), HANDLE_JSON_OP::REMOVE);
+}
+
+
+// resolves the paths on the stream, only containers on a path are entered, everything else is skipped by the reader
+struct QJsonPath::CborReader::Walker
+{
+    CborReader& reader;
+    const QVector<Compiled>& paths; // const access, the containers are never detached while walking
+    const QVector<QVector<QByteArray>>& keys;
+    QCborStreamReader& stream;
+    QVector<QCborValue>& values;
+
+    bool failed() const { return !reader.m_error.isEmpty() || stream.lastError() != QCborError::NoError; }
+
+    void fail(const QString& message)
+    {
+        if (reader.m_error.isEmpty())
+            reader.m_error = QString("%1 at offset %2").arg(message).arg(stream.currentOffset());
+    }
+
+    // candidate lists reused between calls, one set per depth so the recursion does not allocate
+    QVector<int>& containerList(int depth) { return reader.m_lists[3 * depth]; }
+    QVector<int>& childList(int depth) { return reader.m_lists[3 * depth + 1]; }
+    QVector<int>& remainingList(int depth) { return reader.m_lists[3 * depth + 2]; }
+
+    // skips the current item, next() on a tag only moves to the tagged item
+    void skip()
+    {
+        while (stream.isTag() && stream.next()) {
+        }
+        stream.next();
+    }
+
+    // reads the UTF-8 bytes of the current text string into the key buffer
+    bool readKey()
+    {
+        auto& key = reader.m_key;
+        key.clear();
+        for (;;) {
+            const qsizetype chunk = qMax<qsizetype>(stream.currentStringChunkSize(), 0);
+            const qsizetype size = key.size();
+            key.resize(size + chunk);
+            const auto result = stream.readStringChunk(key.data() + size, chunk);
+            key.resize(size + (result.status == QCborStreamReader::Ok ? result.data : 0));
+            if (result.status == QCborStreamReader::EndOfString)
+                return true;
+            if (result.status == QCborStreamReader::Error)
+                return false;
+        }
+    }
+
+    void value(int depth, const QVector<int>& candidates)
+    {
+        if (candidates.isEmpty()) {
+            skip();
+            return;
+        }
+        const bool map = stream.isMap();
+        const bool array = stream.isArray();
+        bool decode = false;
+        auto& below = containerList(depth);
+        below.clear();
+        for (const int p : candidates) {
+            const auto& path = paths[p];
+            if (path.size() == depth)
+                decode = true;
+            else if ((map && path.type(depth) == Compiled::Key) || (array && path.type(depth) == Compiled::Index)) {
+                below.append(p);
+                decode |= array && path.index(depth) < 0 && !stream.isLengthKnown(); // the size is known only at the end
+            }
+        }
+
+        if (decode) {
+            // the value is decoded once, the paths continuing below it are resolved on the decoded value
+            const auto value = QCborValue::fromCbor(stream);
+            for (const int p : candidates)
+                values[p] = __getCborAttribute(value, paths[p], depth);
+            return;
+        }
+        if (below.isEmpty())
+            skip();
+        else if (map)
+            this->map(depth, below);
+        else
+            this->array(depth, below);
+    }
+
+    void map(int depth, const QVector<int>& candidates)
+    {
+        // a key found again is ignored, as QCborMap finds the first one
+        auto& remaining = remainingList(depth);
+        remaining.clear();
+        for (const int p : candidates)
+            remaining.append(p);
+        auto& below = childList(depth);
+        if (!stream.enterContainer())
+            return;
+        while (stream.hasNext()) {
+            below.clear();
+            if (!remaining.isEmpty() && stream.isString()) {
+                if (!readKey())
+                    return;
+                for (int i = 0; i < remaining.size();) {
+                    const int p = remaining[i];
+                    if (keys[p][depth] == reader.m_key) {
+                        below.append(p);
+                        remaining.remove(i);
+                    }
+                    else
+                        i++;
+                }
+            }
+            else
+                skip();
+            if (failed())
+                return;
+            if (!stream.hasNext()) {
+                fail("map key without value");
+                return;
+            }
+            value(depth + 1, below);
+            if (failed())
+                return;
+        }
+        stream.leaveContainer();
+    }
+
+    void array(int depth, const QVector<int>& candidates)
+    {
+        // length() of an array of indefinite length is an error of the stream, a negative index decodes such an array instead
+        const qint64 length = stream.isLengthKnown() ? qint64(stream.length()) : -1;
+        auto& below = childList(depth);
+        if (!stream.enterContainer())
+            return;
+        for (qint64 e = 0; stream.hasNext(); e++) {
+            below.clear();
+            for (const int p : candidates) {
+                const qint64 idx = paths[p].index(depth);
+                if ((idx < 0 ? length + idx : idx) == e)
+                    below.append(p);
+            }
+            value(depth + 1, below);
+            if (failed())
+                return;
+        }
+        stream.leaveContainer();
+    }
+};
+
+
+QJsonPath::CborReader::CborReader(const QVector<Compiled>& paths)
+{
+    for (const auto& path : paths)
+        addPath(path);
+}
+
+int QJsonPath::CborReader::addPath(const Compiled& path)
+{
+    QVector<QByteArray> keys;
+    for (int i = 0; i < path.size(); i++)
+        keys.append(path.type(i) == Compiled::Key ? path.key(i).toUtf8() : QByteArray());
+    m_paths.append(path);
+    m_keys.append(keys);
+    m_all.append(int(m_all.size()));
+    if (m_lists.size() < 3 * (path.size() + 1))
+        m_lists.resize(3 * (path.size() + 1));
+    return int(m_paths.size()) - 1;
+}
+
+QVector<QCborValue> QJsonPath::CborReader::read(const QByteArray& cbor)
+{
+    QVector<QCborValue> values;
+    read(cbor, values);
+    return values;
+}
+
+bool QJsonPath::CborReader::read(const QByteArray& cbor, QVector<QCborValue>& values)
+{
+    QCborStreamReader stream(cbor);
+    if (!read(stream, values))
+        return false;
+    if (stream.currentOffset() != cbor.size()) {
+        m_error = QString("garbage at the end of the data at offset %1").arg(stream.currentOffset());
+        values.fill(QCborValue(QCborValue::Undefined));
+        return false;
+    }
+    return true;
+}
+
+bool QJsonPath::CborReader::read(QCborStreamReader& stream, QVector<QCborValue>& values)
+{
+    values.fill(QCborValue(QCborValue::Undefined), m_paths.size());
+    m_error.clear();
+
+    Walker walker{ *this, m_paths, m_keys, stream, values };
+    if (!stream.isValid())
+        walker.fail(stream.lastError() != QCborError::NoError ? stream.lastError().toString() : QString("no item"));
+    else
+        walker.value(0, m_all);
+    if (stream.lastError() != QCborError::NoError)
+        walker.fail(stream.lastError().toString());
+
+    if (walker.failed()) {
+        values.fill(QCborValue(QCborValue::Undefined));
+        return false;
+    }
+    return true;
+}
+
+
+void _handleJsonAttribute_unittest_cbor()
+{
+    // get, set and remove give the same results as on JSON
+    const char* const documents[] = {
+        R"({"a":1,"b":[true,false,null],"c":{"d":"text","e":[]},"f":{}})",
+        R"([[1,[2,[3,[4]]]],{"x":-1.5e3,"y":0,"z":-0.25},"",[{"id":7},{"id":8,"tags":["p","q"]}]])",
+        R"({"":{"":[0,{"":null}]},"name":{"v":12345678901,"w":"é and 😀"}})",
+    };
+    for (const char* document : documents) {
+        const auto doc = QJsonDocument::fromJson(document);
+        Q_ASSERT(!doc.isNull());
+        const QJsonValue json = doc.isArray() ? QJsonValue(doc.array()) : QJsonValue(doc.object());
+        const auto cbor = QCborValue::fromJsonValue(json);
+        QVector<QJsonPath::Compiled> paths;
+        QJsonPath::Compiled root;
+        _handleJsonAttribute_unittest_paths(json, root, paths);
+        paths.append(QJsonPath::Compiled("c/new[2]/x"));
+        paths.append(QJsonPath::Compiled("[5]"));
+
+        for (const auto& path : paths) {
+            Q_ASSERT(QJsonPath::get(cbor, path) == QCborValue::fromJsonValue(QJsonPath::get(json, path)));
+
+            auto jsonSet = json;
+            auto cborSet = cbor;
+            QJsonPath::set(jsonSet, path, "new");
+            QJsonPath::set(cborSet, path, "new");
+            Q_ASSERT(cborSet.toJsonValue() == jsonSet); // compared as JSON, a QCborMap keeps the insertion order
+
+            auto jsonRemoved = json;
+            auto cborRemoved = cbor;
+            QJsonPath::remove(jsonRemoved, path);
+            QJsonPath::remove(cborRemoved, path);
+            Q_ASSERT(cborRemoved.toJsonValue() == jsonRemoved);
+        }
+        Q_ASSERT(cbor == QCborValue::fromJsonValue(json)); // the copies were detached, not the original
+    }
+    {
+        QCborMap map;
+        QJsonPath::set(map, "a/b[1]", 5);
+        QJsonPath::set(map, QVariantList{ "a", "c" }, QCborValue(QByteArray("bytes")));
+        Q_ASSERT(QJsonPath::get(map, "a/b[-1]") == 5 && QJsonPath::get(map, "a/b[0]").isNull());
+        Q_ASSERT(QJsonPath::get(map, "a/c").toByteArray() == "bytes");
+        Q_ASSERT(QJsonPath::get(map, "a/x", 7) == 7);
+        QJsonPath::remove(map, "a/b");
+        Q_ASSERT(QJsonPath::get(map, "a/b").isUndefined());
+        QCborArray arr;
+        QJsonPath::set(arr, "[1]/k", true);
+        Q_ASSERT(arr.size() == 2 && QJsonPath::get(arr, "[1]/k") == true);
+        QJsonPath::remove(arr, QVariantList{ 0 });
+        Q_ASSERT(arr.size() == 1);
+    }
+
+    // the stream reader gives the same values as get on the decoded item
+    for (const char* document : documents) {
+        const auto doc = QJsonDocument::fromJson(document);
+        const QJsonValue json = doc.isArray() ? QJsonValue(doc.array()) : QJsonValue(doc.object());
+        QVector<QJsonPath::Compiled> paths;
+        QJsonPath::Compiled root;
+        _handleJsonAttribute_unittest_paths(json, root, paths);
+        paths.append(QJsonPath::Compiled());
+        const auto bytes = QCborValue::fromJsonValue(json).toCbor();
+        const auto cbor = QCborValue::fromCbor(bytes);
+        QJsonPath::CborReader reader(paths);
+        QVector<QCborValue> values;
+        Q_ASSERT(reader.read(bytes, values));
+        for (int p = 0; p < paths.size(); p++)
+            Q_ASSERT(values[p] == QJsonPath::get(cbor, paths[p]));
+    }
+
+    // indefinite lengths, chunked strings, tags and repeated keys
+    {
+        const uchar data[] = {
+            0xbf,                                     // map of indefinite length
+            0x61, 'a', 0x9f, 0x01, 0x02, 0x03, 0xff,  // "a": array of indefinite length
+            0x61, 'b', 0x7f, 0x61, 'x', 0x61, 'y', 0xff, // "b": chunked text
+            0x7f, 0x61, 'k', 0x61, 'y', 0xff, 0x05,   // chunked key "ky": 5
+            0x61, 't', 0xc1, 0x1a, 0, 0, 0, 1,        // "t": tagged epoch time
+            0x61, 'm', 0xa1, 0x61, 'n', 0x06,         // "m": {"n": 6}
+            0x61, 'a', 0x07,                          // "a" again, the first one is used
+            0xff,
+        };
+        const QByteArray bytes(reinterpret_cast<const char*>(data), sizeof(data));
+        const auto cbor = QCborValue::fromCbor(bytes);
+        Q_ASSERT(cbor.isMap());
+        const QVector<QJsonPath::Compiled> paths{ QJsonPath::Compiled("a[-1]"), QJsonPath::Compiled("a[0]"), QJsonPath::Compiled("b"), QJsonPath::Compiled("ky"),
+                                                  QJsonPath::Compiled("t"), QJsonPath::Compiled("m/n"), QJsonPath::Compiled("t/x"), QJsonPath::Compiled("a") };
+        const auto values = QJsonPath::CborReader(paths).read(bytes);
+        for (int p = 0; p < paths.size(); p++)
+            Q_ASSERT(values[p] == QJsonPath::get(cbor, paths[p]));
+        Q_ASSERT(values[0] == 3 && values[2] == "xy" && values[3] == 5 && values[5] == 6 && values[6].isUndefined());
+        // without a negative index the array of indefinite length is walked, not decoded
+        QJsonPath::CborReader first({ QJsonPath::Compiled("a[0]"), QJsonPath::Compiled("a[2]"), QJsonPath::Compiled("a[3]") });
+        QVector<QCborValue> elements;
+        Q_ASSERT(first.read(bytes, elements) && first.errorString().isEmpty());
+        Q_ASSERT(elements[0] == 1 && elements[1] == 3 && elements[2].isUndefined());
+    }
+
+    // a sequence of items is read from one stream
+    {
+        const QByteArray bytes = QCborValue(QCborMap{ { "id", 1 } }).toCbor() + QCborValue(QCborMap{ { "id", 2 } }).toCbor();
+        QCborStreamReader stream(bytes);
+        QJsonPath::CborReader reader({ QJsonPath::Compiled("id") });
+        QVector<QCborValue> values;
+        Q_ASSERT(reader.read(stream, values) && values[0] == 1);
+        Q_ASSERT(reader.read(stream, values) && values[0] == 2);
+        Q_ASSERT(!reader.read(stream, values) && !reader.errorString().isEmpty());
+    }
+
+    // invalid data
+    {
+        const auto bytes = QCborValue(QCborMap{ { "a", QCborArray{ 1, 2 } }, { "b", "text" } }).toCbor();
+        QJsonPath::CborReader reader({ QJsonPath::Compiled("b"), QJsonPath::Compiled("a[1]") });
+        QVector<QCborValue> values;
+        for (int size = 0; size < bytes.size(); size++) {
+            Q_ASSERT(!reader.read(bytes.left(size), values) && !reader.errorString().isEmpty());
+            Q_ASSERT(values.size() == 2 && values[0].isUndefined() && values[1].isUndefined());
+        }
+        Q_ASSERT(reader.read(bytes, values) && values[0] == "text" && values[1] == 2);
+        Q_ASSERT(!reader.read(bytes + QByteArray(1, '\x01'), values) && values[0].isUndefined());
+    }
+}
@@ -0,0 +1,627 @@
+// MIT License Copyright (C) 2023 heksbeks https://github.com/heksbeks/qjsonpath
+
+#include "qjsonpath.h"
+#include "qjsonpath_p.h"
+#include <cstring>
+
+#if defined(Q_PROCESSOR_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define QJSONPATH_INDEX_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(Q_PROCESSOR_X86) && (defined(Q_CC_GNU) || defined(Q_CC_CLANG) || defined(Q_CC_MSVC))
+#define QJSONPATH_INDEX_AVX2
+#include <immintrin.h>
+#ifdef Q_CC_MSVC
+#include <intrin.h>
+#define QJSONPATH_TARGET_AVX2
+#else
+#define QJSONPATH_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+
+// Structural index: one bit per byte of a 64 byte block for quotes, backslashes and the characters {}[]:,
+// The kernels only classify the bytes, escapes and strings are resolved on the bit masks.
+struct _IndexMasks
+{
+    quint64 quote;
+    quint64 backslash;
+    quint64 op;
+};
+typedef void (*_IndexKernel)(const char* block, _IndexMasks& masks);
+
+static void _index_scalar(const char* block, _IndexMasks& masks)
+{
+    masks = { 0, 0, 0 };
+    for (int i = 0; i < 64; i++) {
+        const quint64 bit = quint64(1) << i;
+        switch (block[i]) {
+        case '"':
+            masks.quote |= bit;
+            break;
+        case '\\':
+            masks.backslash |= bit;
+            break;
+        case '{':
+        case '}':
+        case '[':
+        case ']':
+        case ':':
+        case ',':
+            masks.op |= bit;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+#ifdef QJSONPATH_INDEX_SSE2
+static void _index_sse2(const char* block, _IndexMasks& masks)
+{
+    // '[' | 0x20 is '{' and ']' | 0x20 is '}', no other byte folds to them
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i fold = _mm_set1_epi8(0x20);
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    masks = { 0, 0, 0 };
+    for (int i = 0; i < 4; i++) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+        const __m128i folded = _mm_or_si128(v, fold);
+        const __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)),
+                                        _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+        masks.quote |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)))) << (16 * i);
+        masks.backslash |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)))) << (16 * i);
+        masks.op |= quint64(quint16(_mm_movemask_epi8(op))) << (16 * i);
+    }
+}
+#endif
+
+#ifdef QJSONPATH_INDEX_AVX2
+QJSONPATH_TARGET_AVX2 static void _index_avx2(const char* block, _IndexMasks& masks)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i fold = _mm256_set1_epi8(0x20);
+    const __m256i open = _mm256_set1_epi8('{');
+    const __m256i close = _mm256_set1_epi8('}');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i comma = _mm256_set1_epi8(',');
+    masks = { 0, 0, 0 };
+    for (int i = 0; i < 2; i++) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32 * i));
+        const __m256i folded = _mm256_or_si256(v, fold);
+        const __m256i op = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(folded, open), _mm256_cmpeq_epi8(folded, close)),
+                                           _mm256_or_si256(_mm256_cmpeq_epi8(v, colon), _mm256_cmpeq_epi8(v, comma)));
+        masks.quote |= quint64(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)))) << (32 * i);
+        masks.backslash |= quint64(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash)))) << (32 * i);
+        masks.op |= quint64(quint32(_mm256_movemask_epi8(op))) << (32 * i);
+    }
+}
+
+static bool _index_hasAvx2()
+{
+#ifdef Q_CC_MSVC
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    const bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5));
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+struct _IndexDispatch
+{
+    _IndexKernel kernel;
+    const char* name;
+};
+
+static _IndexDispatch _index_select()
+{
+#ifdef QJSONPATH_INDEX_AVX2
+    if (_index_hasAvx2())
+        return { _index_avx2, "avx2" };
+#endif
+#ifdef QJSONPATH_INDEX_SSE2
+    return { _index_sse2, "sse2" };
+#else
+    return { _index_scalar, "scalar" };
+#endif
+}
+
+static const _IndexDispatch& _index_dispatch()
+{
+    static const _IndexDispatch dispatch = _index_select();
+    return dispatch;
+}
+
+// resolves escapes and strings on the masks of a block, returns the structural characters outside of strings and the opening quotes,
+// escapedCarry and inStringCarry pass the state from one block to the next
+static quint64 _index_structural(const _IndexMasks& masks, quint64& escapedCarry, quint64& inStringCarry)
+{
+    // a backslash escapes the next byte, which is then no backslash itself, they are rare so a loop is fine
+    quint64 escaped = escapedCarry;
+    quint64 backslash = masks.backslash & ~escapedCarry;
+    escapedCarry = 0;
+    while (backslash) {
+        const uint i = qCountTrailingZeroBits(backslash);
+        if (i == 63)
+            escapedCarry = 1;
+        else
+            escaped |= quint64(1) << (i + 1);
+        backslash &= ~(quint64(3) << i);
+    }
+
+    // prefix xor of the quotes: bits from an opening quote up to the byte before its closing quote
+    const quint64 quote = masks.quote & ~escaped;
+    quint64 inString = quote;
+    inString ^= inString << 1;
+    inString ^= inString << 2;
+    inString ^= inString << 4;
+    inString ^= inString << 8;
+    inString ^= inString << 16;
+    inString ^= inString << 32;
+    inString ^= inStringCarry;
+    inStringCarry = (inString >> 63) ? ~quint64(0) : 0;
+
+    return (masks.op & ~inString) | (quote & inString);
+}
+
+// writes the positions of the structural characters outside of strings and of the opening quotes to index,
+// returns their count or -1 if the last string is not closed
+static int _index_build(_IndexKernel kernel, const char* data, int size, QVector<int>& index)
+{
+    if (index.size() < size + 1)
+        index.resize(size + 1);
+    int* out = index.data();
+    int count = 0;
+    quint64 escapedCarry = 0; // the first byte of the next block is escaped
+    quint64 inStringCarry = 0; // all bits set if the next block starts inside a string
+    char tail[64];
+
+    for (int base = 0; base < size; base += 64) {
+        const char* block = data + base;
+        if (size - base < 64) {
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, block, size_t(size - base));
+            block = tail;
+        }
+        _IndexMasks masks;
+        kernel(block, masks);
+        quint64 structural = _index_structural(masks, escapedCarry, inStringCarry);
+        while (structural) {
+            out[count++] = base + int(qCountTrailingZeroBits(structural));
+            structural &= structural - 1;
+        }
+    }
+    return inStringCarry ? -1 : count;
+}
+
+_JsonScanner::_JsonScanner(const char* data, qint64 size, qint64 pos) : m_data(data), m_size(size), m_base(pos)
+{
+}
+
+qint64 _JsonScanner::next()
+{
+    while (!m_bits) {
+        if (m_base >= m_size)
+            return -1;
+        const char* block = m_data + m_base;
+        char tail[64];
+        if (m_size - m_base < 64) {
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, block, size_t(m_size - m_base));
+            block = tail;
+        }
+        _IndexMasks masks;
+        _index_dispatch().kernel(block, masks);
+        m_bits = _index_structural(masks, m_escapedCarry, m_inStringCarry);
+        m_blockBase = m_base;
+        m_base += 64;
+    }
+    const qint64 pos = m_blockBase + qCountTrailingZeroBits(m_bits);
+    m_bits &= m_bits - 1;
+    return pos;
+}
+
+QJsonValue _handleJsonAttribute_decode(const char* text, int length, QByteArray& buffer)
+{
+    if (length <= 0)
+        return QJsonValue(QJsonValue::Undefined);
+    if (text[0] == '"' && length >= 2 && text[length - 1] == '"' && !std::memchr(text + 1, '\\', size_t(length - 2)))
+        return QString::fromUtf8(text + 1, length - 2);
+    if (text[0] != '"' && text[0] != '{' && text[0] != '[') {
+        if (!_handleJsonAttribute_isLiteral(text, length))
+            return QJsonValue(QJsonValue::Undefined);
+        if (text[0] == 't' || text[0] == 'f')
+            return text[0] == 't';
+        if (text[0] == 'n')
+            return QJsonValue();
+        // an integer is stored as qint64 by the document parser (as double by Qt 5, which QJsonValue converts to)
+        if (length <= 18 && !std::memchr(text, '.', size_t(length)) && !std::memchr(text, 'e', size_t(length)) && !std::memchr(text, 'E', size_t(length))) {
+            const bool negative = text[0] == '-';
+            qint64 n = 0;
+            for (int i = negative; i < length; i++)
+                n = n * 10 + (text[i] - '0');
+            if (n || !negative) // -0 is a double
+                return QJsonValue(negative ? -n : n);
+        }
+        bool ok;
+        const double d = QByteArray::fromRawData(text, length).toDouble(&ok);
+        if (ok && qIsFinite(d))
+            return d;
+    }
+
+    // a document root must be an object or an array, so the value is parsed as the element of an array
+    buffer.clear();
+    buffer.append('[');
+    buffer.append(text, length);
+    buffer.append(']');
+    QJsonParseError error;
+    const auto doc = QJsonDocument::fromJson(buffer, &error);
+    if (error.error != QJsonParseError::NoError)
+        return QJsonValue(QJsonValue::Undefined);
+    return doc.array().at(0);
+}
+
+
+// resolves the paths on the structural index, recursion only follows the paths, everything else is skipped by counting brackets
+struct QJsonPath::Extractor::Walker
+{
+    Extractor& extractor;
+    const QVector<Compiled>& paths; // const access, the containers are never detached while walking
+    const QVector<QVector<QByteArray>>& keys;
+    const char* data;
+    int size;
+    const int* index;
+    int count;
+    QVector<QJsonValue>& values;
+
+    bool failed() const { return !extractor.m_error.isEmpty(); }
+
+    int fail(const QString& message, int pos)
+    {
+        if (!failed())
+            extractor.m_error = QString("%1 at offset %2").arg(message).arg(pos);
+        return count;
+    }
+
+    static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+    int firstNonSpace(int pos) const
+    {
+        while (pos < size && isSpace(data[pos]))
+            pos++;
+        return pos;
+    }
+
+    // end of the text before pos without trailing spaces
+    int trimmedEnd(int pos) const
+    {
+        while (pos > 0 && isSpace(data[pos - 1]))
+            pos--;
+        return pos;
+    }
+
+    char at(int k) const { return k < count ? data[index[k]] : '\0'; }
+
+    // k is an opening bracket, returns its closing bracket
+    int skip(int k)
+    {
+        int depth = 0;
+        for (; k < count; k++) {
+            const char c = data[index[k]];
+            if (c == '{' || c == '[')
+                depth++;
+            else if ((c == '}' || c == ']') && !--depth)
+                return k;
+        }
+        return fail("container not closed", size);
+    }
+
+    QJsonValue decode(int begin, int end)
+    {
+        const auto value = _handleJsonAttribute_decode(data + begin, end - begin, extractor.m_buffer);
+        if (value.isUndefined())
+            fail("invalid value", begin);
+        return value;
+    }
+
+    // candidate lists reused between calls, one set per depth so the recursion does not allocate
+    QVector<int>& containerList(int depth) { return extractor.m_lists[3 * depth]; }
+    QVector<int>& childList(int depth) { return extractor.m_lists[3 * depth + 1]; }
+    QVector<int>& elementList(int depth) { return extractor.m_lists[3 * depth + 2]; }
+
+    // the value starts at byte begin, k is the first structural character at or after it,
+    // returns the structural character following the value
+    int value(int begin, int k, int depth, const QVector<int>& candidates)
+    {
+        int next;
+        int end;
+        const char c = data[begin];
+        if (k < count && index[k] == begin && (c == '{' || c == '[')) {
+            int close;
+            if (candidates.isEmpty())
+                close = skip(k);
+            else {
+                auto& below = containerList(depth);
+                below.clear();
+                for (const int p : candidates) {
+                    const auto& path = paths[p];
+                    if (path.size() > depth && path.type(depth) == (c == '{' ? Compiled::Key : Compiled::Index))
+                        below.append(p);
+                }
+                close = below.isEmpty() ? skip(k) : c == '{' ? object(k, depth, below) : array(k, depth, below);
+            }
+            if (failed())
+                return count;
+            if (at(close) != (c == '{' ? '}' : ']'))
+                return fail("mismatched bracket", close < count ? index[close] : size);
+            next = close + 1;
+            end = index[close] + 1;
+        }
+        else {
+            next = k < count && index[k] == begin && c == '"' ? k + 1 : k; // skips the opening quote
+            end = trimmedEnd(next < count ? index[next] : size);
+            if (end <= begin || (c == '"' && (end - begin < 2 || data[end - 1] != '"')))
+                return fail("expected value", begin);
+        }
+
+        for (const int p : candidates) {
+            if (paths[p].size() == depth)
+                values[p] = decode(begin, end);
+        }
+        return next;
+    }
+
+    // k is an opening brace, returns the closing brace
+    int object(int k, int depth, const QVector<int>& candidates)
+    {
+        int i = k + 1;
+        if (at(i) == '}')
+            return i;
+        auto& below = childList(depth);
+        for (;;) {
+            if (at(i) != '"' || at(i + 1) != ':')
+                return fail("expected key", i < count ? index[i] : size);
+            const int keyBegin = index[i] + 1;
+            const int keyEnd = trimmedEnd(index[i + 1]) - 1; // closing quote
+            if (keyEnd < keyBegin || data[keyEnd] != '"')
+                return fail("expected key", keyBegin);
+
+            below.clear();
+            const int keySize = keyEnd - keyBegin;
+            if (!std::memchr(data + keyBegin, '\\', size_t(keySize))) {
+                for (const int p : candidates) {
+                    const auto& key = keys[p][depth];
+                    if (key.size() == keySize && !std::memcmp(key.constData(), data + keyBegin, size_t(keySize)))
+                        below.append(p);
+                }
+            }
+            else {
+                const auto name = decode(keyBegin - 1, keyEnd + 1).toString();
+                for (const int p : candidates) {
+                    if (paths[p].key(depth) == name)
+                        below.append(p);
+                }
+            }
+            // a key found again replaces the earlier value, as in the document
+            for (const int p : below)
+                values[p] = QJsonValue(QJsonValue::Undefined);
+
+            const int next = value(firstNonSpace(index[i + 1] + 1), i + 2, depth + 1, below);
+            if (failed())
+                return count;
+            if (at(next) != ',')
+                return next;
+            i = next + 1;
+        }
+    }
+
+    // k is an opening bracket, returns the closing bracket
+    int array(int k, int depth, const QVector<int>& candidates)
+    {
+        const int first = firstNonSpace(index[k] + 1);
+        if (first < size && data[first] == ']')
+            return k + 1;
+
+        // a negative index needs the size of the array, the elements are located first then
+        bool negative = false;
+        for (const int p : candidates)
+            negative |= paths[p].index(depth) < 0;
+        auto& below = childList(depth);
+        auto& elements = elementList(depth); // pairs of begin and k
+        elements.clear();
+
+        int begin = first;
+        int i = k + 1;
+        for (int e = 0;; e++) {
+            below.clear();
+            for (const int p : candidates) {
+                if (paths[p].index(depth) == e)
+                    below.append(p);
+            }
+            if (negative)
+                elements << begin << i;
+            const int next = value(begin, i, depth + 1, below);
+            if (failed())
+                return count;
+            if (at(next) != ',') {
+                i = next;
+                break;
+            }
+            begin = firstNonSpace(index[next] + 1);
+            i = next + 1;
+        }
+
+        const int elementCount = int(elements.size()) / 2;
+        for (int e = 0; negative && e < elementCount; e++) {
+            below.clear();
+            for (const int p : candidates) {
+                const int idx = paths[p].index(depth);
+                if (idx < 0 && elementCount + idx == e)
+                    below.append(p);
+            }
+            if (!below.isEmpty())
+                value(elements[2 * e], elements[2 * e + 1], depth + 1, below);
+        }
+        return i;
+    }
+};
+
+
+QJsonPath::Extractor::Extractor(const QVector<Compiled>& paths)
+{
+    for (const auto& path : paths)
+        addPath(path);
+}
+
+int QJsonPath::Extractor::addPath(const Compiled& path)
+{
+    QVector<QByteArray> keys;
+    for (int i = 0; i < path.size(); i++)
+        keys.append(path.type(i) == Compiled::Key ? path.key(i).toUtf8() : QByteArray());
+    m_paths.append(path);
+    m_keys.append(keys);
+    m_all.append(int(m_all.size()));
+    if (m_lists.size() < 3 * (path.size() + 1))
+        m_lists.resize(3 * (path.size() + 1));
+    return int(m_paths.size()) - 1;
+}
+
+const char* QJsonPath::Extractor::kernel()
+{
+    return _index_dispatch().name;
+}
+
+QVector<QJsonValue> QJsonPath::Extractor::extract(const QByteArray& json)
+{
+    QVector<QJsonValue> values;
+    extract(json, values);
+    return values;
+}
+
+bool QJsonPath::Extractor::extract(const char* data, int size, QVector<QJsonValue>& values)
+{
+    values.fill(QJsonValue(QJsonValue::Undefined), m_paths.size());
+    m_error.clear();
+
+    const int count = _index_build(_index_dispatch().kernel, data, size, m_index);
+    Walker walker{ *this, m_paths, m_keys, data, size, m_index.constData(), count, values };
+    const int begin = walker.firstNonSpace(0);
+    if (count < 0)
+        walker.fail("string not closed", size);
+    else if (begin >= size || (data[begin] != '{' && data[begin] != '['))
+        walker.fail("document must be an object or an array", begin);
+    else {
+        const int next = walker.value(begin, 0, 0, m_all);
+        if (!walker.failed() && (next != count || walker.firstNonSpace(m_index[next - 1] + 1) != size))
+            walker.fail("garbage at the end of the document", next < count ? m_index[next] : size);
+    }
+
+    if (walker.failed()) {
+        values.fill(QJsonValue(QJsonValue::Undefined));
+        return false;
+    }
+    return true;
+}
+
+
+void _handleJsonAttribute_unittest_extractor()
+{
+    // every kernel of this CPU classifies the bytes like the scalar one
+    {
+        const char alphabet[] = "\"\\{}[]:, ab01\n\x80\xff";
+        QVector<_IndexKernel> kernels;
+#ifdef QJSONPATH_INDEX_SSE2
+        kernels.append(_index_sse2);
+#endif
+#ifdef QJSONPATH_INDEX_AVX2
+        if (_index_hasAvx2())
+            kernels.append(_index_avx2);
+#endif
+        quint32 random = 12345;
+        char block[64];
+        for (int round = 0; round < 1000; round++) {
+            for (char& c : block) {
+                random = random * 1103515245 + 12345;
+                c = alphabet[(random >> 16) % (sizeof(alphabet) - 1)];
+            }
+            _IndexMasks expected;
+            _index_scalar(block, expected);
+            for (const auto kernel : kernels) {
+                _IndexMasks masks;
+                kernel(block, masks);
+                Q_ASSERT(masks.quote == expected.quote && masks.backslash == expected.backslash && masks.op == expected.op);
+            }
+        }
+    }
+
+    // escapes and strings crossing the 64 byte blocks
+    {
+        for (int pad = 0; pad < 70; pad++) {
+            for (int backslashes = 1; backslashes <= 4; backslashes++) {
+                const QByteArray name(pad, 'x');
+                const QByteArray escapes(backslashes * 2, '\\'); // an even run is an escaped backslash
+                const QByteArray text = "{\"" + name + "\":\"" + name + escapes + "\\\",[{" + "\",\"k\":[1,\"]\"]}";
+                const auto doc = QJsonDocument::fromJson(text);
+                Q_ASSERT(doc.isObject());
+                QJsonPath::Extractor extractor({ QJsonPath::Compiled(QVariantList{ QString::fromUtf8(name) }), QJsonPath::Compiled("k[1]") });
+                const auto values = extractor.extract(text);
+                Q_ASSERT(values[0] == QJsonPath::get(doc, QVariantList{ QString::fromUtf8(name) }));
+                Q_ASSERT(values[1] == "]");
+            }
+        }
+    }
+
+    // differential test against get on the parsed document
+    const char* const documents[] = {
+        R"({"a":1,"b":[true,false,null],"c":{"d":"text","e":[]},"f":{}})",
+        R"([[1,[2,[3,[4]]]],{"x":-1.5e3,"y":0,"z":-0.25},"",[{"id":7},{"id":8,"tags":["p","q"]}]])",
+        R"( { "esc\"aped" : "quote\" and \\ and é and 😀" , "name" : { "v" : 12345678901, "w\\" : "\\" } } )",
+        R"({"ts":"2023-05-01T12:00:00Z","level":"info","msg":"request {done} [ok], \"quoted\": yes","request":{"id":"r-1","path":"/api/v1/items","headers":{"accept":"*/*"}},"latency_ms":12.5,"tags":["a","b","c"]})",
+        R"([])",
+        R"({"":{"":[0,{"":null}]}})",
+    };
+    for (const char* document : documents) {
+        const auto doc = QJsonDocument::fromJson(document);
+        Q_ASSERT(!doc.isNull());
+        QVector<QJsonPath::Compiled> paths;
+        QJsonPath::Compiled root;
+        _handleJsonAttribute_unittest_paths(doc.isArray() ? QJsonValue(doc.array()) : QJsonValue(doc.object()), root, paths);
+        QJsonPath::Extractor extractor(paths);
+        for (const auto& text : { QByteArray(document), doc.toJson(QJsonDocument::Indented) }) {
+            QVector<QJsonValue> values;
+            Q_ASSERT(extractor.extract(text, values));
+            for (int p = 0; p < paths.size(); p++)
+                Q_ASSERT(values[p] == QJsonPath::get(doc, paths[p]));
+        }
+    }
+
+    // a duplicate key replaces the earlier value, also below it
+    {
+        const QByteArray text = R"({"a":{"b":1},"a":{"c":2}})";
+        const auto doc = QJsonDocument::fromJson(text);
+        const auto values = QJsonPath::Extractor({ QJsonPath::Compiled("a/b"), QJsonPath::Compiled("a/c") }).extract(text);
+        Q_ASSERT(values[0] == QJsonPath::get(doc, "a/b") && values[1] == QJsonPath::get(doc, "a/c"));
+    }
+
+    // invalid structure on the paths, skipped values are not validated
+    for (const char* text : { R"({"a":1)", R"({"a" 1})", R"([1,])", R"([1}])", R"({"a":1}x)", R"("text")", R"(["abc)", R"({"a":})", R"({"a":1,})", R"([1]])" }) {
+        QJsonPath::Extractor extractor({ QJsonPath::Compiled("a"), QJsonPath::Compiled("[0]") });
+        QVector<QJsonValue> values;
+        Q_ASSERT_X(!extractor.extract(text, values) && !extractor.errorString().isEmpty(), __FUNCTION__, text);
+        Q_ASSERT(values.size() == 2 && values[0].isUndefined() && values[1].isUndefined());
+    }
+}
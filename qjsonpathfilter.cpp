@@ -0,0 +1,496 @@
+// MIT License Copyright (C) 2023 heksbeks https://github.com/heksbeks/qjsonpath
+
+#include "qjsonpath.h"
+#include "qjsonpath_p.h"
+
+
+// Recursive descent parser emitting the bytecode of a stack machine:
+//   or         := and ('||' and)*
+//   and        := unary ('&&' unary)*
+//   unary      := '!' unary | '(' or ')' | comparison
+//   comparison := operand (('==' | '!=' | '<' | '<=' | '>' | '>=') operand)?
+//   operand    := path | string | number | 'true' | 'false' | 'null'
+struct QJsonPath::Filter::Compiler
+{
+    Filter& filter;
+    const QString& text;
+    int pos = 0;
+    int depth = 0; // stack depth at the current instruction
+
+    bool failed() const { return !filter.m_error.isEmpty(); }
+
+    void fail(const QString& message)
+    {
+        if (!failed())
+            filter.m_error = QString("%1 at position %2").arg(message).arg(pos);
+    }
+
+    int add(OpCode op, int arg = 0)
+    {
+        filter.m_code.append({ op, arg });
+        if (op == PushPath || op == PushConst)
+            depth++;
+        else if (op >= Equal && op <= GreaterEqual)
+            depth--;
+        else if (op == Pop)
+            depth--;
+        if (depth > MaxStack)
+            fail("expression too complex");
+        return int(filter.m_code.size()) - 1;
+    }
+
+    void skipSpace()
+    {
+        while (pos < text.size() && text[pos].isSpace())
+            pos++;
+    }
+
+    bool accept(const char* token)
+    {
+        skipSpace();
+        if (!QStringView(text).mid(pos).startsWith(QLatin1String(token)))
+            return false;
+        pos += int(qstrlen(token));
+        return true;
+    }
+
+    // characters ending a name after '.' in a path or a keyword
+    static bool isNameEnd(QChar c)
+    {
+        static const QString operators = QStringLiteral(".[]()=!<>&|'\"");
+        return c.isSpace() || operators.contains(c);
+    }
+
+    void parseOr()
+    {
+        parseAnd();
+        while (!failed() && accept("||")) {
+            const int jump = add(JumpIfTrue);
+            add(Pop);
+            parseAnd();
+            filter.m_code[jump].arg = int(filter.m_code.size());
+        }
+    }
+
+    void parseAnd()
+    {
+        parseUnary();
+        while (!failed() && accept("&&")) {
+            const int jump = add(JumpIfFalse);
+            add(Pop);
+            parseUnary();
+            filter.m_code[jump].arg = int(filter.m_code.size());
+        }
+    }
+
+    void parseUnary()
+    {
+        skipSpace();
+        if (QStringView(text).mid(pos).startsWith(QLatin1String("!=")))
+            fail("unexpected operator");
+        else if (accept("!")) {
+            parseUnary();
+            add(Not);
+        }
+        else if (accept("(")) {
+            parseOr();
+            if (!failed() && !accept(")"))
+                fail("missing ')'");
+        }
+        else
+            parseComparison();
+    }
+
+    void parseComparison()
+    {
+        parseOperand();
+        if (failed())
+            return;
+
+        static const struct { const char* token; OpCode op; } operators[] = {
+            { "==", Equal }, { "!=", NotEqual }, { "<=", LessEqual }, { ">=", GreaterEqual }, { "<", Less }, { ">", Greater },
+        };
+        for (const auto& o : operators) {
+            if (accept(o.token)) {
+                parseOperand();
+                add(o.op);
+                return;
+            }
+        }
+
+        // an operand without comparison: a path tests if the attribute exists, a literal is a constant condition
+        auto& last = filter.m_code.last();
+        if (last.op == PushConst) {
+            const auto c = filter.m_constants[last.arg];
+            filter.m_constants[last.arg] = c.isBool() ? c.toBool() : !c.isNull();
+        }
+        else
+            add(Exists);
+    }
+
+    void parseOperand()
+    {
+        skipSpace();
+        if (pos >= text.size()) {
+            fail("missing operand");
+            return;
+        }
+
+        const QChar c = text[pos];
+        if (c == QChar('@')) {
+            pos++;
+            Compiled path;
+            parsePath(path);
+            filter.m_paths.append(path);
+            add(PushPath, int(filter.m_paths.size()) - 1);
+        }
+        else if (c == QChar('"') || c == QChar('\'')) {
+            const auto s = parseString();
+            filter.m_constants.append(s);
+            add(PushConst, int(filter.m_constants.size()) - 1);
+        }
+        else if (c.isDigit() || c == QChar('-') || c == QChar('+')) {
+            const int start = pos;
+            while (pos < text.size() && (text[pos].isDigit() || QString::fromLatin1("+-.eE").contains(text[pos])))
+                pos++;
+            bool ok;
+            const double d = text.mid(start, pos - start).toDouble(&ok);
+            if (!ok) {
+                pos = start;
+                fail("invalid number");
+                return;
+            }
+            filter.m_constants.append(d);
+            add(PushConst, int(filter.m_constants.size()) - 1);
+        }
+        else {
+            static const struct { const char* token; QJsonValue::Type type; } keywords[] = {
+                { "true", QJsonValue::Bool }, { "false", QJsonValue::Bool }, { "null", QJsonValue::Null },
+            };
+            for (const auto& k : keywords) {
+                const int len = int(qstrlen(k.token));
+                if (QStringView(text).mid(pos).startsWith(QLatin1String(k.token)) && (pos + len >= text.size() || isNameEnd(text[pos + len]))) {
+                    pos += len;
+                    filter.m_constants.append(k.type == QJsonValue::Bool ? QJsonValue(k.token[0] == 't') : QJsonValue());
+                    add(PushConst, int(filter.m_constants.size()) - 1);
+                    return;
+                }
+            }
+            fail("expected operand");
+        }
+    }
+
+    // relative path after @: .name, ['name'], ["name"] or [index]
+    void parsePath(Compiled& path)
+    {
+        while (pos < text.size() && !failed()) {
+            if (text[pos] == QChar('.')) {
+                const int start = ++pos;
+                while (pos < text.size() && !isNameEnd(text[pos]))
+                    pos++;
+                if (pos == start)
+                    fail("missing name");
+                path.append(text.mid(start, pos - start));
+            }
+            else if (text[pos] == QChar('[')) {
+                pos++;
+                skipSpace();
+                if (pos < text.size() && (text[pos] == QChar('"') || text[pos] == QChar('\'')))
+                    path.append(parseString());
+                else {
+                    const int start = pos;
+                    while (pos < text.size() && text[pos] != QChar(']'))
+                        pos++;
+                    bool ok;
+                    const int idx = text.mid(start, pos - start).trimmed().toInt(&ok);
+                    if (!ok) {
+                        pos = start;
+                        fail("invalid index");
+                    }
+                    path.append(idx);
+                }
+                if (!failed() && !accept("]"))
+                    fail("missing ']'");
+            }
+            else
+                break;
+        }
+    }
+
+    QString parseString()
+    {
+        const QChar quote = text[pos++];
+        QString s;
+        while (pos < text.size() && text[pos] != quote) {
+            QChar c = text[pos++];
+            if (c == QChar('\\') && pos < text.size()) {
+                c = text[pos++];
+                if (c == QChar('n'))
+                    c = QChar('\n');
+                else if (c == QChar('t'))
+                    c = QChar('\t');
+                else if (c == QChar('u')) {
+                    // exactly 4 hex digits
+                    ushort code = 0;
+                    for (int i = 0; i < 4; i++) {
+                        const char h = pos < text.size() ? text[pos].toLatin1() : '\0';
+                        const int digit = h >= '0' && h <= '9' ? h - '0' : h >= 'a' && h <= 'f' ? h - 'a' + 10 : h >= 'A' && h <= 'F' ? h - 'A' + 10 : -1;
+                        if (digit < 0) {
+                            fail("invalid escape");
+                            return s;
+                        }
+                        code = ushort(code * 16 + digit);
+                        pos++;
+                    }
+                    c = QChar(code);
+                }
+            }
+            s += c;
+        }
+        if (pos >= text.size())
+            fail("missing closing quote");
+        pos++;
+        return s;
+    }
+
+    void run()
+    {
+        skipSpace();
+        if (pos >= text.size()) {
+            fail("empty expression");
+            return;
+        }
+        parseOr();
+        skipSpace();
+        if (!failed() && pos < text.size())
+            fail("unexpected character");
+    }
+};
+
+
+QJsonPath::Filter::Filter(const QString& expression)
+{
+    Compiler{ *this, expression }.run();
+    if (!isValid()) {
+        m_code.clear();
+        m_constants.clear();
+        m_paths.clear();
+        return;
+    }
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    for (const auto& constant : qAsConst(m_constants))
+        m_stringConstants.append(constant.isString() ? QCborValue(constant.toString()) : QCborValue());
+    for (const auto& path : qAsConst(m_paths)) {
+        Compiled parent = path;
+        parent.truncate(qMax(0, path.size() - 1));
+        m_parents.append(parent);
+    }
+#endif
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+// a string operand as a QCborValue sharing the data of the document or of the constant, QJsonValue only
+// hands out strings as new QStrings. QCborMap and QCborArray share the container of a QJsonObject and
+// QJsonArray in Qt 6, QCborValue::compare() compares strings in place.
+QCborValue QJsonPath::Filter::stringOperand(const QJsonValue& value, int origin) const
+{
+    if (origin < 0)
+        return origin == NoOrigin ? QCborValue() : m_stringConstants[-1 - origin];
+    const auto& path = m_paths[origin];
+    const int last = path.size() - 1;
+    if (last < 0)
+        return QCborValue();
+    const QJsonValue parent = QJsonPath::get(value, m_parents[origin]);
+    if (path.type(last) == Compiled::Key && parent.isObject())
+        return QCborMap::fromJsonObject(parent.toObject()).value(path.key(last));
+    if (path.type(last) == Compiled::Index && parent.isArray()) {
+        const QJsonArray array = parent.toArray();
+        const int idx = path.index(last) < 0 ? int(array.size()) + path.index(last) : path.index(last);
+        return QCborArray::fromJsonArray(array).at(idx);
+    }
+    return QCborValue();
+}
+#endif
+
+bool QJsonPath::Filter::equal(const QJsonValue& value, const QJsonValue& a, int originA, const QJsonValue& b, int originB) const
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    if (a.isString() && b.isString()) {
+        const QCborValue x = stringOperand(value, originA), y = stringOperand(value, originB);
+        if (x.isString() && y.isString())
+            return x.compare(y) == 0;
+    }
+#else
+    Q_UNUSED(value) Q_UNUSED(originA) Q_UNUSED(originB)
+#endif
+    return a == b;
+}
+
+// orders numbers with numbers and strings with strings, returns false for values without an order
+static bool _handleJsonAttribute_filterOrder(const QJsonValue& a, const QJsonValue& b, int& cmp)
+{
+    if (a.isDouble() && b.isDouble()) {
+        const double x = a.toDouble(), y = b.toDouble();
+        if (x != x || y != y) // NaN
+            return false;
+        cmp = x < y ? -1 : (x > y ? 1 : 0);
+        return true;
+    }
+    if (a.isString() && b.isString()) {
+        cmp = a.toString().compare(b.toString());
+        return true;
+    }
+    return false;
+}
+
+bool QJsonPath::Filter::test(const QJsonValue& value) const
+{
+    if (!isValid())
+        return false;
+    if (m_code.isEmpty())
+        return true;
+
+    QJsonValue stack[MaxStack];
+    int origin[MaxStack]; // path index, -1 - constant index or NoOrigin, to compare strings in place
+    int sp = 0;
+    const int size = int(m_code.size());
+    for (int pc = 0; pc < size; pc++) {
+        const auto& ins = m_code[pc];
+        switch (ins.op) {
+        case PushPath:
+            origin[sp] = ins.arg;
+            stack[sp++] = QJsonPath::get(value, m_paths[ins.arg]);
+            break;
+        case PushConst:
+            origin[sp] = -1 - ins.arg;
+            stack[sp++] = m_constants[ins.arg];
+            break;
+        case Exists:
+            origin[sp - 1] = NoOrigin;
+            stack[sp - 1] = !stack[sp - 1].isUndefined();
+            break;
+        case Equal:
+        case NotEqual:
+            sp--;
+            stack[sp - 1] = equal(value, stack[sp - 1], origin[sp - 1], stack[sp], origin[sp]) == (ins.op == Equal);
+            origin[sp - 1] = NoOrigin;
+            break;
+        case Less:
+        case LessEqual:
+        case Greater:
+        case GreaterEqual: {
+            sp--;
+            int cmp = 0;
+            const bool ordered = _handleJsonAttribute_filterOrder(stack[sp - 1], stack[sp], cmp);
+            stack[sp - 1] = ordered && (ins.op == Less ? cmp < 0 : ins.op == LessEqual ? cmp <= 0 : ins.op == Greater ? cmp > 0 : cmp >= 0);
+            origin[sp - 1] = NoOrigin;
+            break;
+        }
+        case Not:
+            origin[sp - 1] = NoOrigin;
+            stack[sp - 1] = !stack[sp - 1].toBool();
+            break;
+        case JumpIfFalse:
+            if (!stack[sp - 1].toBool())
+                pc = ins.arg - 1;
+            break;
+        case JumpIfTrue:
+            if (stack[sp - 1].toBool())
+                pc = ins.arg - 1;
+            break;
+        case Pop:
+            sp--;
+            break;
+        }
+    }
+    return stack[0].toBool();
+}
+
+
+void _handleJsonAttribute_unittest_filter()
+{
+    const QJsonObject order{
+        {"status", "open"},
+        {"total", 150},
+        {"customer", QJsonObject{{"name", "x y"}, {"vip", false}}},
+        {"items", QJsonArray{1, 2}},
+        {"tags", QJsonArray{"a", "b"}},
+        {"note", QJsonValue()},
+        {"odd key", 1},
+    };
+    auto test = [&](const char* expression) {
+        const QJsonPath::Filter filter(expression);
+        Q_ASSERT(filter.isValid());
+        return filter.test(order);
+    };
+
+    // comparisons
+    Q_ASSERT(test("@.status == 'open'"));
+    Q_ASSERT(test("@.status == \"open\""));
+    Q_ASSERT(!test("@.status != 'open'"));
+    Q_ASSERT(test("@.total > 100") && test("@.total >= 150") && test("@.total <= 150.0") && !test("@.total < 150"));
+    Q_ASSERT(test("100 < @.total"));
+    Q_ASSERT(test("@.total == 1.5e2"));
+    Q_ASSERT(test("@.status > 'abc'"));
+    Q_ASSERT(!test("@.status > 1") && !test("@.status < 1")); // different types are not ordered
+    Q_ASSERT(test("@.customer.name == 'x y'"));
+    Q_ASSERT(test("@['odd key'] == 1"));
+    Q_ASSERT(test("@.items[-1] == 2") && test("@.items[ 0 ] == 1"));
+    Q_ASSERT(test("@.note == null") && !test("@.missing == null"));
+    Q_ASSERT(test("@.customer.vip == false"));
+    Q_ASSERT(test("@.status == '\\u006fpen'"));
+    Q_ASSERT(test("'open' == @.status") && test("@.status == @.status") && !test("@.status == @.customer.name"));
+    Q_ASSERT(test("@.tags[-1] == 'b'") && test("@.tags[0] != 'b'") && !test("@.tags[2] == 'b'"));
+    Q_ASSERT(!test("@.status == 'ope'") && !test("@.status == 'openx'") && test("@.status != 'Open'"));
+
+    // existence, logical operators and precedence
+    Q_ASSERT(test("@.note") && test("@.customer.vip") && !test("@.missing"));
+    Q_ASSERT(test("@") && test("!@.missing"));
+    Q_ASSERT(test("@.status == 'open' && @.total > 100"));
+    Q_ASSERT(!test("@.status == 'closed' && @.total > 100"));
+    Q_ASSERT(test("@.status == 'closed' || @.total > 100"));
+    Q_ASSERT(test("@.missing || @.status == 'closed' || @.note"));
+    Q_ASSERT(test("@.total < 100 && @.missing || @.items"));
+    Q_ASSERT(!test("@.total < 100 && (@.missing || @.items)"));
+    Q_ASSERT(test("!(@.total < 100) && !!@.items"));
+    Q_ASSERT(test("true") && !test("false") && !test("null"));
+
+    // syntax errors
+    for (const char* invalid : {"", "@.total >", "@.total > > 1", "(@.total", "@.items[x]", "@.status == 'open", "@. == 1", "@.a @.b", "!= 1", "truex", "@.note == '\\uZZZZ'", "@.note == '\\u12'"}) {
+        const QJsonPath::Filter filter(invalid);
+        Q_ASSERT(!filter.isValid() && !filter.errorString().isEmpty());
+        Q_ASSERT(!filter.test(order));
+    }
+    Q_ASSERT(QJsonPath::Filter().test(order));
+
+    // filters in queries select children of arrays and objects
+    const QJsonObject doc{
+        {"orders", QJsonArray{
+             QJsonObject{{"id", 1}, {"status", "open"}, {"total", 50}},
+             QJsonObject{{"id", 2}, {"status", "open"}, {"total", 150}},
+             QJsonObject{{"id", 3}, {"status", "closed"}, {"total", 250}},
+             QJsonObject{{"id", 4}, {"status", "open"}, {"total", 350}},
+         }},
+        {"stock", QJsonObject{{"a", QJsonObject{{"n", 0}}}, {"b", QJsonObject{{"n", 5}}}}},
+    };
+    auto ids = [&](const QString& query) {
+        QVariantList ids;
+        for (const auto& m : QJsonPath::Query(query).match(doc)) {
+            Q_ASSERT(QJsonPath::get(doc, m.path) == m.value);
+            ids.append(m.value.toInt());
+        }
+        return ids;
+    };
+    Q_ASSERT(ids("orders[?(@.status == \"open\" && @.total > 100)]/id") == QVariantList({2, 4}));
+    Q_ASSERT(ids("orders[?@.total > 100][0:1]").isEmpty());
+    Q_ASSERT(ids("orders[?(@.status == 'closed' || @.id == 1)]/id") == QVariantList({1, 3}));
+    Q_ASSERT(ids("orders[?(@.id == ']')]").isEmpty());
+    Q_ASSERT(ids("..[?(@.n > 0)]/n") == QVariantList({5}));
+    QJsonPath::setSeparator('.');
+    Q_ASSERT(ids("orders[?(@.total >= 250)].id") == QVariantList({3, 4}));
+    QJsonPath::setSeparator('/');
+
+    const QJsonPath::Query invalid("orders[?(@.total >)]");
+    Q_ASSERT(!invalid.isValid() && invalid.match(doc).toVector().isEmpty());
+    Q_ASSERT(QJsonPath::Query("orders[*]").isValid());
+}
@@ -0,0 +1,201 @@
+// MIT License Copyright (C) 2023 heksbeks https://github.com/heksbeks/qjsonpath
+
+#include "qjsonpath.h"
+#include "qjsonpath_p.h"
+#include <QJsonArray>
+#include <utility>
+
+
+// keys match by name, indexes and "[+]" always since they may count from either end, and a key matches an index
+// since a set converts the array to an object or the object to an array
+static bool _index_match(const QJsonPath::Compiled& a, int posA, const QJsonPath::Compiled& b, int posB)
+{
+    if (a.type(posA) == QJsonPath::Compiled::Key && b.type(posB) == QJsonPath::Compiled::Key)
+        return a.key(posA) == b.key(posB);
+    return a.type(posA) != QJsonPath::Compiled::Invalid && b.type(posB) != QJsonPath::Compiled::Invalid;
+}
+
+// the shorter path of a and b from their positions on is a prefix of the other one
+static bool _index_overlap(const QJsonPath::Compiled& a, int posA, const QJsonPath::Compiled& b, int posB)
+{
+    for (; posA < a.size() && posB < b.size(); posA++, posB++) {
+        if (!_index_match(a, posA, b, posB))
+            return false;
+    }
+    return true;
+}
+
+
+QJsonPath::Index::Index(QJsonValue root, const Compiled& arrayPath, const Compiled& keyPath)
+    : m_root(std::move(root))
+    , m_arrayPath(arrayPath)
+    , m_keyPath(keyPath)
+{
+}
+
+QJsonPath::Index::Index(const QJsonDocument& root, const Compiled& arrayPath, const Compiled& keyPath)
+    : Index(root.isArray() ? QJsonValue(root.array()) : QJsonValue(root.object()), arrayPath, keyPath)
+{
+}
+
+void QJsonPath::Index::set(const Compiled& path, QJsonValue newValue)
+{
+    if (m_valid && isAffectedBy(path))
+        m_valid = false;
+    QJsonPath::set(m_root, path, std::move(newValue));
+}
+
+void QJsonPath::Index::remove(const Compiled& path)
+{
+    if (m_valid && isAffectedBy(path))
+        m_valid = false;
+    QJsonPath::remove(m_root, path);
+}
+
+QJsonValue QJsonPath::Index::take(const Compiled& path)
+{
+    if (m_valid && isAffectedBy(path))
+        m_valid = false;
+    return QJsonPath::take(m_root, path);
+}
+
+QJsonValue QJsonPath::Index::takeRoot()
+{
+    m_valid = false;
+    return std::exchange(m_root, QJsonValue());
+}
+
+void QJsonPath::Index::setRoot(QJsonValue root)
+{
+    m_valid = false;
+    m_root = std::move(root);
+}
+
+bool QJsonPath::Index::isAffectedBy(const Compiled& path) const
+{
+    const int n = m_arrayPath.size();
+    // the array or one of its ancestors is replaced or removed
+    if (path.size() <= n)
+        return _index_overlap(path, 0, m_arrayPath, 0);
+    if (!_index_overlap(path, 0, m_arrayPath, 0))
+        return false;
+    // a key converts the array to an object, an element is set, padded or removed and the following ones move
+    if (path.type(n) != Compiled::Index || path.size() == n + 1)
+        return true;
+    // inside of an element only the key counts
+    return _index_overlap(path, n + 1, m_keyPath, 0);
+}
+
+void QJsonPath::Index::build()
+{
+    m_valid = true;
+    m_rebuilds++;
+    m_strings.clear();
+    m_numbers.clear();
+    const auto arr = QJsonPath::get(m_root, m_arrayPath).toArray();
+    for (int i = 0; i < arr.size(); i++) {
+        const auto key = QJsonPath::get(arr.at(i), m_keyPath);
+        if (key.isString()) {
+            if (!m_strings.contains(key.toString()))
+                m_strings.insert(key.toString(), i);
+        }
+        else if (key.isDouble()) {
+            if (!m_numbers.contains(key.toDouble()))
+                m_numbers.insert(key.toDouble(), i);
+        }
+    }
+}
+
+int QJsonPath::Index::find(const QJsonValue& key)
+{
+    if (!m_valid)
+        build();
+    if (key.isString())
+        return m_strings.value(key.toString(), -1);
+    if (key.isDouble())
+        return m_numbers.value(key.toDouble(), -1);
+    return -1;
+}
+
+QJsonValue QJsonPath::Index::get(const QJsonValue& key, const Compiled& subPath, const QJsonValue& defaultValue)
+{
+    const int pos = find(key);
+    if (pos < 0)
+        return defaultValue;
+    return QJsonPath::get(QJsonPath::get(m_root, m_arrayPath).toArray().at(pos), subPath, defaultValue);
+}
+
+void _handleJsonAttribute_unittest_index()
+{
+    QJsonArray users;
+    for (int i = 0; i < 100; i++)
+        users.append(QJsonObject{ { "id", i }, { "name", QString("user%1").arg(i) }, { "profile", QJsonObject{ { "email", QString("u%1@x").arg(i) } } } });
+    QJsonDocument doc(QJsonObject{ { "users", users }, { "other", 1 } });
+
+    QJsonPath::Index byId(doc, QJsonPath::Compiled("users"), QJsonPath::Compiled("id"));
+    QJsonPath::Index byEmail(doc, QJsonPath::Compiled("users"), QJsonPath::Compiled("profile/email"));
+    Q_ASSERT(!byId.isValid());
+    Q_ASSERT(byId.find(42) == 42 && byId.find(42.0) == 42 && byId.isValid() && byId.rebuilds() == 1);
+    Q_ASSERT(byId.find(100) == -1 && byId.find("42") == -1 && byId.find(QJsonValue()) == -1);
+    Q_ASSERT(byId.get(7, QJsonPath::Compiled("name")) == "user7");
+    Q_ASSERT(byId.get(700, QJsonPath::Compiled("name"), "none") == "none");
+    Q_ASSERT(byEmail.get("u9@x")["id"] == 9);
+
+    // the index owns its root, changes of the document or of another index do not reach it
+    QJsonPath::set(doc, "users[0]/id", 500);
+    Q_ASSERT(byId.isValid() && byId.find(0) == 0 && byId.find(500) == -1);
+    byEmail.set("users[0]/id", 600);
+    Q_ASSERT(byId.find(0) == 0 && byEmail.get("u0@x")["id"] == 600);
+
+    // changes of other attributes keep the index
+    byId.set("users[10]/name", "renamed");
+    byId.set("other", 2);
+    byEmail.remove("users[3]/profile");
+    Q_ASSERT(byId.isValid() && !byEmail.isValid());
+    Q_ASSERT(byId.get(10, QJsonPath::Compiled("name")) == "renamed" && byId.rebuilds() == 1);
+    Q_ASSERT(byEmail.find("u3@x") == -1 && byEmail.find("u4@x") == 4 && byEmail.rebuilds() == 2);
+
+    // a changed key, a removed element, an appended one and a replaced array rebuild it
+    byId.set("users[-1]/id", 1000);
+    Q_ASSERT(!byId.isValid() && byId.find(1000) == 99 && byId.find(99) == -1);
+    byId.remove("users[0]");
+    Q_ASSERT(byId.find(42) == 41 && byId.rebuilds() == 3);
+    byId.set("users[+]/id", 2000);
+    Q_ASSERT(!byId.isValid() && byId.find(2000) == 99 && byId.rebuilds() == 4);
+    Q_ASSERT(byId.take("users[0]")["id"] == 1 && byId.find(2) == 0 && byId.rebuilds() == 5);
+    byId.set("users", QJsonArray{ QJsonObject{ { "id", 5 } }, QJsonObject{ { "id", 5 } } });
+    Q_ASSERT(byId.find(5) == 0 && byId.rebuilds() == 6); // the first of equal keys
+    byId.set("users/x", 1); // the array becomes an object
+    Q_ASSERT(!byId.isValid() && byId.find(5) == -1);
+
+    // other changes go through takeRoot and setRoot, which invalidates the index
+    QJsonValue root = byId.takeRoot();
+    Q_ASSERT(!byId.isValid() && byId.root().isNull() && byId.find(5) == -1);
+    QJsonPath::Batch batch;
+    batch.set("users", QJsonArray{ QJsonObject{ { "id", 6 } } });
+    batch.apply(root);
+    byId.setRoot(std::move(root));
+    Q_ASSERT(!byId.isValid() && byId.find(6) == 0 && byId.root()["users"].toArray().size() == 1);
+
+    // indexes in the array path match any index, an empty key path indexes the elements themselves
+    QJsonObject groups{ { "groups", QJsonArray{ QJsonObject{ { "members", QJsonArray{ "a", "b", "c" } } } } } };
+    QJsonPath::Index members(groups, QJsonPath::Compiled("groups[-1]/members"), QJsonPath::Compiled());
+    Q_ASSERT(members.find("c") == 2 && members.find(2) == -1);
+    members.set("groups[0]/members[0]", "d");
+    Q_ASSERT(!members.isValid() && members.find("d") == 0);
+    Q_ASSERT(members.isAffectedBy(QJsonPath::Compiled("groups")) && members.isAffectedBy(QJsonPath::Compiled("groups[3]/members[1]/x")));
+    Q_ASSERT(!members.isAffectedBy(QJsonPath::Compiled("groups[3]/owner")) && !members.isAffectedBy(QJsonPath::Compiled("other")));
+    Q_ASSERT(byEmail.isAffectedBy(QJsonPath::Compiled("users[1]/profile")) && !byEmail.isAffectedBy(QJsonPath::Compiled("users[1]/profile/phone")));
+
+    // a key where the paths have an index or the reverse replaces the container on the path
+    Q_ASSERT(members.isAffectedBy(QJsonPath::Compiled("groups/x")) && byEmail.isAffectedBy(QJsonPath::Compiled("users[3]/profile[0]")));
+    Q_ASSERT(byEmail.isValid());
+    byEmail.set("users[4]/profile[0]", "x");
+    Q_ASSERT(!byEmail.isValid() && byEmail.find("u4@x") == -1 && byEmail.find("u5@x") == 5);
+    Q_ASSERT(members.isValid());
+    members.set("groups/x", 1);
+    Q_ASSERT(!members.isValid() && members.find("d") == -1);
+
+    members.invalidate();
+    Q_ASSERT(!members.isValid());
+}
@@ -0,0 +1,359 @@
+// MIT License Copyright (C) 2023 heksbeks https://github.com/heksbeks/qjsonpath
+
+#include "qjsonpath.h"
+#include "qjsonpath_p.h"
+#include <QFile>
+#include <climits>
+#include <cstring>
+
+static bool _lazy_isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// FNV-1a of the UTF-8 bytes of a key, never 0 so an empty table entry is 0
+static quint32 _lazy_hash(const char* data, int size)
+{
+    quint32 hash = 2166136261u;
+    for (int i = 0; i < size; i++)
+        hash = (hash ^ uchar(data[i])) * 16777619u;
+    return hash ? hash : 1;
+}
+
+QJsonPath::LazyDocument::LazyDocument()
+{
+}
+
+QJsonPath::LazyDocument::LazyDocument(const QByteArray& json)
+{
+    setData(json);
+}
+
+QJsonPath::LazyDocument::~LazyDocument()
+{
+}
+
+bool QJsonPath::LazyDocument::open(const QString& fileName)
+{
+    close();
+    m_file.reset(new QFile(fileName));
+    if (!m_file->open(QIODevice::ReadOnly)) {
+        m_error = m_file->errorString();
+        m_file.reset();
+        return false;
+    }
+    const qint64 size = m_file->size();
+    const char* data = size ? reinterpret_cast<const char*>(m_file->map(0, size)) : nullptr;
+    if (!data) { // not mappable, e.g. a pipe
+        m_bytes = m_file->readAll();
+        m_file.reset();
+        return setText(m_bytes.constData(), m_bytes.size());
+    }
+    return setText(data, size);
+}
+
+bool QJsonPath::LazyDocument::setData(const QByteArray& json)
+{
+    close();
+    m_bytes = json;
+    return setText(m_bytes.constData(), m_bytes.size());
+}
+
+void QJsonPath::LazyDocument::close()
+{
+    m_file.reset(); // unmaps the file
+    m_bytes.clear();
+    m_data = nullptr;
+    m_size = 0;
+    m_root = 0;
+    m_containers.clear();
+    m_error.clear();
+}
+
+bool QJsonPath::LazyDocument::setText(const char* data, qint64 size)
+{
+    qint64 root = 0;
+    while (root < size && _lazy_isSpace(data[root]))
+        root++;
+    if (root >= size || (data[root] != '{' && data[root] != '[')) {
+        close();
+        m_error = QString("document must be an object or an array at offset %1").arg(root);
+        return false;
+    }
+    m_data = data;
+    m_size = size;
+    m_root = root;
+    return true;
+}
+
+void QJsonPath::LazyDocument::fail(const QString& message, qint64 pos) const
+{
+    m_error = QString("%1 at offset %2").arg(message).arg(pos);
+}
+
+// scans the container opening at begin once and records the text of its children, nested containers are skipped by counting brackets
+const QJsonPath::LazyDocument::Container* QJsonPath::LazyDocument::container(qint64 begin) const
+{
+    const auto found = m_containers.constFind(begin);
+    if (found != m_containers.constEnd())
+        return &found.value();
+
+    const char* data = m_data;
+    const bool array = data[begin] == '[';
+    auto firstNonSpace = [&](qint64 pos) {
+        while (pos < m_size && _lazy_isSpace(data[pos]))
+            pos++;
+        return pos;
+    };
+    auto trimmedEnd = [&](qint64 pos) {
+        while (pos > begin && _lazy_isSpace(data[pos - 1]))
+            pos--;
+        return pos;
+    };
+
+    Container container;
+    enum { Key, Colon, Value } expected = array ? Value : Key;
+    qint64 keyBegin = -1;                    // opening quote of the current key
+    qint64 keyEnd = -1;                      // closing quote of the current key
+    qint64 value = firstNonSpace(begin + 1); // text of the current child
+    int depth = 0;
+    _JsonScanner scanner(data, m_size, begin + 1);
+    for (;;) {
+        const qint64 pos = scanner.next();
+        if (pos < 0) {
+            fail(scanner.inString() ? "string not closed" : "container not closed", m_size);
+            return nullptr;
+        }
+        const char c = data[pos];
+        if (depth) {
+            if (c == '{' || c == '[')
+                depth++;
+            else if (c == '}' || c == ']')
+                depth--;
+            continue;
+        }
+        switch (c) {
+        case '"':
+            if (expected == Key) {
+                keyBegin = pos;
+                expected = Colon;
+            }
+            else if (expected == Colon) {
+                fail("expected colon", pos);
+                return nullptr;
+            }
+            break;
+        case ':':
+            keyEnd = trimmedEnd(pos) - 1;
+            if (expected != Colon || keyEnd <= keyBegin || data[keyEnd] != '"') {
+                fail("expected key", pos);
+                return nullptr;
+            }
+            value = firstNonSpace(pos + 1);
+            expected = Value;
+            break;
+        case '{':
+        case '[':
+            if (expected != Value) {
+                fail("expected key", pos);
+                return nullptr;
+            }
+            depth++;
+            break;
+        case ',':
+        case '}':
+        case ']': {
+            const bool close = c != ',';
+            if (close && (c == ']') != array) {
+                fail("mismatched bracket", pos);
+                return nullptr;
+            }
+            const qint64 end = trimmedEnd(pos);
+            const bool empty = close && container.begins.isEmpty() && (array ? end == begin + 1 : expected == Key);
+            if (!empty) {
+                if (expected != Value || end <= value) {
+                    fail("expected value", pos);
+                    return nullptr;
+                }
+                if (!array) {
+                    container.keys.append(keyBegin);
+                    container.keySizes.append(int(keyEnd - keyBegin - 1));
+                }
+                container.begins.append(value);
+                container.ends.append(end);
+            }
+            if (close) {
+                container.end = pos + 1;
+                if (!array) {
+                    // keys are hashed as raw text, only keys with escapes are decoded
+                    int tableSize = 4;
+                    while (tableSize < 2 * container.keys.size())
+                        tableSize *= 2;
+                    container.table.fill(0, tableSize);
+                    for (int child = 0; child < container.keys.size(); child++) {
+                        const auto name = key(container, child);
+                        const quint32 hash = _lazy_hash(name.constData(), int(name.size()));
+                        for (int slot = int(hash & quint32(tableSize - 1));; slot = (slot + 1) & (tableSize - 1)) {
+                            auto& entry = container.table[slot];
+                            if (!entry || (quint32(entry >> 32) == hash && key(container, int(quint32(entry)) - 1) == name)) {
+                                entry = quint64(hash) << 32 | quint32(child + 1); // a repeated key replaces the earlier one
+                                break;
+                            }
+                        }
+                    }
+                }
+                return &m_containers.insert(begin, container).value();
+            }
+            expected = array ? Value : Key;
+            value = firstNonSpace(pos + 1);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+// UTF-8 text of the key of a child, escapes resolved
+QByteArray QJsonPath::LazyDocument::key(const Container& container, int child) const
+{
+    const char* text = m_data + container.keys[child] + 1;
+    const int size = container.keySizes[child];
+    if (!std::memchr(text, '\\', size_t(size)))
+        return QByteArray::fromRawData(text, size);
+    return _handleJsonAttribute_decode(text - 1, size + 2, m_buffer).toString().toUtf8();
+}
+
+// child with the UTF-8 key, -1 if the object has no such key
+int QJsonPath::LazyDocument::find(const Container& container, const QByteArray& key) const
+{
+    const quint32 hash = _lazy_hash(key.constData(), int(key.size()));
+    const int mask = int(container.table.size()) - 1;
+    for (int slot = int(hash & quint32(mask));; slot = (slot + 1) & mask) {
+        const quint64 entry = container.table[slot];
+        if (!entry)
+            return -1;
+        const int child = int(quint32(entry)) - 1;
+        if (quint32(entry >> 32) == hash && this->key(container, child) == key)
+            return child;
+    }
+}
+
+QJsonValue QJsonPath::LazyDocument::get(const Compiled& path, const QJsonValue& defaultValue) const
+{
+    if (!m_data)
+        return defaultValue;
+    qint64 begin = m_root;
+    qint64 end = -1; // unknown for the root until it is scanned
+    for (int i = 0; i < path.size(); i++) {
+        const char c = m_data[begin];
+        if (c != (path.type(i) == Compiled::Key ? '{' : path.type(i) == Compiled::Index ? '[' : '\0'))
+            return defaultValue;
+        const Container* node = container(begin);
+        if (!node)
+            return defaultValue;
+        if (end >= 0 && node->end != end) {
+            fail("garbage after value", node->end);
+            return defaultValue;
+        }
+        int child;
+        if (path.type(i) == Compiled::Key)
+            child = find(*node, path.key(i).toUtf8());
+        else {
+            child = path.index(i);
+            if (child < 0)
+                child += int(node->begins.size());
+            if (child >= node->begins.size())
+                child = -1;
+        }
+        if (child < 0)
+            return defaultValue;
+        begin = node->begins[child];
+        end = node->ends[child];
+    }
+    if (end < 0) {
+        const Container* root = container(m_root);
+        if (!root)
+            return defaultValue;
+        end = root->end;
+    }
+    if (end - begin > INT_MAX) {
+        fail("value too large", begin);
+        return defaultValue;
+    }
+    const auto value = _handleJsonAttribute_decode(m_data + begin, int(end - begin), m_buffer);
+    if (value.isUndefined()) {
+        fail("invalid value", begin);
+        return defaultValue;
+    }
+    return value;
+}
+
+QJsonValue QJsonPath::get(const LazyDocument& root, const QVariantList& path, const QJsonValue& defaultValue)
+{
+    return root.get(Compiled(path, Compiled::Temporary()), defaultValue);
+}
+
+
+void _handleJsonAttribute_unittest_lazy()
+{
+    // differential test against get on the parsed document, the text is the same as the extractor test uses
+    const char* const documents[] = {
+        R"({"a":1,"b":[true,false,null],"c":{"d":"text","e":[]},"f":{}})",
+        R"([[1,[2,[3,[4]]]],{"x":-1.5e3,"y":0,"z":-0.25},"",[{"id":7},{"id":8,"tags":["p","q"]}]])",
+        R"( { "esc\"aped" : "quote\" and \\ and é and 😀" , "name" : { "v" : 12345678901, "w\\" : "\\" } } )",
+        R"({"ts":"2023-05-01T12:00:00Z","level":"info","msg":"request {done} [ok], \"quoted\": yes","request":{"id":"r-1","path":"/api/v1/items","headers":{"accept":"*/*"}},"latency_ms":12.5,"tags":["a","b","c"]})",
+        R"([])",
+        R"({"":{"":[0,{"":null}]}})",
+        R"({"a":{"b":1},"a":{"c":2}})",
+    };
+    for (const char* document : documents) {
+        const auto doc = QJsonDocument::fromJson(document);
+        Q_ASSERT(!doc.isNull());
+        QVector<QJsonPath::Compiled> paths;
+        QJsonPath::Compiled root;
+        _handleJsonAttribute_unittest_paths(doc.isArray() ? QJsonValue(doc.array()) : QJsonValue(doc.object()), root, paths);
+        paths.append(QJsonPath::Compiled());
+        for (const auto& text : { QByteArray(document), doc.toJson(QJsonDocument::Indented) }) {
+            const QJsonPath::LazyDocument lazy(text);
+            Q_ASSERT(lazy.isObject() == doc.isObject() && lazy.isArray() == doc.isArray());
+            for (const auto& path : paths)
+                Q_ASSERT(lazy.get(path) == QJsonPath::get(doc, path));
+            Q_ASSERT(lazy.errorString().isEmpty());
+        }
+    }
+    {
+        const QJsonPath::LazyDocument lazy(QByteArray(R"({"a":{"b":[1,2,3]}})"));
+        Q_ASSERT(QJsonPath::get(lazy, "a/b[-1]") == 3);
+        Q_ASSERT(QJsonPath::get(lazy, QVariantList{ "a", "b", 0 }) == 1);
+        Q_ASSERT(QJsonPath::get(lazy, "a/x", 5) == 5);
+    }
+
+    // only the containers on the path are scanned, the others are skipped
+    {
+        QJsonObject items;
+        for (int i = 0; i < 100; i++)
+            items[QString("item%1").arg(i)] = QJsonObject{ { "tags", QJsonArray{ i, QJsonObject{ { "x", i } } } } };
+        const QJsonPath::LazyDocument lazy(QJsonDocument(QJsonObject{ { "items", items } }).toJson());
+        Q_ASSERT(lazy.containerCount() == 0);
+        Q_ASSERT(QJsonPath::get(lazy, "items/item42/tags[1]/x") == 42);
+        Q_ASSERT(lazy.containerCount() == 5);
+        Q_ASSERT(QJsonPath::get(lazy, "items/item7/tags[0]") == 7);
+        Q_ASSERT(lazy.containerCount() == 7);
+        Q_ASSERT(QJsonPath::get(lazy, "items/item42/tags[1]/x") == 42);
+        Q_ASSERT(lazy.containerCount() == 7);
+    }
+
+    // invalid text on the path is reported, invalid text elsewhere is not looked at
+    for (const char* text : { R"({"a":1)", R"({"a" 1})", R"({"a":[1,]})", R"({"a":[1}})", R"({"a":})", R"({"a":1,})", R"({"a":"x)", R"({"a":[1] 2})", R"({"a":tru})" }) {
+        const QJsonPath::LazyDocument lazy{ QByteArray(text) };
+        Q_ASSERT_X(lazy.get(QJsonPath::Compiled("a[0]"), 0) == 0 && lazy.get(QJsonPath::Compiled("a"), 0) == 0 && !lazy.errorString().isEmpty(), __FUNCTION__, text);
+    }
+    {
+        const QJsonPath::LazyDocument lazy(QByteArray(R"({"a":1,"b":[1,})"));
+        Q_ASSERT(QJsonPath::get(lazy, "a").isUndefined()); // the root is not closed
+        const QJsonPath::LazyDocument skipped(QByteArray(R"({"a":1,"b":[1,,tru]})"));
+        Q_ASSERT(QJsonPath::get(skipped, "a") == 1);
+        Q_ASSERT(QJsonPath::LazyDocument(QByteArray("\"text\"")).isNull());
+    }
+}
@@ -0,0 +1,215 @@
+// MIT License Copyright (C) 2023 heksbeks https://github.com/heksbeks/qjsonpath
+
+#include "qjsonpath.h"
+#include "qjsonpath_p.h"
+#include <QJsonArray>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <cmath>
+
+
+// ranges of a run, taken one after another by the calling thread and the workers
+struct _ParallelRun
+{
+    _ParallelRun(const std::function<void(int range, int begin, int end)>& work, int size, int ranges) : work(work), size(size), ranges(ranges) {}
+
+    const std::function<void(int range, int begin, int end)>& work;
+    const int size;
+    const int ranges;
+    std::atomic<int> next{ 0 };
+    QSemaphore finished;
+
+    void take()
+    {
+        const int rangeSize = (size + ranges - 1) / ranges;
+        for (int range = next++; range < ranges; range = next++)
+            work(range, range * rangeSize, qMin(size, (range + 1) * rangeSize));
+    }
+};
+
+class _ParallelWorker : public QRunnable
+{
+public:
+    explicit _ParallelWorker(_ParallelRun& run) : m_run(run) {}
+    void run() override
+    {
+        m_run.take();
+        m_run.finished.release();
+    }
+
+private:
+    _ParallelRun& m_run;
+};
+
+
+void QJsonPath::ParallelQuery::Reduction::add(const QJsonValue& value)
+{
+    if (!value.isDouble()) {
+        others++;
+        return;
+    }
+    const double d = value.toDouble();
+    count++;
+    sum += d;
+    min = qMin(min, d);
+    max = qMax(max, d);
+}
+
+void QJsonPath::ParallelQuery::Reduction::add(const Reduction& other)
+{
+    count += other.count;
+    others += other.others;
+    sum += other.sum;
+    min = qMin(min, other.min);
+    max = qMax(max, other.max);
+}
+
+QJsonPath::ParallelQuery::ParallelQuery(const Compiled& arrayPath, const Compiled& elementPath)
+    : m_arrayPath(arrayPath)
+    , m_elementPath(elementPath)
+{
+}
+
+QJsonPath::ParallelQuery::ParallelQuery(const QString& path)
+{
+    const QString wildcard("[*]");
+    const int pos = path.indexOf(wildcard);
+    m_valid = pos >= 0 && path.indexOf(wildcard, pos + 1) < 0;
+    if (!m_valid)
+        return;
+    if (pos > 0) // "[*]" at the start is the root array, the empty path
+        m_arrayPath = Compiled(path.left(pos));
+    QString elementPath = path.mid(pos + wildcard.size());
+    if (elementPath.startsWith(separator()))
+        elementPath.remove(0, 1);
+    if (!elementPath.isEmpty())
+        m_elementPath = Compiled(elementPath);
+}
+
+// the ranges depend on the size and the minimum range only, not on the threads, so reduce adds up the same partial sums on
+// every machine; many ranges balance elements of different cost, the limit bounds the partial results of tiny minimum ranges
+static const int _parallel_maximumRanges = 1024;
+
+int QJsonPath::ParallelQuery::rangeCount(int size) const
+{
+    return qBound(1, size / m_minimumRange, _parallel_maximumRanges);
+}
+
+void QJsonPath::ParallelQuery::run(int size, int ranges, const std::function<void(int range, int begin, int end)>& work) const
+{
+    _ParallelRun run(work, size, ranges);
+    const int threads = qMin(ranges, m_threads > 0 ? m_threads : QThread::idealThreadCount());
+    // only workers that start now help, a busy pool never blocks the run since this thread takes the remaining ranges
+    int started = 0;
+    for (int t = 1; t < threads; t++) {
+        auto worker = new _ParallelWorker(run);
+        if (!QThreadPool::globalInstance()->tryStart(worker)) {
+            delete worker;
+            break;
+        }
+        started++;
+    }
+    run.take();
+    run.finished.acquire(started);
+}
+
+QVector<QJsonValue> QJsonPath::ParallelQuery::collect(const QJsonValue& root) const
+{
+    const auto arr = QJsonPath::get(root, m_arrayPath).toArray();
+    QVector<QJsonValue> values(arr.size());
+    QJsonValue* data = values.data(); // detached here, the workers write disjoint ranges
+    run(int(arr.size()), rangeCount(int(arr.size())), [&](int, int begin, int end) {
+        for (int i = begin; i < end; i++)
+            data[i] = m_elementPath.isEmpty() ? arr.at(i) : QJsonPath::get(arr.at(i), m_elementPath);
+    });
+    return values;
+}
+
+QVector<QJsonValue> QJsonPath::ParallelQuery::collect(const QJsonDocument& root) const
+{
+    if (root.isArray())
+        return collect(QJsonValue(root.array()));
+    return collect(QJsonValue(root.object()));
+}
+
+QJsonPath::ParallelQuery::Reduction QJsonPath::ParallelQuery::reduce(const QJsonValue& root) const
+{
+    const auto arr = QJsonPath::get(root, m_arrayPath).toArray();
+    const int ranges = rangeCount(int(arr.size()));
+    QVector<Reduction> partial(ranges);
+    Reduction* data = partial.data();
+    run(int(arr.size()), ranges, [&](int range, int begin, int end) {
+        Reduction r; // on the stack, partial results of neighbouring ranges share cache lines
+        for (int i = begin; i < end; i++)
+            r.add(m_elementPath.isEmpty() ? arr.at(i) : QJsonPath::get(arr.at(i), m_elementPath));
+        data[range] = r;
+    });
+    // combined in the order of the ranges, so the sum does not depend on the timing of the threads
+    Reduction result;
+    for (const auto& r : partial)
+        result.add(r);
+    return result;
+}
+
+QJsonPath::ParallelQuery::Reduction QJsonPath::ParallelQuery::reduce(const QJsonDocument& root) const
+{
+    if (root.isArray())
+        return reduce(QJsonValue(root.array()));
+    return reduce(QJsonValue(root.object()));
+}
+
+
+void _handleJsonAttribute_unittest_parallel()
+{
+    QJsonArray samples;
+    for (int i = 0; i < 10000; i++)
+        samples.append(i % 100 == 7 ? QJsonValue(QJsonObject{ { "t", i } }) : QJsonValue(QJsonObject{ { "t", i }, { "value", i % 1000 - 500 } }));
+    const QJsonObject doc{ { "samples", samples } };
+
+    for (int threads : { 1, 3, 8 }) {
+        QJsonPath::ParallelQuery query("samples[*]/value");
+        Q_ASSERT(query.isValid());
+        query.setThreadCount(threads);
+        query.setMinimumRange(100); // several ranges for 10000 elements
+        const auto values = query.collect(doc);
+        Q_ASSERT(values.size() == samples.size());
+        for (int i = 0; i < values.size(); i++)
+            Q_ASSERT(values[i] == QJsonPath::get(doc, QVariantList{ "samples", i, "value" }));
+
+        const auto stats = query.reduce(QJsonDocument(doc));
+        Q_ASSERT(stats.count == 9900 && stats.others == 100 && stats.min == -500 && stats.max == 499);
+        double sum = 0;
+        for (const auto& value : values)
+            sum += value.toDouble();
+        Q_ASSERT(stats.sum == sum && std::abs(stats.mean() - sum / 9900) < 1e-9);
+    }
+
+    // the same sums of fractions on any number of threads, the ranges do not depend on them
+    {
+        QJsonArray fractions;
+        for (int i = 0; i < 10000; i++)
+            fractions.append(QJsonObject{ { "value", 1.0 / (i + 3) } });
+        QJsonPath::ParallelQuery query("[*]/value"); // the root array
+        query.setMinimumRange(100);
+        query.setThreadCount(1);
+        const auto single = query.reduce(fractions);
+        Q_ASSERT(single.count == 10000 && query.collect(QJsonDocument(fractions)).size() == 10000);
+        for (int threads : { 2, 3, 8 }) {
+            query.setThreadCount(threads);
+            const auto stats = query.reduce(QJsonDocument(fractions));
+            Q_ASSERT(stats.count == single.count && stats.sum == single.sum && stats.min == single.min && stats.max == single.max);
+        }
+        Q_ASSERT(QJsonPath::ParallelQuery("[*]").collect(QJsonArray{ 1, "x" }) == QVector<QJsonValue>({ 1, "x" }));
+    }
+
+    // elements themselves, a nested array path, a missing array and paths without exactly one wildcard
+    QJsonPath::ParallelQuery elements(QJsonPath::Compiled("a[0]"), QJsonPath::Compiled());
+    const QJsonObject nested{ { "a", QJsonArray{ QJsonArray{ 1, "x", 3 } } } };
+    Q_ASSERT(elements.collect(nested) == QVector<QJsonValue>({ 1, "x", 3 }));
+    Q_ASSERT(QJsonPath::ParallelQuery("a[0][*]").collect(nested) == QVector<QJsonValue>({ 1, "x", 3 }));
+    Q_ASSERT(QJsonPath::ParallelQuery("a[0][*]").reduce(nested).sum == 4);
+    Q_ASSERT(QJsonPath::ParallelQuery("b[*]/v").collect(nested).isEmpty() && QJsonPath::ParallelQuery("b[*]").reduce(nested).count == 0);
+    Q_ASSERT(std::isnan(QJsonPath::ParallelQuery::Reduction().mean()));
+    Q_ASSERT(!QJsonPath::ParallelQuery("a").isValid() && !QJsonPath::ParallelQuery("a[*]/b[*]").isValid());
+}
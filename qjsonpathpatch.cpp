@@ -0,0 +1,591 @@
+// MIT License Copyright (C) 2023 heksbeks https://github.com/heksbeks/qjsonpath
+
+#include "qjsonpath.h"
+#include "qjsonpath_p.h"
+#include <QJsonArray>
+#include <algorithm>
+
+
+// an operation of a change, planned on the root before the change is made
+struct QJsonPath::Journal::Change
+{
+    QString op;
+    Compiled path;   // indexes resolved, to read a value created by the change
+    QString pointer;
+    QJsonValue value;
+    bool readAfter;  // the value is read from the root after the change
+};
+
+static QJsonValue _patch_value(const QJsonDocument& doc)
+{
+    if (doc.isArray())
+        return doc.array();
+    return doc.object();
+}
+
+// RFC 6901: '~' is written as "~0" and '/' as "~1"
+static QString _patch_escape(const QString& key)
+{
+    if (!key.contains(QChar('~')) && !key.contains(QChar('/')))
+        return key;
+    QString escaped = key;
+    escaped.replace(QChar('~'), QLatin1String("~0"));
+    escaped.replace(QChar('/'), QLatin1String("~1"));
+    return escaped;
+}
+
+static QString _patch_unescape(QString token)
+{
+    token.replace(QLatin1String("~1"), QLatin1String("/"));
+    token.replace(QLatin1String("~0"), QLatin1String("~"));
+    return token;
+}
+
+
+// Follows the path the same way as the mutation engine, but read only, and lists the operations the change will make.
+// Nothing is kept referenced, so the change itself still modifies the containers inplace.
+QVector<QJsonPath::Journal::Change> QJsonPath::Journal::record(const QJsonValue& root, const Compiled& path, const QJsonValue& newValue, bool remove) const
+{
+    QVector<Change> changes;
+    Compiled resolved;
+    QString pointer;
+    QJsonValue value = root;
+    for (int pos = 0; pos < path.size(); pos++) {
+        const bool last = pos + 1 == path.size();
+        if (path.type(pos) == Compiled::Key) {
+            if (!value.isObject()) {
+                if (!remove) // the value is replaced by an object
+                    changes.append({ QStringLiteral("replace"), resolved, pointer, QJsonValue(), true });
+                break;
+            }
+            const auto obj = value.toObject();
+            const auto it = obj.constFind(path.key(pos));
+            resolved.append(path.key(pos));
+            pointer += QChar('/') + _patch_escape(path.key(pos));
+            if (it == obj.constEnd()) {
+                if (!remove)
+                    changes.append({ QStringLiteral("add"), resolved, pointer, newValue, !last });
+                break;
+            }
+            if (last) {
+                changes.append({ remove ? QStringLiteral("remove") : QStringLiteral("replace"), resolved, pointer, newValue, false });
+                break;
+            }
+            value = it.value();
+        }
+        else if (path.type(pos) == Compiled::Index || path.type(pos) == Compiled::Append) {
+            if (!value.isArray()) {
+                if (!remove) // the value is replaced by an array
+                    changes.append({ QStringLiteral("replace"), resolved, pointer, QJsonValue(), true });
+                break;
+            }
+            const auto arr = value.toArray();
+            const int size = int(arr.size());
+            int idx = path.type(pos) == Compiled::Append ? size : path.index(pos);
+            if (idx < 0)
+                idx = size ? size + idx : 0; // -1 is last element, the same as set and remove
+            if (idx < 0 || (remove && idx >= size))
+                break;
+            for (int i = size; i < idx; i++)
+                changes.append({ QStringLiteral("add"), Compiled(), pointer + QChar('/') + QString::number(i), QJsonValue(), false });
+            resolved.append(idx);
+            pointer += QChar('/') + QString::number(idx);
+            if (idx >= size) {
+                changes.append({ QStringLiteral("add"), resolved, pointer, newValue, !last });
+                break;
+            }
+            if (last) {
+                changes.append({ remove ? QStringLiteral("remove") : QStringLiteral("replace"), resolved, pointer, newValue, false });
+                break;
+            }
+            value = arr.at(idx);
+        }
+        else
+            break;
+    }
+    return changes;
+}
+
+template <class T> void QJsonPath::Journal::commit(const T& root, const QVector<Change>& changes)
+{
+    for (const auto& change : changes) {
+        QJsonObject op{ { QStringLiteral("op"), change.op }, { QStringLiteral("path"), change.pointer } };
+        if (change.op != QLatin1String("remove"))
+            op.insert(QStringLiteral("value"), change.readAfter ? QJsonPath::get(root, change.path) : change.value);
+        m_patch.append(op);
+    }
+}
+
+void QJsonPath::Journal::set(QJsonValue& root, const Compiled& path, const QJsonValue& newValue)
+{
+    const auto changes = record(root, path, newValue, false);
+    QJsonPath::set(root, path, newValue);
+    commit(root, changes);
+}
+
+void QJsonPath::Journal::set(QJsonObject& root, const Compiled& path, const QJsonValue& newValue)
+{
+    const auto changes = record(root, path, newValue, false);
+    QJsonPath::set(root, path, newValue);
+    commit(root, changes);
+}
+
+void QJsonPath::Journal::set(QJsonArray& root, const Compiled& path, const QJsonValue& newValue)
+{
+    const auto changes = record(root, path, newValue, false);
+    QJsonPath::set(root, path, newValue);
+    commit(root, changes);
+}
+
+void QJsonPath::Journal::set(QJsonDocument& root, const Compiled& path, const QJsonValue& newValue)
+{
+    const auto changes = record(_patch_value(root), path, newValue, false);
+    QJsonPath::set(root, path, newValue);
+    commit(root, changes);
+}
+
+void QJsonPath::Journal::remove(QJsonValue& root, const Compiled& path)
+{
+    const auto changes = record(root, path, QJsonValue(), true);
+    QJsonPath::remove(root, path);
+    commit(root, changes);
+}
+
+void QJsonPath::Journal::remove(QJsonObject& root, const Compiled& path)
+{
+    const auto changes = record(root, path, QJsonValue(), true);
+    QJsonPath::remove(root, path);
+    commit(root, changes);
+}
+
+void QJsonPath::Journal::remove(QJsonArray& root, const Compiled& path)
+{
+    const auto changes = record(root, path, QJsonValue(), true);
+    QJsonPath::remove(root, path);
+    commit(root, changes);
+}
+
+void QJsonPath::Journal::remove(QJsonDocument& root, const Compiled& path)
+{
+    const auto changes = record(_patch_value(root), path, QJsonValue(), true);
+    QJsonPath::remove(root, path);
+    commit(root, changes);
+}
+
+
+// Replays a patch on a copy of the root. Operations are collected into a batch as long as no collected operation changes
+// a container on their path, the path is resolved and checked against the copy, which is correct only for such paths.
+class _PatchRunner
+{
+public:
+    explicit _PatchRunner(const QJsonValue& root) : m_root(root) {}
+
+    bool run(const QJsonArray& patch, QString* errorString)
+    {
+        for (int i = 0; i < patch.size(); i++) {
+            const auto op = patch.at(i).toObject();
+            QString error;
+            if (!operation(op, error)) {
+                if (errorString)
+                    *errorString = QString("operation %1 (%2): %3").arg(i).arg(op.value(QLatin1String("op")).toString(), error);
+                return false;
+            }
+        }
+        flush();
+        return true;
+    }
+
+    const QJsonValue& root() const { return m_root; }
+
+private:
+    struct Pending
+    {
+        QStringList tokens;
+        bool resizes; // adds or removes an array element, the following indexes move
+    };
+
+    // a JSON Pointer as unescaped tokens, false if it does not start with '/'
+    static bool tokens(const QJsonObject& op, const QString& name, QStringList& result, QString& error)
+    {
+        const auto pointer = op.value(name);
+        if (!pointer.isString() || (!pointer.toString().isEmpty() && !pointer.toString().startsWith(QChar('/')))) {
+            error = QString("\"%1\" is not a JSON Pointer").arg(name);
+            return false;
+        }
+        result.clear();
+        const auto parts = pointer.toString().split(QChar('/'));
+        for (int i = 1; i < parts.size(); i++)
+            result.append(_patch_unescape(parts[i]));
+        return true;
+    }
+
+    // an array index as in RFC 6901: digits without leading zeros
+    static int arrayIndex(const QString& token)
+    {
+        if (token.isEmpty() || token.size() > 9 || (token.size() > 1 && token[0] == QChar('0')))
+            return -1;
+        for (const auto c : token) {
+            if (c < QChar('0') || c > QChar('9'))
+                return -1;
+        }
+        return token.toInt();
+    }
+
+    // a collected operation changes a container on the path, or the value itself
+    bool conflicts(const QStringList& path) const
+    {
+        for (const auto& pending : m_pending) {
+            const int n = int(pending.tokens.size()) - (pending.resizes ? 1 : 0);
+            if (n <= path.size() && std::equal(pending.tokens.begin(), pending.tokens.begin() + n, path.begin()))
+                return true;
+        }
+        return false;
+    }
+
+    void flush()
+    {
+        if (!m_batch.isEmpty())
+            m_batch.apply(m_root);
+        m_batch.clear();
+        m_pending.clear();
+    }
+
+    // resolves the tokens against the copy, the value must exist unless add is set, for add only its container must exist
+    bool resolve(const QStringList& path, bool add, QJsonPath::Compiled& resolved, bool& inArray, int& arraySize, QString& error) const
+    {
+        resolved = QJsonPath::Compiled();
+        QJsonValue value = m_root;
+        for (int i = 0; i < path.size(); i++) {
+            const bool last = i + 1 == path.size();
+            if (value.isObject()) {
+                const auto obj = value.toObject();
+                const auto it = obj.constFind(path[i]);
+                if (it == obj.constEnd() && !(last && add)) {
+                    error = QString("\"%1\" does not exist").arg(path.mid(0, i + 1).join(QChar('/')));
+                    return false;
+                }
+                resolved.append(path[i]);
+                inArray = false;
+                if (!last)
+                    value = it.value();
+            }
+            else if (value.isArray()) {
+                const auto arr = value.toArray();
+                const int idx = last && add && path[i] == QLatin1String("-") ? int(arr.size()) : arrayIndex(path[i]);
+                if (idx < 0 || idx > arr.size() || (idx == arr.size() && !(last && add))) {
+                    error = QString("\"%1\" is not an index of the array").arg(path.mid(0, i + 1).join(QChar('/')));
+                    return false;
+                }
+                resolved.append(idx);
+                inArray = true;
+                arraySize = int(arr.size());
+                if (!last)
+                    value = arr.at(idx);
+            }
+            else {
+                error = QString("\"%1\" is not a container").arg(path.mid(0, i).join(QChar('/')));
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool add(const QStringList& path, const QJsonValue& value, QString& error)
+    {
+        if (path.isEmpty()) {
+            flush();
+            m_root = value;
+            return true;
+        }
+        if (conflicts(path))
+            flush();
+        QJsonPath::Compiled resolved;
+        bool inArray = false;
+        int arraySize = 0;
+        if (!resolve(path, true, resolved, inArray, arraySize, error))
+            return false;
+        if (inArray && resolved.index(resolved.size() - 1) < arraySize) {
+            // an insert moves the following elements up, a set cannot express it
+            flush();
+            const int idx = resolved.index(resolved.size() - 1);
+            resolved.truncate(resolved.size() - 1);
+            auto arr = QJsonPath::get(m_root, resolved).toArray();
+            if (!resolved.isEmpty())
+                QJsonPath::set(m_root, resolved, QJsonValue()); // arr holds the only reference now
+            else
+                m_root = QJsonValue();
+            arr.insert(idx, value);
+            if (!resolved.isEmpty())
+                QJsonPath::set(m_root, resolved, arr);
+            else
+                m_root = arr;
+            return true;
+        }
+        m_batch.set(resolved, value);
+        m_pending.append({ path, inArray });
+        return true;
+    }
+
+    bool remove(const QStringList& path, QString& error)
+    {
+        if (path.isEmpty()) {
+            error = QStringLiteral("the root cannot be removed");
+            return false;
+        }
+        if (conflicts(path))
+            flush();
+        QJsonPath::Compiled resolved;
+        bool inArray = false;
+        int arraySize = 0;
+        if (!resolve(path, false, resolved, inArray, arraySize, error))
+            return false;
+        m_batch.remove(resolved);
+        m_pending.append({ path, inArray });
+        return true;
+    }
+
+    // the current value, collected operations are applied first
+    bool read(const QStringList& path, QJsonValue& value, QString& error)
+    {
+        flush();
+        QJsonPath::Compiled resolved;
+        bool inArray = false;
+        int arraySize = 0;
+        if (!resolve(path, false, resolved, inArray, arraySize, error))
+            return false;
+        value = QJsonPath::get(m_root, resolved);
+        return true;
+    }
+
+    bool operation(const QJsonObject& op, QString& error)
+    {
+        const auto name = op.value(QLatin1String("op")).toString();
+        QStringList path, from;
+        if (!tokens(op, QStringLiteral("path"), path, error))
+            return false;
+        const auto value = op.value(QLatin1String("value"));
+        const bool needsValue = name == QLatin1String("add") || name == QLatin1String("replace") || name == QLatin1String("test");
+        if (needsValue && value.isUndefined()) {
+            error = QStringLiteral("\"value\" is missing");
+            return false;
+        }
+        if ((name == QLatin1String("move") || name == QLatin1String("copy")) && !tokens(op, QStringLiteral("from"), from, error))
+            return false;
+
+        if (name == QLatin1String("add"))
+            return add(path, value, error);
+        if (name == QLatin1String("remove"))
+            return remove(path, error);
+        if (name == QLatin1String("replace")) {
+            if (path.isEmpty()) {
+                flush();
+                m_root = value;
+                return true;
+            }
+            if (conflicts(path))
+                flush();
+            QJsonPath::Compiled resolved;
+            bool inArray = false;
+            int arraySize = 0;
+            if (!resolve(path, false, resolved, inArray, arraySize, error))
+                return false;
+            m_batch.set(resolved, value);
+            m_pending.append({ path, false });
+            return true;
+        }
+        if (name == QLatin1String("move")) {
+            if (path.size() > from.size() && path.mid(0, from.size()) == from) {
+                error = QStringLiteral("a value cannot be moved into itself");
+                return false;
+            }
+            QJsonValue moved;
+            if (!read(from, moved, error))
+                return false;
+            if (path == from)
+                return true;
+            return remove(from, error) && add(path, moved, error);
+        }
+        if (name == QLatin1String("copy")) {
+            QJsonValue copied;
+            return read(from, copied, error) && add(path, copied, error);
+        }
+        if (name == QLatin1String("test")) {
+            QJsonValue current;
+            if (!read(path, current, error))
+                return false;
+            if (current != value) {
+                error = QStringLiteral("the value is different");
+                return false;
+            }
+            return true;
+        }
+        error = QStringLiteral("unknown operation");
+        return false;
+    }
+
+    QJsonValue m_root;
+    QJsonPath::Batch m_batch;
+    QVector<Pending> m_pending;
+};
+
+bool QJsonPath::Journal::apply(QJsonValue& root, const QJsonArray& patch, QString* errorString)
+{
+    _PatchRunner runner(root);
+    if (!runner.run(patch, errorString))
+        return false;
+    root = runner.root();
+    return true;
+}
+
+bool QJsonPath::Journal::apply(QJsonObject& root, const QJsonArray& patch, QString* errorString)
+{
+    _PatchRunner runner(root);
+    if (!runner.run(patch, errorString))
+        return false;
+    if (!runner.root().isObject()) {
+        if (errorString)
+            *errorString = QStringLiteral("the root must stay an object");
+        return false;
+    }
+    root = runner.root().toObject();
+    return true;
+}
+
+bool QJsonPath::Journal::apply(QJsonArray& root, const QJsonArray& patch, QString* errorString)
+{
+    _PatchRunner runner(root);
+    if (!runner.run(patch, errorString))
+        return false;
+    if (!runner.root().isArray()) {
+        if (errorString)
+            *errorString = QStringLiteral("the root must stay an array");
+        return false;
+    }
+    root = runner.root().toArray();
+    return true;
+}
+
+bool QJsonPath::Journal::apply(QJsonDocument& root, const QJsonArray& patch, QString* errorString)
+{
+    _PatchRunner runner(_patch_value(root));
+    if (!runner.run(patch, errorString))
+        return false;
+    if (runner.root().isArray())
+        root = QJsonDocument(runner.root().toArray());
+    else if (runner.root().isObject())
+        root = QJsonDocument(runner.root().toObject());
+    else {
+        if (errorString)
+            *errorString = QStringLiteral("the root must stay an object or array");
+        return false;
+    }
+    return true;
+}
+
+
+void _handleJsonAttribute_unittest_patch()
+{
+    auto patch = [](const QByteArray& json) { return QJsonDocument::fromJson(json).array(); };
+    auto object = [](const QByteArray& json) { return QJsonDocument::fromJson(json).object(); };
+
+    // recorded operations
+    {
+        auto doc = object(R"({"a":{"b":1,"arr":[0]},"s":"x","k/~":1})");
+        const auto before = doc;
+        QJsonPath::Journal journal;
+        journal.set(doc, "a/b", 2);                      // replace
+        journal.set(doc, "a/c/d", true);                 // add with the created object
+        journal.set(doc, "a/arr[3]", 3);                 // padding
+        journal.set(doc, "a/arr[-1]", 4);                // resolved index
+        journal.set(doc, "s/t", 5);                      // a string replaced by an object
+        journal.remove(doc, "a/missing");                // nothing
+        journal.remove(doc, QVariantList{ "k/~" });      // escaped
+        journal.remove(doc, "a/arr[-4]");
+        Q_ASSERT(journal.patch() == patch(R"([
+            {"op":"replace","path":"/a/b","value":2},
+            {"op":"add","path":"/a/c","value":{"d":true}},
+            {"op":"add","path":"/a/arr/1","value":null},
+            {"op":"add","path":"/a/arr/2","value":null},
+            {"op":"add","path":"/a/arr/3","value":3},
+            {"op":"replace","path":"/a/arr/3","value":4},
+            {"op":"replace","path":"/s","value":{"t":5}},
+            {"op":"remove","path":"/k~1~0"},
+            {"op":"remove","path":"/a/arr/0"}])"));
+
+        auto replica = before;
+        QString error;
+        Q_ASSERT(QJsonPath::Journal::apply(replica, journal.patch(), &error) && error.isEmpty());
+        Q_ASSERT(replica == doc);
+        journal.clear();
+        Q_ASSERT(journal.isEmpty());
+
+        // other roots, a change of the root type is a replace of the whole document
+        QJsonValue val(1);
+        journal.set(val, "[1]", "x");
+        Q_ASSERT(journal.patch() == patch(R"([{"op":"replace","path":"","value":[null,"x"]}])"));
+        QJsonDocument jsonDoc;
+        journal.set(jsonDoc, "a", 1);
+        QJsonArray arr;
+        journal.set(arr, "[0]/x", 1);
+        Q_ASSERT(journal.size() == 3 && arr == QJsonArray({ QJsonObject({ { "x", 1 } }) }));
+    }
+
+    // RFC 6902 operations
+    {
+        const auto doc = object(R"({"a":[1,2,3],"o":{"x":1}})");
+        QJsonObject result = doc;
+        QString error;
+        Q_ASSERT(QJsonPath::Journal::apply(result, patch(R"([
+            {"op":"add","path":"/a/1","value":9},
+            {"op":"add","path":"/a/-","value":4},
+            {"op":"test","path":"/a","value":[1,9,2,3,4]},
+            {"op":"move","from":"/o/x","path":"/o/y"},
+            {"op":"copy","from":"/a/0","path":"/b"},
+            {"op":"remove","path":"/a/0"},
+            {"op":"replace","path":"/a/0","value":"r"},
+            {"op":"add","path":"/o/0","value":0}])"), &error));
+        Q_ASSERT(result == object(R"({"a":["r",2,3,4],"o":{"y":1,"0":0},"b":1})"));
+
+        // the root is unchanged if an operation fails
+        auto failed = [&](const QByteArray& json) {
+            result = doc;
+            error.clear();
+            return !QJsonPath::Journal::apply(result, patch(json), &error) && !error.isEmpty() && result == doc;
+        };
+        Q_ASSERT(failed(R"([{"op":"remove","path":"/a/0"},{"op":"test","path":"/a/0","value":1}])"));
+        Q_ASSERT(failed(R"([{"op":"replace","path":"/missing","value":1}])"));
+        Q_ASSERT(failed(R"([{"op":"add","path":"/a/4","value":1}])"));
+        Q_ASSERT(failed(R"([{"op":"add","path":"/a/01","value":1}])"));
+        Q_ASSERT(failed(R"([{"op":"remove","path":"/a/-"}])"));
+        Q_ASSERT(failed(R"([{"op":"add","path":"/x/y","value":1}])"));
+        Q_ASSERT(failed(R"([{"op":"add","path":"a","value":1}])"));
+        Q_ASSERT(failed(R"([{"op":"add","path":"/a"}])"));
+        Q_ASSERT(failed(R"([{"op":"move","from":"/o","path":"/o/x/y"}])"));
+        Q_ASSERT(failed(R"([{"op":"remove","path":""}])"));
+        Q_ASSERT(failed(R"([{"op":"replace","path":"","value":[]}])")); // an object root stays an object
+        Q_ASSERT(failed(R"([{"op":"invalid","path":"/a"}])"));
+    }
+
+    // differential test: a patch recorded from random changes recreates the result from the original
+    {
+        const auto original = object(R"({"a":{"b":[1,{"c":2},[3]],"d":"e"},"f":[{"g":null}],"h":{}})");
+        QJsonValue doc = original;
+        QJsonPath::Journal journal;
+        quint32 random = 1;
+        for (int round = 0; round < 300; round++) {
+            QVector<QJsonPath::Compiled> paths;
+            QJsonPath::Compiled path;
+            _handleJsonAttribute_unittest_paths(doc, path, paths);
+            random = random * 1103515245 + 12345;
+            const auto& chosen = paths[int((random >> 8) % quint32(paths.size()))];
+            if ((random >> 4) % 3 == 0)
+                journal.remove(doc, chosen);
+            else
+                journal.set(doc, chosen, (random >> 4) % 5 == 0 ? QJsonValue(QJsonObject({ { "n", round } })) : QJsonValue(round));
+        }
+        QJsonValue replica = original;
+        QString error;
+        Q_ASSERT_X(QJsonPath::Journal::apply(replica, journal.patch(), &error), __FUNCTION__, error.toUtf8());
+        Q_ASSERT(replica == doc);
+    }
+}
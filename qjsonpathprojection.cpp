@@ -0,0 +1,315 @@
+// MIT License Copyright (C) 2023 heksbeks https://github.com/heksbeks/qjsonpath
+
+#include "qjsonpath.h"
+#include "qjsonpath_p.h"
+#include <QBuffer>
+#include <QIODevice>
+#include <QJsonArray>
+#include <algorithm>
+
+
+// text written to a device is collected up to this size first
+static const int _projection_chunkSize = 65536;
+
+QJsonPath::Projection::Projection(const QVector<Compiled>& paths)
+{
+    m_nodes.append(Node());
+    for (const auto& path : paths)
+        add(path);
+}
+
+QJsonPath::Projection::Projection(const QStringList& paths)
+{
+    m_nodes.append(Node());
+    for (const auto& path : paths)
+        add(Compiled(path));
+}
+
+void QJsonPath::Projection::add(const Compiled& path)
+{
+    for (int pos = 0; pos < path.size(); pos++) {
+        if (path.type(pos) != Compiled::Key && path.type(pos) != Compiled::Index) {
+            Q_ASSERT_X(false, __FUNCTION__, QString("invalid path type at position %1").arg(pos).toUtf8());
+            return;
+        }
+    }
+    m_paths++;
+    qint32 n = 0;
+    for (int pos = 0; pos < path.size(); pos++) {
+        qint32 next = -1;
+        if (path.type(pos) == Compiled::Key) {
+            auto& members = m_nodes[n].members;
+            const QString key = path.key(pos);
+            auto it = std::lower_bound(members.begin(), members.end(), key, [](const Member& m, const QString& k) { return m.key < k; });
+            if (it != members.end() && it->key == key)
+                next = it->node;
+            else {
+                next = qint32(m_nodes.size());
+                Member member{ key, QByteArray(), next };
+                _handleJsonAttribute_writeString(member.text, key);
+                member.text += ':';
+                members.insert(it, member);
+                m_nodes.append(Node()); // after the insert, it points into m_nodes
+            }
+        }
+        else {
+            for (const auto& element : m_nodes[n].elements) {
+                if (element.first == path.index(pos))
+                    next = element.second;
+            }
+            if (next < 0) {
+                next = qint32(m_nodes.size());
+                m_nodes[n].elements.append(qMakePair(qint32(path.index(pos)), next));
+                m_nodes.append(Node());
+            }
+        }
+        n = next;
+    }
+    m_nodes[n].leaf = true;
+}
+
+
+// Containers are opened lazily: a level is pushed for every entered object or array, its bracket, key and comma are written
+// only when the first selected value below it is found, so nothing has to be taken back for paths missing in the document.
+struct QJsonPath::Projection::Writer
+{
+    struct Level
+    {
+        const QByteArray* key; // member of an object, with the colon
+        qint32 index;          // element of an array
+        char close;
+        bool opened;
+        bool empty;
+        qint32 next; // array elements written, the following ones are padded with null up to the next index
+    };
+
+    const Projection& projection;
+    QByteArray& out;
+    QIODevice* device;
+    bool failed = false;
+    QVector<Level> levels;
+
+    Writer(const Projection& projection, QByteArray& out, QIODevice* device) : projection(projection), out(out), device(device) { levels.reserve(16); }
+
+    void flush()
+    {
+        if (!device || failed || out.size() < _projection_chunkSize)
+            return;
+        failed = device->write(out) != out.size();
+        out.clear();
+    }
+
+    // the comma, key or null elements in front of a member or element of level parent
+    void separate(int parent, const QByteArray* key, qint32 index)
+    {
+        if (parent < 0)
+            return;
+        Level& p = levels[parent];
+        if (key) {
+            if (!p.empty)
+                out += ',';
+            out += *key;
+        }
+        else {
+            for (; p.next < index; p.next++) {
+                out += p.empty ? "null" : ",null";
+                p.empty = false;
+            }
+            if (!p.empty)
+                out += ',';
+            p.next = index + 1;
+        }
+        p.empty = false;
+    }
+
+    void open()
+    {
+        for (int i = 0; i < levels.size(); i++) {
+            if (levels[i].opened)
+                continue;
+            separate(i - 1, levels[i].key, levels[i].index);
+            out += levels[i].close == '}' ? '{' : '[';
+            levels[i].opened = true;
+        }
+    }
+
+    void write(const QJsonValue& value, const qint32* nodes, int count, const QByteArray* key, qint32 index)
+    {
+        for (int i = 0; i < count; i++) {
+            if (projection.m_nodes[nodes[i]].leaf) {
+                open();
+                separate(levels.size() - 1, key, index);
+                _handleJsonAttribute_writeValue(out, value);
+                flush();
+                return;
+            }
+        }
+
+        if (value.isObject()) {
+            levels.append(Level{ key, index, '}', false, true, 0 });
+            if (levels.size() == 1)
+                open(); // the root is written even without members
+            writeMembers(value.toObject(), nodes, count);
+        }
+        else if (value.isArray()) {
+            levels.append(Level{ key, index, ']', false, true, 0 });
+            if (levels.size() == 1)
+                open();
+            writeElements(value.toArray(), nodes, count);
+        }
+        else
+            return;
+        if (levels.last().opened)
+            out += levels.last().close;
+        levels.removeLast();
+    }
+
+    void writeMembers(const QJsonObject& obj, const qint32* nodes, int count)
+    {
+        if (count == 1) {
+            for (const auto& member : projection.m_nodes[nodes[0]].members) {
+                const auto it = obj.constFind(member.key);
+                if (it != obj.constEnd())
+                    write(it.value(), &member.node, 1, &member.text, -1);
+            }
+            return;
+        }
+        // several paths lead to this object through different indexes of the same element, their members are merged
+        QVector<const Member*> members;
+        for (int i = 0; i < count; i++) {
+            for (const auto& member : projection.m_nodes[nodes[i]].members)
+                members.append(&member);
+        }
+        std::stable_sort(members.begin(), members.end(), [](const Member* a, const Member* b) { return a->key < b->key; });
+        QVector<qint32> same;
+        for (int i = 0; i < members.size(); ) {
+            same.clear();
+            int j = i;
+            for (; j < members.size() && members[j]->key == members[i]->key; j++)
+                same.append(members[j]->node);
+            const auto it = obj.constFind(members[i]->key);
+            if (it != obj.constEnd())
+                write(it.value(), same.constData(), int(same.size()), &members[i]->text, -1);
+            i = j;
+        }
+    }
+
+    void writeElements(const QJsonArray& arr, const qint32* nodes, int count)
+    {
+        const qint32 size = qint32(arr.size());
+        QVector<QPair<qint32, qint32>> elements; // resolved index and node
+        for (int i = 0; i < count; i++) {
+            for (const auto& element : projection.m_nodes[nodes[i]].elements) {
+                const qint32 idx = element.first < 0 ? size + element.first : element.first; // -1 is last element
+                if (idx >= 0 && idx < size)
+                    elements.append(qMakePair(idx, element.second));
+            }
+        }
+        std::stable_sort(elements.begin(), elements.end(), [](const QPair<qint32, qint32>& a, const QPair<qint32, qint32>& b) { return a.first < b.first; });
+        QVector<qint32> same;
+        for (int i = 0; i < elements.size(); ) {
+            same.clear();
+            int j = i;
+            for (; j < elements.size() && elements[j].first == elements[i].first; j++)
+                same.append(elements[j].second);
+            write(arr.at(elements[i].first), same.constData(), int(same.size()), nullptr, elements[i].first);
+            i = j;
+        }
+    }
+};
+
+void QJsonPath::Projection::write(QByteArray& out, const QJsonValue& root) const
+{
+    Writer writer(*this, out, nullptr);
+    const qint32 node = 0;
+    writer.write(root, &node, 1, nullptr, -1);
+}
+
+void QJsonPath::Projection::write(QByteArray& out, const QJsonDocument& root) const
+{
+    if (root.isArray())
+        write(out, QJsonValue(root.array()));
+    else if (root.isObject())
+        write(out, QJsonValue(root.object()));
+}
+
+bool QJsonPath::Projection::write(QIODevice* device, const QJsonValue& root) const
+{
+    QByteArray out;
+    out.reserve(_projection_chunkSize + 4096);
+    Writer writer(*this, out, device);
+    const qint32 node = 0;
+    writer.write(root, &node, 1, nullptr, -1);
+    if (!writer.failed && !out.isEmpty())
+        writer.failed = device->write(out) != out.size();
+    return !writer.failed;
+}
+
+bool QJsonPath::Projection::write(QIODevice* device, const QJsonDocument& root) const
+{
+    if (root.isArray())
+        return write(device, QJsonValue(root.array()));
+    if (root.isObject())
+        return write(device, QJsonValue(root.object()));
+    return true;
+}
+
+
+void _handleJsonAttribute_unittest_projection()
+{
+    const auto doc = QJsonDocument::fromJson(R"({"id":7,"name":"x","address":{"city":"Berlin","zip":"10115","geo":{"lat":52.5,"lon":13.4}},
+        "items":[{"n":"a","t":[1,2]},{"n":"b","t":[]},null,{"n":"d","q":"e\"\n"}],"empty":{},"k\"ey":true})");
+
+    // the same text as set of every existing path on a new document
+    const QVector<QStringList> projections{
+        { "id", "name", "address/city" },
+        { "address/geo/lat", "address", "missing", "id/x", "items/x" },
+        { "items[1]/n", "items[3]/q", "items[5]", "items[0]/t[1]", "k\"ey" },
+        { "items[2]/n", "address/none/x", "empty", "empty/x" },
+        { "missing" },
+        {},
+    };
+    for (const auto& paths : projections) {
+        QJsonValue expected(QJsonValue::Object);
+        for (const auto& path : paths) {
+            const auto value = QJsonPath::get(doc, path);
+            if (!value.isUndefined())
+                QJsonPath::set(expected, path, value);
+        }
+        const QJsonPath::Projection projection(paths);
+        Q_ASSERT(projection.pathCount() == paths.size());
+        const auto text = projection.toJson(doc);
+        Q_ASSERT_X(text == QJsonDocument(expected.toObject()).toJson(QJsonDocument::Compact), __FUNCTION__, paths.join(',').toUtf8());
+        QByteArray device;
+        QBuffer buffer(&device);
+        buffer.open(QIODevice::WriteOnly);
+        Q_ASSERT(projection.write(&buffer, doc) && device == text);
+    }
+
+    // negative indexes count down from the end of the array of the document, paths to the same element are merged
+    const QJsonPath::Projection negative(QStringList{ "items[-1]/n", "items[3]/q", "items[-4]/t[-1]", "items[-5]" });
+    Q_ASSERT(negative.toJson(doc) == R"({"items":[{"t":[null,2]},null,null,{"n":"d","q":"e\"\n"}]})");
+    Q_ASSERT(QJsonPath::Projection(QVector<QJsonPath::Compiled>{ QJsonPath::Compiled(), QJsonPath::Compiled("id") }).toJson(doc) == doc.toJson(QJsonDocument::Compact));
+
+    // an array root, a scalar root and the text of a large projection written in chunks
+    const QJsonPath::Projection elements(QVector<QJsonPath::Compiled>{ QJsonPath::Compiled("[2]/a"), QJsonPath::Compiled("[0]") });
+    Q_ASSERT(elements.toJson(QJsonArray{ 1, "x", QJsonObject{ { "a", 3 }, { "b", 4 } } }) == R"([1,null,{"a":3}])");
+    Q_ASSERT(elements.toJson(QJsonArray{}) == "[]" && elements.toJson(QJsonValue(5)).isEmpty());
+    Q_ASSERT(QJsonPath::Projection(QVector<QJsonPath::Compiled>{ QJsonPath::Compiled() }).toJson(QJsonValue("s")) == "\"s\"");
+
+    QJsonArray rows;
+    QStringList paths;
+    for (int i = 0; i < 5000; i++) {
+        rows.append(QJsonObject{ { "id", i }, { "text", QString(40, QChar('a' + i % 26)) }, { "skip", i } });
+        paths << QString("rows[%1]/id").arg(i) << QString("rows[%1]/text").arg(i);
+    }
+    const QJsonObject large{ { "rows", rows } };
+    QJsonObject expected;
+    for (const auto& path : paths)
+        QJsonPath::set(expected, path, QJsonPath::get(large, path));
+    QByteArray device;
+    QBuffer buffer(&device);
+    buffer.open(QIODevice::WriteOnly);
+    Q_ASSERT(QJsonPath::Projection(paths).write(&buffer, QJsonDocument(large)));
+    Q_ASSERT(device.size() > 2 * _projection_chunkSize && device == QJsonDocument(expected).toJson(QJsonDocument::Compact));
+}
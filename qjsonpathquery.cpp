@@ -0,0 +1,416 @@
+// MIT License Copyright (C) 2023 heksbeks https://github.com/heksbeks/qjsonpath
+
+#include "qjsonpath.h"
+#include "qjsonpath_p.h"
+#include <QJsonArray>
+
+
+// returns the position of the bracket closing the one at pos, brackets and quotes in between are skipped, -1 if missing
+static int _handleJsonAttribute_queryBracketEnd(const QString& path, int pos)
+{
+    int depth = 0;
+    QChar quote;
+    for (int i = pos; i < path.size(); i++) {
+        const QChar c = path[i];
+        if (!quote.isNull()) {
+            if (c == QChar('\\'))
+                i++;
+            else if (c == quote)
+                quote = QChar();
+        }
+        else if (depth > 0 && (c == QChar('"') || c == QChar('\'')))
+            quote = c;
+        else if (c == QChar('['))
+            depth++;
+        else if (c == QChar(']') && --depth == 0)
+            return i;
+    }
+    return -1;
+}
+
+// splits a query string at separators outside of brackets
+static QStringList _handleJsonAttribute_querySegments(const QString& path, QChar separator)
+{
+    QStringList segments;
+    int i0 = 0;
+    for (int i = 0; i < path.size(); i++) {
+        if (path[i] == QChar('[')) {
+            const int close = _handleJsonAttribute_queryBracketEnd(path, i);
+            if (close > 0)
+                i = close;
+        }
+        else if (path[i] == separator) {
+            segments << path.mid(i0, i - i0);
+            i0 = i + 1;
+        }
+    }
+    segments << path.mid(i0);
+    return segments;
+}
+
+
+QJsonPath::Query::Query(const QString& path)
+    : Query(path, QJsonPath::separator())
+{
+}
+
+QJsonPath::Query::Query(const QString& path, QChar separator)
+{
+    auto token = [](TokenType type, const QString& key = QString(), int index = 0, int end = 0, int step = 1) {
+        return Token{ key, index, end, step, type };
+    };
+
+    // content of a bracket: index, wildcard, slice or filter, anything else stays part of the name
+    auto bracket = [&](const QString& content, Token& t) {
+        if (content == QLatin1String("*")) {
+            t = token(Wildcard);
+            return true;
+        }
+        if (content.startsWith(QChar('?'))) {
+            m_filters.append(QJsonPath::Filter(content.mid(1))); // parentheses around the expression are part of it, an error is reported by isValid
+            t = token(Filter, QString(), int(m_filters.size()) - 1);
+            return true;
+        }
+        bool ok;
+        if (!content.contains(QChar(':'))) {
+            const int idx = content.toInt(&ok);
+            if (ok)
+                t = token(Index, QString(), idx);
+            return ok;
+        }
+        const auto parts = content.split(QChar(':'));
+        if (parts.size() > 3)
+            return false;
+        int bounds[3] = { NoBound, NoBound, 1 };
+        for (int i = 0; i < parts.size(); i++) {
+            if (parts[i].trimmed().isEmpty())
+                continue;
+            bounds[i] = parts[i].toInt(&ok);
+            if (!ok)
+                return false;
+        }
+        if (bounds[2] == 0)
+            return false;
+        t = token(Slice, QString(), bounds[0], bounds[1], bounds[2]);
+        return true;
+    };
+
+    const auto segments = _handleJsonAttribute_querySegments(path, separator);
+    bool descent = false;
+    auto append = [&](const Token& t) {
+        if (descent)
+            m_tokens.append(token(Descent));
+        descent = false;
+        m_tokens.append(t);
+    };
+    auto appendName = [&](QString& name) {
+        if (!name.isEmpty())
+            append(name == QLatin1String("*") ? token(Wildcard) : token(Key, name));
+        name.clear();
+    };
+
+    for (int s = 0; s < segments.size(); s++) {
+        const auto& segment = segments[s];
+        int i = 0;
+        if (segment.isEmpty()) {
+            // a leading or trailing separator is ignored, an empty segment in between is a recursive descent
+            if (s > 0 && s + 1 < segments.size())
+                descent = true;
+            continue;
+        }
+        if (segment.startsWith(QLatin1String(".."))) {
+            descent = true;
+            i = 2;
+        }
+
+        QString name;
+        while (i < segment.size()) {
+            if (segment[i] == QChar('[')) {
+                const int close = _handleJsonAttribute_queryBracketEnd(segment, i);
+                Token t;
+                if (close > 0 && bracket(segment.mid(i + 1, close - i - 1), t)) {
+                    appendName(name);
+                    append(t);
+                    i = close + 1;
+                    continue;
+                }
+            }
+            name += segment[i++];
+        }
+        appendName(name);
+    }
+
+    // a descent without a name selects every descendant
+    if (descent)
+        append(token(Wildcard));
+}
+
+bool QJsonPath::Query::isValid() const
+{
+    for (const auto& filter : m_filters) {
+        if (!filter.isValid())
+            return false;
+    }
+    return true;
+}
+
+QJsonPath::MatchRange QJsonPath::Query::match(const QJsonValue& root) const
+{
+    return MatchRange(*this, root);
+}
+
+QJsonPath::MatchRange QJsonPath::Query::match(const QJsonObject& root) const
+{
+    return MatchRange(*this, root);
+}
+
+QJsonPath::MatchRange QJsonPath::Query::match(const QJsonArray& root) const
+{
+    return MatchRange(*this, root);
+}
+
+QJsonPath::MatchRange QJsonPath::Query::match(const QJsonDocument& root) const
+{
+    // object() and array() share the document data, they do not copy it
+    return root.isArray() ? MatchRange(*this, root.array()) : MatchRange(*this, root.object());
+}
+
+
+QJsonPath::MatchIterator::MatchIterator(const Query& query, const QJsonValue& root) : m_query(query), m_atEnd(false)
+{
+    if (!enter(root, 0))
+        advance();
+}
+
+// follows keys and indexes directly, tokens selecting many children push a frame, returns true if value is a match
+bool QJsonPath::MatchIterator::enter(QJsonValue value, int pos)
+{
+    for (; pos < m_query.size(); pos++) {
+        const auto& token = m_query.m_tokens[pos];
+        Frame frame{ value, QJsonObject(), QJsonArray(), pos, m_match.path.size(), 0, 0, 1 };
+
+        if (token.type == Query::Key) {
+            if (!value.isObject())
+                return false;
+            const auto obj = value.toObject();
+            const auto it = obj.constFind(token.key);
+            if (it == obj.constEnd())
+                return false;
+            m_match.path.append(token.key);
+            value = it.value();
+            continue;
+        }
+        else if (token.type == Query::Index) {
+            if (!value.isArray())
+                return false;
+            const auto arr = value.toArray();
+            int idx = token.index;
+            if (idx < 0)
+                idx = int(arr.size()) + idx; // -1 is last element
+            if (idx < 0 || idx >= arr.size())
+                return false;
+            m_match.path.append(idx);
+            value = arr.at(idx);
+            continue;
+        }
+        else if (token.type == Query::Wildcard || token.type == Query::Filter) {
+            if (value.isObject()) {
+                frame.object = value.toObject();
+                frame.end = int(frame.object.size());
+            }
+            else if (value.isArray()) {
+                frame.array = value.toArray();
+                frame.end = int(frame.array.size());
+            }
+            else
+                return false;
+        }
+        else if (token.type == Query::Slice) {
+            if (!value.isArray())
+                return false;
+            // same rules as python slices
+            frame.array = value.toArray();
+            const int size = int(frame.array.size());
+            auto bound = [size](int i, int dflt, int lo, int hi) {
+                if (i == Query::NoBound)
+                    return dflt;
+                if (i < 0)
+                    i += size;
+                return qBound(lo, i, hi);
+            };
+            frame.step = token.step;
+            if (token.step > 0) {
+                frame.cursor = bound(token.index, 0, 0, size);
+                frame.end = bound(token.end, size, 0, size);
+            }
+            else {
+                frame.cursor = bound(token.index, size - 1, -1, size - 1);
+                frame.end = bound(token.end, -1, -1, size - 1);
+            }
+        }
+        else if (token.type == Query::Descent) {
+            frame.cursor = -1;
+            if (value.isObject()) {
+                frame.object = value.toObject();
+                frame.end = int(frame.object.size());
+            }
+            else if (value.isArray()) {
+                frame.array = value.toArray();
+                frame.end = int(frame.array.size());
+            }
+        }
+        m_stack.append(frame);
+        return false;
+    }
+
+    m_match.value = value;
+    return true;
+}
+
+void QJsonPath::MatchIterator::advance()
+{
+    while (!m_stack.isEmpty()) {
+        auto& frame = m_stack.last();
+        if (frame.step > 0 ? frame.cursor >= frame.end : frame.cursor <= frame.end) {
+            m_stack.removeLast();
+            continue;
+        }
+
+        m_match.path.truncate(frame.pathSize);
+        const auto type = m_query.type(frame.pos);
+        const bool descent = type == Query::Descent;
+        QJsonValue child;
+        int pos;
+        if (descent && frame.cursor < 0) {
+            // the token after a descent is applied to the value itself first
+            child = frame.value;
+            pos = frame.pos + 1;
+            frame.cursor = 0;
+        }
+        else {
+            const int i = frame.cursor;
+            frame.cursor += frame.step;
+            if (frame.value.isObject()) {
+                const auto it = frame.object.constBegin() + i;
+                child = it.value();
+                if (type == Query::Filter && !m_query.m_filters[m_query.index(frame.pos)].test(child))
+                    continue;
+                m_match.path.append(it.key());
+            }
+            else {
+                child = frame.array.at(i);
+                if (type == Query::Filter && !m_query.m_filters[m_query.index(frame.pos)].test(child))
+                    continue;
+                m_match.path.append(i);
+            }
+            pos = descent ? frame.pos : frame.pos + 1;
+        }
+
+        if (enter(child, pos))
+            return;
+    }
+
+    m_atEnd = true;
+    m_match = Match();
+}
+
+QJsonPath::MatchIterator& QJsonPath::MatchIterator::operator++()
+{
+    if (!m_atEnd)
+        advance();
+    return *this;
+}
+
+bool QJsonPath::MatchIterator::operator==(const MatchIterator& other) const
+{
+    if (m_atEnd || other.m_atEnd)
+        return m_atEnd == other.m_atEnd;
+    return m_stack.size() == other.m_stack.size() && m_match.path == other.m_match.path;
+}
+
+QVector<QJsonPath::Match> QJsonPath::MatchRange::toVector(int limit) const
+{
+    QVector<Match> matches;
+    for (auto it = begin(); it != end() && matches.size() != limit; ++it)
+        matches.append(*it);
+    return matches;
+}
+
+
+static QVariantList _handleJsonAttribute_unittest_queryPaths(const QJsonValue& root, const QString& query, int limit = -1)
+{
+    QVariantList paths;
+    for (const auto& m : QJsonPath::Query(query).match(root).toVector(limit)) {
+        Q_ASSERT(QJsonPath::get(root, m.path) == m.value);
+        paths.append(QVariant(m.path.toVariantList()));
+    }
+    return paths;
+}
+
+void _handleJsonAttribute_unittest_query()
+{
+    const QJsonObject doc{
+        {"items", QJsonArray{
+             QJsonObject{{"id", 1}, {"price", 10}},
+             QJsonObject{{"id", 2}, {"price", 20}, {"tags", QJsonArray{"a", "b"}}},
+             QJsonObject{{"id", 3}},
+             QJsonObject{{"id", 4}, {"price", 40}},
+         }},
+        {"owner", QJsonObject{{"id", 5}, {"name", "x"}}},
+    };
+    auto paths = [&](const QString& query, int limit = -1) { return _handleJsonAttribute_unittest_queryPaths(doc, query, limit); };
+    using L = QVariantList;
+
+    // plain paths select at most one value
+    Q_ASSERT(paths("items[1]/price") == L({L{"items", 1, "price"}}));
+    Q_ASSERT(paths("items[-1]/id") == L({L{"items", 3, "id"}}));
+    Q_ASSERT(paths("items[9]/id").isEmpty());
+    Q_ASSERT(paths("").size() == 1);
+
+    // wildcards, on arrays and objects
+    Q_ASSERT(paths("items[*]/price") == L({L{"items", 0, "price"}, L{"items", 1, "price"}, L{"items", 3, "price"}}));
+    Q_ASSERT(paths("items/*/price") == paths("items[*]/price"));
+    Q_ASSERT(paths("owner/*") == L({L{"owner", "id"}, L{"owner", "name"}}));
+    Q_ASSERT(paths("owner/id/*").isEmpty());
+
+    // slices
+    Q_ASSERT(paths("items[1:3]/id") == L({L{"items", 1, "id"}, L{"items", 2, "id"}}));
+    Q_ASSERT(paths("items[::2]/id") == L({L{"items", 0, "id"}, L{"items", 2, "id"}}));
+    Q_ASSERT(paths("items[-2:]/id") == L({L{"items", 2, "id"}, L{"items", 3, "id"}}));
+    Q_ASSERT(paths("items[::-1]/id") == L({L{"items", 3, "id"}, L{"items", 2, "id"}, L{"items", 1, "id"}, L{"items", 0, "id"}}));
+    Q_ASSERT(paths("items[5:0:-2]/id") == L({L{"items", 3, "id"}, L{"items", 1, "id"}}));
+    Q_ASSERT(paths("items[3:1]/id").isEmpty());
+    Q_ASSERT(paths("owner[0:1]").isEmpty());
+
+    // recursive descent
+    const auto ids = L({L{"items", 0, "id"}, L{"items", 1, "id"}, L{"items", 2, "id"}, L{"items", 3, "id"}, L{"owner", "id"}});
+    Q_ASSERT(paths("..id") == ids);
+    Q_ASSERT(paths("//id") == ids);
+    Q_ASSERT(paths("items//price").size() == 3);
+    Q_ASSERT(paths("..tags[-1]") == L({L{"items", 1, "tags", 1}}));
+    Q_ASSERT(paths("owner/..").size() == 2);
+    QJsonPath::setSeparator('.');
+    Q_ASSERT(paths("..id") == ids);
+    Q_ASSERT(paths("items..price").size() == 3);
+    QJsonPath::setSeparator('/');
+    Q_ASSERT(QJsonPath::Query("items..price", '.').match(doc).toVector().size() == 3);
+
+    // invalid brackets stay part of the name
+    Q_ASSERT(QJsonPath::Query("a[x]/b[1:y]").size() == 2);
+    Q_ASSERT(QJsonPath::Query("a[x]").key(0) == "a[x]");
+
+    // evaluation is lazy and can stop at any match
+    Q_ASSERT(paths("..id", 2) == ids.mid(0, 2));
+    auto range = QJsonPath::match(doc, "items[*]/id");
+    auto it = range.begin();
+    Q_ASSERT(it != range.end() && it->value == 1);
+    ++it;
+    Q_ASSERT(it->value == 2);
+    Q_ASSERT(range.begin() != it);
+    int n = 0;
+    for (const auto& m : QJsonPath::Query("..*").match(QJsonDocument(doc))) {
+        Q_ASSERT(!m.path.isEmpty());
+        n++;
+    }
+    Q_ASSERT(n == 18);
+}
@@ -0,0 +1,235 @@
+// MIT License Copyright (C) 2023 heksbeks https://github.com/heksbeks/qjsonpath
+
+#include "qjsonpath.h"
+#include "qjsonpath_p.h"
+#include <QThreadPool>
+#include <algorithm>
+#include <vector>
+
+
+// slots are allocated in blocks, a block is never freed before the document
+static const int _shared_blockSize = 64;
+
+// slot of the last snapshot of this thread, it is usually free again and its cache line is still owned by this core
+static thread_local int _shared_slotHint = -1;
+
+struct QJsonPath::SharedDocument::Version
+{
+    QJsonValue root;
+    quint64 number;
+};
+
+// announces the version used by one snapshot, on a cache line of its own so readers on different cores never share one
+struct alignas(64) QJsonPath::SharedDocument::Slot
+{
+    std::atomic<const Version*> hazard{ nullptr };
+    std::atomic<bool> used{ false };
+};
+
+struct QJsonPath::SharedDocument::SlotBlock
+{
+    Slot entries[_shared_blockSize];
+    std::atomic<SlotBlock*> next{ nullptr };
+    int first = 0; // number of the first slot
+};
+
+
+QJsonPath::SharedDocument::SharedDocument(const QJsonValue& root)
+    : m_current(new Version{ root, 0 })
+    , m_slots(new SlotBlock)
+{
+}
+
+QJsonPath::SharedDocument::~SharedDocument()
+{
+    for (auto block = m_slots.load(); block; ) {
+        for (const auto& slot : block->entries)
+            Q_ASSERT_X(!slot.used.load(), __FUNCTION__, "a snapshot outlives its document");
+        auto next = block->next.load();
+        delete block;
+        block = next;
+    }
+    for (auto version : m_retired)
+        delete version;
+    delete m_current.load();
+}
+
+QJsonPath::SharedDocument::Slot* QJsonPath::SharedDocument::acquireSlot() const
+{
+    auto tryAcquire = [](Slot& slot) {
+        bool expected = false;
+        return !slot.used.load(std::memory_order_relaxed) && slot.used.compare_exchange_strong(expected, true, std::memory_order_acquire);
+    };
+
+    const int hint = _shared_slotHint;
+    if (hint >= 0) {
+        auto block = m_slots.load(std::memory_order_acquire);
+        for (int i = hint / _shared_blockSize; block && i > 0; i--)
+            block = block->next.load(std::memory_order_acquire);
+        if (block && tryAcquire(block->entries[hint % _shared_blockSize]))
+            return &block->entries[hint % _shared_blockSize];
+    }
+
+    for (auto block = m_slots.load(std::memory_order_acquire); ; ) {
+        for (int i = 0; i < _shared_blockSize; i++) {
+            if (tryAcquire(block->entries[i])) {
+                _shared_slotHint = block->first + i;
+                return &block->entries[i];
+            }
+        }
+        auto next = block->next.load(std::memory_order_acquire);
+        if (!next) {
+            // all slots are used by snapshots alive at the same time, append a block unless another reader was faster
+            auto added = new SlotBlock;
+            added->first = block->first + _shared_blockSize;
+            if (block->next.compare_exchange_strong(next, added, std::memory_order_acq_rel))
+                next = added;
+            else
+                delete added;
+        }
+        block = next;
+    }
+}
+
+QJsonPath::SharedDocument::Snapshot QJsonPath::SharedDocument::snapshot() const
+{
+    auto slot = acquireSlot();
+    const Version* version = m_current.load(std::memory_order_acquire);
+    for (;;) {
+        // the version is safe once announced, if it was still current afterwards a writer scanning the slots will see it
+        slot->hazard.store(version, std::memory_order_seq_cst);
+        const Version* current = m_current.load(std::memory_order_seq_cst);
+        if (current == version)
+            break;
+        version = current;
+    }
+    return Snapshot(slot, version);
+}
+
+quint64 QJsonPath::SharedDocument::update(const std::function<void(QJsonValue& root)>& change)
+{
+    QMutexLocker locker(&m_writer);
+    Version* current = m_current.load(std::memory_order_relaxed);
+    QJsonValue root = current->root; // the change detaches only the containers on its paths
+    change(root);
+    auto next = new Version{ root, current->number + 1 };
+    m_current.store(next, std::memory_order_seq_cst);
+    m_retired.append(current);
+    reclaim();
+    return next->number;
+}
+
+quint64 QJsonPath::SharedDocument::set(const Compiled& path, const QJsonValue& newValue)
+{
+    return update([&](QJsonValue& root) { QJsonPath::set(root, path, newValue); });
+}
+
+quint64 QJsonPath::SharedDocument::remove(const Compiled& path)
+{
+    return update([&](QJsonValue& root) { QJsonPath::remove(root, path); });
+}
+
+void QJsonPath::SharedDocument::reclaim()
+{
+    QVector<const Version*> announced;
+    for (auto block = m_slots.load(std::memory_order_acquire); block; block = block->next.load(std::memory_order_acquire)) {
+        for (const auto& slot : block->entries) {
+            if (auto version = slot.hazard.load(std::memory_order_seq_cst))
+                announced.append(version);
+        }
+    }
+    m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(), [&announced](Version* version) {
+        if (announced.contains(version))
+            return false;
+        delete version;
+        return true;
+    }), m_retired.end());
+}
+
+
+QJsonPath::SharedDocument::Snapshot::~Snapshot()
+{
+    if (!m_slot)
+        return;
+    m_slot->hazard.store(nullptr, std::memory_order_release);
+    m_slot->used.store(false, std::memory_order_release);
+}
+
+const QJsonValue& QJsonPath::SharedDocument::Snapshot::root() const
+{
+    return m_version->root;
+}
+
+quint64 QJsonPath::SharedDocument::Snapshot::version() const
+{
+    return m_version->number;
+}
+
+QJsonValue QJsonPath::SharedDocument::Snapshot::get(const Compiled& path, const QJsonValue& defaultValue) const
+{
+    return QJsonPath::get(m_version->root, path, defaultValue);
+}
+
+
+void _handleJsonAttribute_unittest_shared()
+{
+    {
+        QJsonPath::SharedDocument doc;
+        Q_ASSERT(doc.snapshot().version() == 0 && doc.snapshot().root() == QJsonValue(QJsonValue::Object));
+        Q_ASSERT(doc.set("a/b", 1) == 1);
+        Q_ASSERT(doc.get(QJsonPath::Compiled("a/b")) == 1);
+
+        // a snapshot keeps its version while the document changes
+        auto before = doc.snapshot();
+        Q_ASSERT(doc.set("a/b", 2) == 2 && doc.remove("a/c") == 3);
+        Q_ASSERT(before.get("a/b") == 1 && before.version() == 1);
+        Q_ASSERT(doc.snapshot().get("a/b") == 2 && doc.snapshot().version() == 3);
+        auto moved = std::move(before);
+        Q_ASSERT(moved.get(QVariantList{ "a", "b" }) == 1);
+
+        // a change sees all previous changes, several sets are published as one version
+        Q_ASSERT(doc.update([](QJsonValue& root) {
+            QJsonPath::set(root, "a/c[1]", QJsonPath::get(root, "a/b"));
+            QJsonPath::remove(root, "a/b");
+        }) == 4);
+        const auto after = doc.snapshot();
+        Q_ASSERT(after.get("a/b") == QJsonValue(QJsonValue::Undefined) && after.get("a/c[1]") == 2);
+        Q_ASSERT(moved.root() == QJsonObject({ { "a", QJsonObject({ { "b", 1 } }) } }));
+
+        // more snapshots alive at the same time than one block of slots
+        std::vector<QJsonPath::SharedDocument::Snapshot> snapshots; // move only
+        for (int i = 0; i < 3 * _shared_blockSize; i++)
+            snapshots.push_back(doc.snapshot());
+        Q_ASSERT(snapshots.back().version() == 4);
+    }
+
+    // readers always see complete versions, the updater writes two values which are equal in every version
+    {
+        QJsonPath::SharedDocument doc(QJsonObject({ { "a", 0 }, { "b", 0 } }));
+        const QJsonPath::Compiled a("a"), b("b");
+        std::atomic<bool> done(false);
+        std::atomic<int> torn(0);
+        QThreadPool pool;
+        const int readers = 4;
+        pool.setMaxThreadCount(readers + 1);
+        for (int t = 0; t < readers; t++) {
+            pool.start([&]() {
+                quint64 last = 0;
+                while (!done.load()) {
+                    const auto snapshot = doc.snapshot();
+                    if (snapshot.get(a) != snapshot.get(b) || snapshot.version() < last)
+                        torn++;
+                    last = snapshot.version();
+                }
+            });
+        }
+        pool.start([&]() {
+            for (int i = 1; i <= 2000; i++)
+                doc.update([&](QJsonValue& root) { QJsonPath::set(root, a, i); QJsonPath::set(root, b, i); });
+            done = true;
+        });
+        pool.waitForDone();
+        Q_ASSERT(torn == 0);
+        Q_ASSERT(doc.get(a) == 2000 && doc.snapshot().version() == 2000);
+    }
+}
@@ -0,0 +1,532 @@
+// MIT License Copyright (C) 2023 heksbeks https://github.com/heksbeks/qjsonpath
+
+#include "qjsonpath.h"
+#include "qjsonpath_p.h"
+#include <QBuffer>
+#include <QIODevice>
+#include <cctype>
+#include <cstring>
+#include <utility>
+
+
+// Push parser: a byte level state machine whose state survives the chunk boundaries. The text of a matched value is copied
+// and converted by QJsonDocument, so the values are exactly those of the document parser. Skipped values are only tokenized.
+
+static bool _stream_isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool _stream_isLiteral(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' || c == 'E';
+}
+
+static bool _stream_isDigit(const char* text, int size, int i)
+{
+    return i < size && text[i] >= '0' && text[i] <= '9';
+}
+
+// true, false, null or a number as defined by RFC 8259
+bool _handleJsonAttribute_isLiteral(const char* text, int size)
+{
+    if ((size == 4 && !std::memcmp(text, "true", 4)) || (size == 5 && !std::memcmp(text, "false", 5)) || (size == 4 && !std::memcmp(text, "null", 4)))
+        return true;
+    int i = 0;
+    if (i < size && text[i] == '-')
+        i++;
+    if (!_stream_isDigit(text, size, i))
+        return false;
+    if (text[i++] != '0') {
+        while (_stream_isDigit(text, size, i))
+            i++;
+    }
+    if (i < size && text[i] == '.') {
+        if (!_stream_isDigit(text, size, ++i))
+            return false;
+        while (_stream_isDigit(text, size, i))
+            i++;
+    }
+    if (i < size && (text[i] == 'e' || text[i] == 'E')) {
+        i++;
+        if (i < size && (text[i] == '+' || text[i] == '-'))
+            i++;
+        if (!_stream_isDigit(text, size, i))
+            return false;
+        while (_stream_isDigit(text, size, i))
+            i++;
+    }
+    return i == size;
+}
+
+// a document root must be an object or an array, so the value is parsed as the element of an array
+static QJsonValue _stream_decode(const QByteArray& text)
+{
+    QJsonParseError error;
+    const auto doc = QJsonDocument::fromJson(QByteArray("[") + text + ']', &error);
+    if (error.error != QJsonParseError::NoError)
+        return QJsonValue(QJsonValue::Undefined);
+    return doc.array().at(0);
+}
+
+
+QJsonPath::Stream::Stream(const QVector<Compiled>& paths, const Callback& callback)
+    : m_paths(paths)
+    , m_callback(callback)
+{
+}
+
+int QJsonPath::Stream::addPath(const Compiled& path)
+{
+    m_paths.append(path);
+    return int(m_paths.size()) - 1;
+}
+
+void QJsonPath::Stream::reset()
+{
+    m_state = Value;
+    m_depth = 0;
+    m_escape = 0;
+    m_captures.clear();
+    m_capture.clear();
+    m_offset = 0;
+    m_error.clear();
+}
+
+bool QJsonPath::Stream::feed(QIODevice* device)
+{
+    return feed(device->readAll());
+}
+
+bool QJsonPath::Stream::feed(const char* data, int size)
+{
+    if (hasError())
+        return false;
+
+    m_chunkStart = 0;
+    int i = 0;
+    while (i < size && !hasError()) {
+        const char c = data[i];
+        if (m_state == String) {
+            i = string(data, i, size);
+            continue;
+        }
+        if (m_state == Literal) {
+            if (_stream_isLiteral(c)) {
+                m_literal.append(c);
+                i++;
+            }
+            else if (!_handleJsonAttribute_isLiteral(m_literal.constData(), int(m_literal.size())))
+                fail(QString("invalid literal \"%1\"").arg(QString::fromLatin1(m_literal)), i);
+            else
+                endValue(data, i); // c is handled in the next state
+            continue;
+        }
+        if (_stream_isSpace(c)) {
+            i++;
+            continue;
+        }
+
+        switch (m_state) {
+        case ValueOrEnd:
+            if (c == ']') {
+                close(data, i);
+                break;
+            }
+            Q_FALLTHROUGH();
+        case Value:
+            beginValue(data, i);
+            break;
+        case KeyOrEnd:
+            if (c == '}') {
+                close(data, i);
+                break;
+            }
+            Q_FALLTHROUGH();
+        case Key:
+            if (c != '"') {
+                fail("expected key", i);
+                break;
+            }
+            m_state = String;
+            m_stringKey = true;
+            m_keyNeeded = !m_frames[m_depth - 1].paths.isEmpty();
+            m_keyEscaped = false;
+            m_key.clear();
+            break;
+        case Colon:
+            if (c == ':')
+                m_state = Value;
+            else
+                fail("expected ':'", i);
+            break;
+        case CommaOrEnd: {
+            auto& frame = m_frames[m_depth - 1];
+            if (c == ',') {
+                if (frame.array) {
+                    frame.index++;
+                    m_state = Value;
+                }
+                else
+                    m_state = Key;
+            }
+            else if (c == (frame.array ? ']' : '}'))
+                close(data, i);
+            else
+                fail(frame.array ? "expected ',' or ']'" : "expected ',' or '}'", i);
+            break;
+        }
+        case Done:
+            fail("garbage at the end of the document", i);
+            break;
+        default:
+            break;
+        }
+        i++;
+    }
+    if (hasError())
+        return false;
+
+    flush(data, size); // captured values continue in the next chunk
+    m_offset += size;
+    return true;
+}
+
+void QJsonPath::Stream::fail(const QString& message, int i)
+{
+    m_error = QString("%1 at offset %2").arg(message).arg(m_offset + i);
+}
+
+// scans a string from position i, returns the position after the processed bytes
+int QJsonPath::Stream::string(const char* data, int i, int size)
+{
+    const int begin = i;
+    for (; i < size; i++) {
+        const auto c = uchar(data[i]);
+        if (m_escape < 0) {
+            if (!c || !std::strchr("\"\\/bfnrtu", c)) {
+                fail("invalid escape sequence", i);
+                return i;
+            }
+            m_escape = c == 'u' ? 4 : 0;
+        }
+        else if (m_escape > 0) {
+            if (!std::isxdigit(c)) {
+                fail("invalid unicode escape", i);
+                return i;
+            }
+            m_escape--;
+        }
+        else if (c == '\\') {
+            m_escape = -1;
+            m_keyEscaped = true;
+        }
+        else if (c == '"')
+            break;
+        else if (c < 0x20) {
+            fail("control character in string", i);
+            return i;
+        }
+    }
+    if (m_stringKey && m_keyNeeded)
+        m_key.append(data + begin, i - begin);
+    if (i == size)
+        return i;
+
+    if (m_stringKey) {
+        key();
+        m_state = Colon;
+    }
+    else
+        endValue(data, i + 1);
+    return i + 1;
+}
+
+// selects the paths continuing with the key just read
+void QJsonPath::Stream::key()
+{
+    m_candidates.clear();
+    if (!m_keyNeeded)
+        return;
+    const auto name = m_keyEscaped ? _stream_decode(QByteArray("\"") + m_key + '"').toString() : QString::fromUtf8(m_key);
+    const auto& frame = m_frames[m_depth - 1];
+    for (const int p : frame.paths) {
+        const auto& path = m_paths[p];
+        if (path.type(m_depth - 1) == Compiled::Key && path.key(m_depth - 1) == name)
+            m_candidates.append(p);
+    }
+}
+
+void QJsonPath::Stream::beginValue(const char* data, int i)
+{
+    const char c = data[i];
+    const int depth = m_depth; // size of the paths ending at this value
+
+    if (!depth) {
+        if (c != '{' && c != '[') {
+            fail("document must be an object or an array", i);
+            return;
+        }
+        m_candidates.resize(m_paths.size());
+        for (int p = 0; p < m_paths.size(); p++)
+            m_candidates[p] = p;
+    }
+    else {
+        const auto& frame = m_frames[depth - 1];
+        if (frame.array) {
+            m_candidates.clear();
+            for (const int p : frame.paths) {
+                const auto& path = m_paths[p];
+                if (path.type(depth - 1) == Compiled::Index && path.index(depth - 1) == frame.index)
+                    m_candidates.append(p);
+            }
+            for (int t = 0; t < frame.tails.size(); t++)
+                capture(data, i, -1, t);
+        }
+    }
+    for (const int p : std::as_const(m_candidates)) {
+        if (m_paths[p].size() == depth)
+            capture(data, i, p, -1);
+    }
+
+    if (c == '{' || c == '[') {
+        if (m_frames.size() <= depth)
+            m_frames.resize(depth + 1);
+        auto& frame = m_frames[depth];
+        frame.array = c == '[';
+        frame.index = 0;
+        frame.paths.clear();
+        frame.tails.clear();
+        for (const int p : std::as_const(m_candidates)) {
+            const auto& path = m_paths[p];
+            if (path.size() <= depth)
+                continue;
+            if (frame.array && path.type(depth) == Compiled::Index && path.index(depth) < 0)
+                frame.tails.append(Tail{ p, {} });
+            else
+                frame.paths.append(p);
+        }
+        m_depth++;
+        m_state = frame.array ? ValueOrEnd : KeyOrEnd;
+    }
+    else if (c == '"') {
+        m_state = String;
+        m_stringKey = false;
+    }
+    else if (_stream_isLiteral(c)) {
+        m_state = Literal;
+        m_literal.clear();
+        m_literal.append(c);
+    }
+    else
+        fail(QString("unexpected character '%1'").arg(QChar::fromLatin1(c)), i);
+}
+
+// the value at the current depth ended before position end
+void QJsonPath::Stream::endValue(const char* data, int end)
+{
+    if (!m_captures.isEmpty() && m_captures.last().depth == m_depth) {
+        flush(data, end);
+        // all captures of a value start at the same position
+        const auto text = m_capture.mid(m_captures.last().start);
+        auto value = QJsonValue(QJsonValue::Undefined);
+        while (!m_captures.isEmpty() && m_captures.last().depth == m_depth) {
+            const auto capture = m_captures.takeLast();
+            if (capture.tail >= 0) {
+                auto& tail = m_frames[m_depth - 1].tails[capture.tail];
+                tail.elements.append(text);
+                if (tail.elements.size() > -m_paths[tail.path].index(m_depth - 1))
+                    tail.elements.removeFirst();
+                continue;
+            }
+            if (value.isUndefined())
+                value = _stream_decode(text);
+            if (value.isUndefined()) {
+                fail("invalid value", end);
+                return;
+            }
+            if (m_callback)
+                m_callback(capture.path, value);
+        }
+        if (m_captures.isEmpty())
+            m_capture.clear();
+    }
+    m_state = m_depth ? CommaOrEnd : Done;
+}
+
+// closing bracket at position i, the remaining path of a negative index is looked up in the element it counts down to
+void QJsonPath::Stream::close(const char* data, int i)
+{
+    auto& frame = m_frames[--m_depth];
+    for (const auto& tail : std::as_const(frame.tails)) {
+        const auto& path = m_paths[tail.path];
+        if (tail.elements.size() < -path.index(m_depth)) // counts down beyond the first element
+            continue;
+        Compiled rest;
+        for (int pos = m_depth + 1; pos < path.size(); pos++) {
+            if (path.type(pos) == Compiled::Key)
+                rest.append(path.key(pos));
+            else if (path.type(pos) == Compiled::Index)
+                rest.append(path.index(pos));
+            else
+                rest.appendElement(); // "[+]" finds nothing
+        }
+        const auto value = get(_stream_decode(tail.elements.first()), rest);
+        if (!value.isUndefined() && m_callback)
+            m_callback(tail.path, value);
+    }
+    frame.tails.clear();
+    endValue(data, i + 1);
+}
+
+void QJsonPath::Stream::capture(const char* data, int i, int path, int tail)
+{
+    flush(data, i);
+    m_captures.append({ int(m_capture.size()), m_depth, path, tail });
+}
+
+// copies the bytes of the current chunk up to end if a value is captured
+void QJsonPath::Stream::flush(const char* data, int end)
+{
+    if (!m_captures.isEmpty())
+        m_capture.append(data + m_chunkStart, end - m_chunkStart);
+    m_chunkStart = end;
+}
+
+
+// all paths of value, with negative indexes, "[+]" and paths that do not exist
+void _handleJsonAttribute_unittest_paths(const QJsonValue& value, QJsonPath::Compiled& path, QVector<QJsonPath::Compiled>& paths)
+{
+    paths.append(path);
+    const int size = path.size();
+    if (value.isObject()) {
+        const auto obj = value.toObject();
+        for (auto it = obj.begin(); it != obj.end(); ++it) {
+            path.append(it.key());
+            _handleJsonAttribute_unittest_paths(it.value(), path, paths);
+            path.truncate(size);
+        }
+        path.append(0);
+        paths.append(path);
+        path.truncate(size);
+    }
+    else if (value.isArray()) {
+        const auto arr = value.toArray();
+        const int count = int(arr.size());
+        for (int i = 0; i < count; i++) {
+            path.append(i);
+            _handleJsonAttribute_unittest_paths(arr.at(i), path, paths);
+            path.truncate(size);
+            path.append(i - count);
+            _handleJsonAttribute_unittest_paths(arr.at(i), path, paths);
+            path.truncate(size);
+        }
+        for (const int index : { count, -count - 1 }) {
+            path.append(index);
+            paths.append(path);
+            path.truncate(size);
+        }
+    }
+    path.append("missing");
+    paths.append(path);
+    path.truncate(size);
+    path.appendElement();
+    paths.append(path);
+    path.truncate(size);
+}
+
+// feeds text in chunks of chunkSize bytes, returns the last value reported for each path
+static QVector<QJsonValue> _stream_unittest_feed(const QVector<QJsonPath::Compiled>& paths, const QByteArray& text, int chunkSize, int* reports = nullptr)
+{
+    QVector<QJsonValue> values(paths.size(), QJsonValue(QJsonValue::Undefined));
+    int count = 0;
+    QJsonPath::Stream stream(paths, [&](int path, const QJsonValue& value) {
+        values[path] = value;
+        count++;
+    });
+    for (int pos = 0; pos < text.size(); pos += chunkSize) {
+        const bool ok = stream.feed(text.mid(pos, chunkSize));
+        Q_ASSERT(ok);
+        Q_UNUSED(ok)
+    }
+    Q_ASSERT(stream.isFinished());
+    if (reports)
+        *reports = count;
+    return values;
+}
+
+void _handleJsonAttribute_unittest_stream()
+{
+    // differential test against get on the parsed document
+    const char* const documents[] = {
+        R"({"a":1,"b":[true,false,null],"c":{"d":"text","e":[]},"f":{}})",
+        R"([[1,[2,[3,[4]]]],{"x":-1.5e3,"y":0,"z":-0.25},"",[{"id":7},{"id":8,"tags":["p","q"]}]])",
+        R"( { "esc\"aped" : "quote\" and \\ and é and 😀" , "name" : { "v" : 12345678901 } } )",
+        R"({"orders":[{"id":1,"status":"open","total":150.5},{"id":2,"status":"closed","total":20},{"id":3,"status":"open","total":1E2}],"count":3})",
+        R"([])",
+        R"({"":{"":[0,{"":null}]}})",
+    };
+    for (const char* document : documents) {
+        const auto doc = QJsonDocument::fromJson(document);
+        Q_ASSERT(!doc.isNull());
+        QVector<QJsonPath::Compiled> paths;
+        QJsonPath::Compiled root;
+        _handleJsonAttribute_unittest_paths(doc.isArray() ? QJsonValue(doc.array()) : QJsonValue(doc.object()), root, paths);
+
+        int expectedReports = 0;
+        for (const auto& path : paths)
+            expectedReports += !QJsonPath::get(doc, path).isUndefined();
+
+        for (const auto& text : { QByteArray(document), doc.toJson(QJsonDocument::Indented) }) {
+            for (const int chunkSize : { 1, 2, 3, 7, 64, int(text.size()) }) {
+                int reports = 0;
+                const auto values = _stream_unittest_feed(paths, text, chunkSize, &reports);
+                for (int p = 0; p < paths.size(); p++)
+                    Q_ASSERT_X(values[p] == QJsonPath::get(doc, paths[p]), __FUNCTION__, QString("path %1").arg(QJsonDocument(QJsonArray::fromVariantList(paths[p].toVariantList())).toJson(QJsonDocument::Compact).constData()).toUtf8());
+                Q_ASSERT(reports == expectedReports);
+            }
+        }
+    }
+
+    // a match is reported as soon as its text is complete
+    {
+        QJsonValue status;
+        QJsonPath::Stream stream({ QJsonPath::Compiled("status") }, [&](int, const QJsonValue& value) { status = value; });
+        Q_ASSERT(stream.feed(R"({"status":"open","items":[1,2)"));
+        Q_ASSERT(status == "open" && !stream.isFinished());
+        Q_ASSERT(stream.feed(R"(,3]})"));
+        Q_ASSERT(stream.isFinished());
+        stream.reset();
+        Q_ASSERT(stream.feed(R"({"status":"closed"})") && status == "closed");
+    }
+
+    // every occurrence of a duplicate key is reported, the last one is the value of get
+    {
+        const QByteArray text = R"({"a":1,"a":{"b":2}})";
+        QVector<QJsonValue> values;
+        QJsonPath::Stream stream({ QJsonPath::Compiled("a") }, [&](int, const QJsonValue& value) { values.append(value); });
+        Q_ASSERT(stream.feed(text));
+        const auto doc = QJsonDocument::fromJson(text);
+        Q_ASSERT(values.size() == 2 && values.last() == QJsonPath::get(doc, "a"));
+    }
+
+    // feeding from a device
+    {
+        QBuffer buffer;
+        buffer.setData(R"({"svc":[{"port":80},{"port":443}]})");
+        buffer.open(QIODevice::ReadOnly);
+        QJsonValue port;
+        QJsonPath::Stream stream;
+        stream.addPath(QJsonPath::Compiled("svc[-1]/port"));
+        stream.setCallback([&](int, const QJsonValue& value) { port = value; });
+        Q_ASSERT(stream.feed(&buffer) && stream.isFinished());
+        Q_ASSERT(port == 443);
+    }
+
+    // invalid text
+    for (const char* text : { R"({"a":tru})", R"({"a" 1})", R"([1,])", R"([1}])", R"({"a":1}x)", R"("text")", R"(["\x"])", "[\"a\nb\"]", R"([01])", R"({"a":[1,2})" }) {
+        QJsonPath::Stream stream({ QJsonPath::Compiled("a") }, QJsonPath::Stream::Callback());
+        Q_ASSERT_X(!stream.feed(text) && stream.hasError(), __FUNCTION__, text);
+        Q_ASSERT(!stream.feed("[]"));
+    }
+}